@@ -17,8 +17,14 @@ public:
   }
 };
 
+#ifdef RootsDebug
+#define RootsDebugEnabled true
+#else
+#define RootsDebugEnabled false
+#endif
+
 #define RootsDebugLog                                                          \
-  (RootsDebug ? std::cerr : __nullstream::get()) << "["                                                             \
+  (RootsDebugEnabled ? std::cerr : __nullstream::get()) << "["                 \
             << roots::fs::relativePath(__FILE__).value_or(                     \
                    std::filesystem::path("../invalid/path"))                   \
             << ":" << __LINE__ << "@" << __funcname__ << "] "
@@ -6,6 +6,7 @@
 #include "Error.hpp"
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -28,6 +29,21 @@ auto readFile(const path_type &path) -> roots::result<std::string, Error>;
 auto readFileBytes(const path_type &path)
     -> roots::result<std::vector<u8>, Error>;
 
+/// @brief Reads a file through a process-wide LRU cache bounded by total
+/// content size. A cached copy is reused while the file's modification time
+/// is unchanged, otherwise the file is read again. The cache is split into
+/// four shards; a file bigger than one shard's share of the budget is
+/// returned without being cached
+auto readFileCached(const path_type &path)
+    -> roots::result<std::shared_ptr<const std::string>, Error>;
+
+/// @brief Sets the byte budget of the readFileCached cache (default 64 MiB),
+/// evicting files if it shrank
+auto setFileCacheCapacity(usize bytes) -> void;
+
+/// @brief Drops every file held by the readFileCached cache
+auto clearFileCache() -> void;
+
 /// @brief Check if a file exists
 auto exists(const path_type &path) -> bool;
 
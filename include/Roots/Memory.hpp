@@ -7,9 +7,11 @@
 #include <list>
 #include <map>
 #include <mutex>
+#include <new>
 #include <vector>
 #include <chrono>
 
+#ifdef RootsDebug
 #define RootsMemBench_Start()                                                   \
   auto __start = std::chrono::high_resolution_clock::now()
 #define RootsMemBench_End(v)                                                    \
@@ -20,6 +22,12 @@
     RootsDebugLog << "done in " << __dur.count() << "us";                       \
   } while (0);                                                                 \
   return v
+#else
+// Timing every allocation (and resolving the log prefix) is far too costly
+// outside of debug builds
+#define RootsMemBench_Start()
+#define RootsMemBench_End(v) return v
+#endif
 
 namespace roots::mem {
 
@@ -117,6 +125,21 @@ static auto alloc(const u64 count) -> T * {
   RootsMemBench_End(static_cast<T *>(alloc(sizeof(T) * count)));
 }
 
+/// @brief Allocates memory with at least the given alignment, using the pool
+/// when it can satisfy the alignment and the system allocator otherwise
+static auto allocAligned(const u64 size, const u64 alignment) -> void * {
+  if (alignment <= PoolAllocator::kPoolAlignment)
+    return alloc(size, alignment);
+  return ::operator new(size, std::align_val_t(alignment));
+}
+
+/// @brief Frees memory returned by allocAligned (size and alignment must match)
+static auto freeAligned(void *ptr, u64 size, const u64 alignment) -> void {
+  if (alignment <= PoolAllocator::kPoolAlignment)
+    return free(ptr, size);
+  ::operator delete(ptr, std::align_val_t(alignment));
+}
+
 } // namespace roots::mem
 
 #endif
@@ -2,42 +2,77 @@
 #define Roots_String_hpp
 
 #include "./_defines.hpp"
+#include "String/AhoCorasick.hpp"
+#include "String/InlineString.hpp"
+#include "String/Interner.hpp"
+#include "String/Scan.hpp"
+#include "String/Split.hpp"
 #include <cstring>
+#include <initializer_list>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <algorithm>
 
 namespace roots::str {
 
 /// @brief Checks if a string ends with a certain substring
-auto endsWith(const std::string &str, const std::string &suffix) -> bool;
+auto endsWith(std::string_view str, std::string_view suffix) -> bool;
 
 /// @brief Checks if a string starts with a certain substring
-auto startsWith(const std::string &str, const std::string &prefix) -> bool;
+auto startsWith(std::string_view str, std::string_view prefix) -> bool;
 
-/// @brief Splits a string into a vector of strings
-auto split(const std::string &str, const std::string &delim)
+/// @brief Splits a string into a vector of strings. An empty delimiter
+/// splits into single characters
+auto split(std::string_view str, std::string_view delim)
     -> std::vector<std::string>;
 
-/// @brief Replaces all occurrences of a substring in a string
-auto replaceAll(const std::string &str, const std::string &from,
-                const std::string &to) -> std::string;
+/// @brief Like split, but the pieces are views into `str`, which must
+/// outlive them
+auto splitView(std::string_view str, std::string_view delim)
+    -> std::vector<std::string_view>;
+
+/// @brief Replaces all occurrences of a substring in a string. Matches are
+/// found first and the result is built in a single allocation
+auto replaceAll(std::string_view str, std::string_view from,
+                std::string_view to) -> std::string;
+
+/// @brief Replaces every occurrence of several substrings in one pass over
+/// `str` (an Aho-Corasick scan), e.g. {{"&", "&amp;"}, {"<", "&lt;"}}. Where
+/// matches overlap the leftmost wins, then the longest, then the earlier
+/// entry; replaced text is not scanned again. Empty patterns are ignored
+auto replaceMany(
+    std::string_view str,
+    const std::vector<std::pair<std::string_view, std::string_view>>
+        &replacements) -> std::string;
 
 /// @brief Joins a vector of strings into a single string
-auto join(const std::vector<std::string> &strs, const std::string &delim)
+auto join(const std::vector<std::string> &strs, std::string_view delim)
+    -> std::string;
+
+auto join(const std::vector<std::string_view> &strs, std::string_view delim)
+    -> std::string;
+
+auto join(std::initializer_list<std::string_view> strs, std::string_view delim)
     -> std::string;
 
 /// @brief Converts a string to lowercase
-auto toLower(const std::string &str) -> std::string;
+auto toLower(std::string_view str) -> std::string;
 
 /// @brief Converts a string to uppercase
-auto toUpper(const std::string &str) -> std::string;
+auto toUpper(std::string_view str) -> std::string;
 
 /// @brief Trims whitespace from the beginning and end of a string
-auto trim(const std::string &str) -> std::string;
+auto trim(std::string_view str) -> std::string;
+
+/// @brief Like trim, but returns a view into `str`
+auto trimView(std::string_view str) -> std::string_view;
 
-/// @brief Converts a string to C-style string by copying it
-auto duplicateAsCString(const std::string &str) -> const i8 *;
+/// @brief Converts a string to C-style string by copying it. The caller owns
+/// the copy (delete[]); for long-lived strings prefer intern(str).c_str(),
+/// which stores each distinct string once and is never freed
+auto duplicateAsCString(std::string_view str) -> const i8 *;
 
 } // namespace roots::str
 
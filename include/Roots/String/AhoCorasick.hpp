@@ -0,0 +1,228 @@
+#ifndef Roots_String_AhoCorasick_hpp
+#define Roots_String_AhoCorasick_hpp
+
+#include "../_defines.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace roots::str {
+
+/// @brief A pattern occurrence: the pattern's index and the byte range
+/// [start, end) it covers (offsets count from the start of the stream when
+/// scanning in chunks)
+struct PatternMatch {
+  u32 pattern;
+  usize start;
+  usize end;
+
+  auto operator==(const PatternMatch &other) const -> bool = default;
+};
+
+/// @brief How the automaton stores its transitions
+enum class TransitionLayout {
+  /// @brief Dense unless the table would exceed AhoCorasick::kDenseBudget
+  Automatic,
+  /// @brief A full row per state: one load per input byte
+  Dense,
+  /// @brief Sorted edge lists plus failure links, with full rows only for
+  /// the root and its children (where most failures land): far smaller for
+  /// large pattern sets, slower per byte
+  Compressed,
+};
+
+struct AhoCorasickOptions {
+  /// @brief Match ASCII letters regardless of case
+  bool caseInsensitive = false;
+  TransitionLayout layout = TransitionLayout::Automatic;
+};
+
+/// @brief A compiled Aho-Corasick automaton that finds every occurrence of a
+/// set of patterns in a single pass over the text, in time linear in the
+/// text plus the number of matches, however many patterns there are.
+/// Bytes are first mapped to equivalence classes (all bytes that appear in
+/// no pattern share one class, and case folding is done the same way), so
+/// dense rows are only as wide as the patterns' alphabet. Matches are
+/// reported in order of their end offset, longest first among those ending
+/// together, overlaps included. Empty patterns never match. A Scanner
+/// carries the automaton state across chunk boundaries for streamed input
+class AhoCorasick {
+public:
+  /// @brief The largest dense table TransitionLayout::Automatic will build
+  static constexpr usize kDenseBudget = usize(8) << 20;
+
+private:
+  static constexpr u32 kNone = static_cast<u32>(-1);
+  // Dense entries are premultiplied row offsets, tagged when the target
+  // state has matches so the hot loop needs no second lookup
+  static constexpr u32 kMatchFlag = u32(1) << 31;
+
+  std::vector<std::string> _patterns;
+  AhoCorasickOptions _options;
+  bool _isDense = true;
+  usize _maxLength = 0;
+  u8 _classes[256] = {};
+  u32 _classCount = 1;
+  u32 _stateCount = 1;
+  u32 _denseStates = 1; // states are numbered breadth first; these have rows
+
+  // Full transition rows of classCount entries for the first _denseStates
+  std::vector<u32> _delta;
+  // Compressed edges, sorted by class, and failure links
+  std::vector<u32> _edgeBegin;
+  std::vector<u8> _edgeClasses;
+  std::vector<u32> _edgeTargets;
+  std::vector<u32> _fail;
+
+  // For each state the first state on its failure chain (itself included)
+  // where patterns end, and for those states the next one further along
+  std::vector<u32> _matchState;
+  std::vector<u32> _outputLink;
+  // The patterns ending exactly at each state
+  std::vector<u32> _outputBegin;
+  std::vector<u32> _outputs;
+
+  auto build(const std::vector<std::string_view> &patterns) -> void;
+
+  /// @brief The target of the edge labelled `cls` leaving `state`, or kNone
+  auto edge(u32 state, u32 cls) const -> u32 {
+    for (u32 i = _edgeBegin[state];
+         i < _edgeBegin[state + 1] && _edgeClasses[i] <= cls; ++i)
+      if (_edgeClasses[i] == cls)
+        return _edgeTargets[i];
+    return kNone;
+  }
+
+  auto nextCompressed(u32 state, u32 cls) const -> u32 {
+    while (state >= _denseStates) {
+      u32 target = edge(state, cls);
+      if (target != kNone)
+        return target;
+      state = _fail[state];
+    }
+    return _delta[usize(state) * _classCount + cls];
+  }
+
+  /// @brief Calls fn for every pattern ending at `state`, stops and returns
+  /// false if fn returns false
+  template <typename F>
+  auto report(u32 state, usize end, F &fn) const -> bool {
+    for (u32 s = _matchState[state]; s != kNone; s = _outputLink[s]) {
+      for (u32 i = _outputBegin[s]; i < _outputBegin[s + 1]; ++i) {
+        u32 pattern = _outputs[i];
+        PatternMatch match{pattern, end - _patterns[pattern].size(), end};
+        using Result = std::invoke_result_t<F &, const PatternMatch &>;
+        if constexpr (std::is_same_v<Result, bool>) {
+          if (!fn(match))
+            return false;
+        } else {
+          fn(match);
+        }
+      }
+    }
+    return true;
+  }
+
+  /// @brief Runs the automaton over `text` from `state`; `offset` is the
+  /// stream position of text[0]. Returns the final state, or kNone if fn
+  /// asked to stop
+  template <typename F>
+  auto run(u32 state, std::string_view text, usize offset, F &fn) const
+      -> u32 {
+    const u8 *bytes = reinterpret_cast<const u8 *>(text.data());
+    if (_isDense) {
+      const u32 *delta = _delta.data();
+      for (usize i = 0; i < text.size(); ++i) {
+        u32 next = delta[state + _classes[bytes[i]]];
+        state = next & ~kMatchFlag;
+        if ((next & kMatchFlag) != 0 &&
+            !report(state / _classCount, offset + i + 1, fn))
+          return kNone;
+      }
+    } else {
+      for (usize i = 0; i < text.size(); ++i) {
+        state = nextCompressed(state, _classes[bytes[i]]);
+        if (_matchState[state] != kNone &&
+            !report(state, offset + i + 1, fn))
+          return kNone;
+      }
+    }
+    return state;
+  }
+
+public:
+  /// @brief Feeds a stream to the automaton chunk by chunk. Matches that
+  /// straddle chunk boundaries are found, and offsets count from the start
+  /// of the stream. The automaton must outlive the scanner
+  class Scanner {
+    const AhoCorasick *_automaton;
+    u32 _state = 0;
+    usize _offset = 0;
+
+  public:
+    explicit Scanner(const AhoCorasick &automaton) : _automaton(&automaton) {}
+
+    /// @brief Scans the next chunk, calling fn(const PatternMatch &) for
+    /// each match that ends in it. If fn returns bool, false stops the
+    /// scan (and the scanner should then be reset)
+    template <typename F> auto feed(std::string_view chunk, F &&fn) -> void {
+      u32 state = _automaton->run(_state, chunk, _offset, fn);
+      _state = state == kNone ? 0 : state;
+      _offset += chunk.size();
+    }
+
+    /// @brief Bytes fed so far
+    auto offset() const -> usize { return _offset; }
+
+    /// @brief Forgets any partial match and restarts offsets at zero
+    auto reset() -> void {
+      _state = 0;
+      _offset = 0;
+    }
+  };
+
+  AhoCorasick(const std::vector<std::string_view> &patterns,
+              AhoCorasickOptions options = {});
+
+  AhoCorasick(const std::vector<std::string> &patterns,
+              AhoCorasickOptions options = {});
+
+  auto patternCount() const -> usize { return _patterns.size(); }
+  auto pattern(usize index) const -> std::string_view {
+    return _patterns[index];
+  }
+  auto maxPatternLength() const -> usize { return _maxLength; }
+
+  auto stateCount() const -> usize { return _stateCount; }
+  auto isDense() const -> bool { return _isDense; }
+  auto options() const -> const AhoCorasickOptions & { return _options; }
+
+  /// @brief Bytes used by the transition and output tables
+  auto memoryUsage() const -> usize;
+
+  /// @brief Calls fn(const PatternMatch &) for every match in `text`. If fn
+  /// returns bool, false stops the scan
+  template <typename F>
+  auto forEachMatch(std::string_view text, F &&fn) const -> void {
+    run(0, text, 0, fn);
+  }
+
+  /// @brief Every match in `text`
+  auto findAll(std::string_view text) const -> std::vector<PatternMatch>;
+
+  /// @brief The first match to end in `text`, stopping the scan there
+  auto findFirst(std::string_view text) const -> std::optional<PatternMatch>;
+
+  /// @brief Whether any pattern occurs in `text`
+  auto contains(std::string_view text) const -> bool {
+    return findFirst(text).has_value();
+  }
+
+  auto scanner() const -> Scanner { return Scanner(*this); }
+};
+
+} // namespace roots::str
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef Roots_String_InlineString_hpp
+#define Roots_String_InlineString_hpp
+
+#include "../_defines.hpp"
+#include "../Memory.hpp"
+#include <algorithm>
+#include <compare>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace roots::str {
+
+/// @brief A string that keeps up to N characters inline and only allocates
+/// (through roots::mem) once it grows past that. The default of 23 covers
+/// the short tokens and keys that just miss libstdc++'s 15-character SSO.
+/// It is always NUL-terminated, converts implicitly to std::string_view,
+/// and compares with anything string_view accepts
+template <usize N = 23> class InlineString {
+  static_assert(N > 0, "InlineString needs at least one inline character");
+
+  i8 *_data;
+  usize _size;
+  usize _capacity;
+  i8 _inline[N + 1];
+
+  /// @brief Rounds a heap capacity up so that it plus the terminator fills
+  /// a whole pool size class (the pool hands out multiples of 8 bytes)
+  static auto heapCapacity(usize capacity) -> usize {
+    return mem::mult8RoundUp(capacity + 1) - 1;
+  }
+
+  static auto allocate(usize capacity) -> i8 * {
+    return static_cast<i8 *>(mem::allocAligned(capacity + 1, alignof(i8)));
+  }
+
+  auto release() -> void {
+    if (!isInline())
+      mem::freeAligned(_data, _capacity + 1, alignof(i8));
+  }
+
+  auto growTo(usize capacity) -> void {
+    capacity = heapCapacity(capacity);
+    i8 *data = allocate(capacity);
+    std::memcpy(data, _data, _size + 1);
+    release();
+    _data = data;
+    _capacity = capacity;
+  }
+
+  /// @brief Makes room for `extra` more characters, growing geometrically
+  auto reserveExtra(usize extra) -> void {
+    if (_size + extra > _capacity)
+      growTo(std::max(_size + extra, _capacity * 2));
+  }
+
+  auto setSize(usize size) -> void {
+    _size = size;
+    _data[size] = '\0';
+  }
+
+public:
+  using value_type = i8;
+  using size_type = usize;
+  using iterator = i8 *;
+  using const_iterator = const i8 *;
+
+  static constexpr usize kInlineCapacity = N;
+  static constexpr usize npos = std::string_view::npos;
+
+  InlineString() : _data(_inline), _size(0), _capacity(N) { _inline[0] = '\0'; }
+
+  InlineString(std::string_view str) : InlineString() { assign(str); }
+
+  InlineString(const i8 *str) : InlineString(std::string_view(str)) {}
+
+  InlineString(const i8 *str, usize length)
+      : InlineString(std::string_view(str, length)) {}
+
+  InlineString(const std::string &str) : InlineString(std::string_view(str)) {}
+
+  InlineString(usize count, i8 ch) : InlineString() { resize(count, ch); }
+
+  InlineString(const InlineString &other) : InlineString() {
+    assign(other.view());
+  }
+
+  InlineString(InlineString &&other) noexcept : InlineString() {
+    if (other.isInline()) {
+      assign(other.view());
+    } else {
+      _data = std::exchange(other._data, other._inline);
+      _size = std::exchange(other._size, 0);
+      _capacity = std::exchange(other._capacity, N);
+      other._inline[0] = '\0';
+    }
+  }
+
+  ~InlineString() { release(); }
+
+  auto operator=(const InlineString &other) -> InlineString & {
+    if (this != &other)
+      assign(other.view());
+    return *this;
+  }
+
+  auto operator=(InlineString &&other) noexcept -> InlineString & {
+    if (this == &other)
+      return *this;
+    if (other.isInline()) {
+      assign(other.view());
+    } else {
+      release();
+      _data = std::exchange(other._data, other._inline);
+      _size = std::exchange(other._size, 0);
+      _capacity = std::exchange(other._capacity, N);
+      other._inline[0] = '\0';
+    }
+    return *this;
+  }
+
+  auto operator=(std::string_view str) -> InlineString & {
+    assign(str);
+    return *this;
+  }
+
+  auto operator=(const i8 *str) -> InlineString & {
+    assign(std::string_view(str));
+    return *this;
+  }
+
+  auto assign(std::string_view str) -> InlineString & {
+    if (str.size() > _capacity) {
+      // str may point into this string, so copy before releasing
+      usize capacity = heapCapacity(str.size());
+      i8 *data = allocate(capacity);
+      std::memcpy(data, str.data(), str.size());
+      release();
+      _data = data;
+      _capacity = capacity;
+    } else {
+      std::memmove(_data, str.data(), str.size());
+    }
+    setSize(str.size());
+    return *this;
+  }
+
+  /// @brief Returns true while the characters still live in the inline buffer
+  auto isInline() const -> bool { return _data == _inline; }
+
+  auto data() -> i8 * { return _data; }
+  auto data() const -> const i8 * { return _data; }
+  auto c_str() const -> const i8 * { return _data; }
+
+  auto view() const -> std::string_view { return {_data, _size}; }
+  operator std::string_view() const { return view(); }
+
+  auto str() const -> std::string { return std::string(_data, _size); }
+
+  auto size() const -> usize { return _size; }
+  auto length() const -> usize { return _size; }
+  auto capacity() const -> usize { return _capacity; }
+  auto empty() const -> bool { return _size == 0; }
+
+  auto operator[](usize index) -> i8 & { return _data[index]; }
+  auto operator[](usize index) const -> i8 { return _data[index]; }
+
+  auto at(usize index) -> i8 & {
+    if (index >= _size)
+      throw std::out_of_range("InlineString index out of range");
+    return _data[index];
+  }
+
+  auto at(usize index) const -> i8 {
+    if (index >= _size)
+      throw std::out_of_range("InlineString index out of range");
+    return _data[index];
+  }
+
+  auto front() const -> i8 { return _data[0]; }
+  auto back() const -> i8 { return _data[_size - 1]; }
+
+  auto begin() -> iterator { return _data; }
+  auto end() -> iterator { return _data + _size; }
+  auto begin() const -> const_iterator { return _data; }
+  auto end() const -> const_iterator { return _data + _size; }
+
+  auto reserve(usize capacity) -> void {
+    if (capacity > _capacity)
+      growTo(capacity);
+  }
+
+  /// @brief Moves the characters back inline if they fit, otherwise trims the
+  /// heap buffer down to size
+  auto shrink_to_fit() -> void {
+    if (isInline() || (_size > N && _capacity == heapCapacity(_size)))
+      return;
+    i8 *heap = _data;
+    usize oldCapacity = _capacity;
+    if (_size <= N) {
+      _data = _inline;
+      _capacity = N;
+    } else {
+      _capacity = heapCapacity(_size);
+      _data = allocate(_capacity);
+    }
+    std::memcpy(_data, heap, _size + 1);
+    mem::freeAligned(heap, oldCapacity + 1, alignof(i8));
+  }
+
+  auto clear() -> void { setSize(0); }
+
+  auto resize(usize count, i8 ch = '\0') -> void {
+    if (count > _size) {
+      reserve(count);
+      std::memset(_data + _size, ch, count - _size);
+    }
+    setSize(count);
+  }
+
+  auto push_back(i8 ch) -> void {
+    reserveExtra(1);
+    _data[_size] = ch;
+    setSize(_size + 1);
+  }
+
+  auto pop_back() -> void { setSize(_size - 1); }
+
+  auto append(std::string_view str) -> InlineString & {
+    if (_size + str.size() > _capacity) {
+      // str may point into this string, which growing would free
+      bool aliases = str.data() >= _data && str.data() <= _data + _size;
+      usize offset = aliases ? static_cast<usize>(str.data() - _data) : 0;
+      reserveExtra(str.size());
+      if (aliases)
+        str = std::string_view(_data + offset, str.size());
+    }
+    std::memcpy(_data + _size, str.data(), str.size());
+    setSize(_size + str.size());
+    return *this;
+  }
+
+  auto append(usize count, i8 ch) -> InlineString & {
+    reserveExtra(count);
+    std::memset(_data + _size, ch, count);
+    setSize(_size + count);
+    return *this;
+  }
+
+  auto operator+=(std::string_view str) -> InlineString & {
+    return append(str);
+  }
+
+  auto operator+=(i8 ch) -> InlineString & {
+    push_back(ch);
+    return *this;
+  }
+
+  auto insert(usize pos, std::string_view str) -> InlineString & {
+    if (pos > _size)
+      throw std::out_of_range("InlineString insert position out of range");
+    InlineString copy;
+    if (str.data() >= _data && str.data() <= _data + _size) {
+      copy.assign(str);
+      str = copy.view();
+    }
+    reserveExtra(str.size());
+    std::memmove(_data + pos + str.size(), _data + pos, _size - pos);
+    std::memcpy(_data + pos, str.data(), str.size());
+    setSize(_size + str.size());
+    return *this;
+  }
+
+  /// @brief Removes up to `count` characters starting at `pos`
+  auto erase(usize pos, usize count = npos) -> InlineString & {
+    if (pos > _size)
+      throw std::out_of_range("InlineString erase position out of range");
+    count = std::min(count, _size - pos);
+    std::memmove(_data + pos, _data + pos + count, _size - pos - count);
+    setSize(_size - count);
+    return *this;
+  }
+
+  /// @brief A view of up to `count` characters starting at `pos`
+  auto substr(usize pos, usize count = npos) const -> std::string_view {
+    return view().substr(pos, count);
+  }
+
+  auto find(std::string_view str, usize pos = 0) const -> usize {
+    return view().find(str, pos);
+  }
+
+  auto find(i8 ch, usize pos = 0) const -> usize { return view().find(ch, pos); }
+
+  auto startsWith(std::string_view prefix) const -> bool {
+    return view().starts_with(prefix);
+  }
+
+  auto endsWith(std::string_view suffix) const -> bool {
+    return view().ends_with(suffix);
+  }
+
+  auto swap(InlineString &other) noexcept -> void {
+    InlineString tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  friend auto swap(InlineString &a, InlineString &b) noexcept -> void {
+    a.swap(b);
+  }
+
+  // Templated so that literals and std::strings compare through string_view
+  // rather than being ambiguous with a conversion to InlineString
+  template <typename S>
+    requires std::is_convertible_v<const S &, std::string_view>
+  friend auto operator==(const InlineString &a, const S &b) -> bool {
+    return a.view() == std::string_view(b);
+  }
+
+  template <typename S>
+    requires std::is_convertible_v<const S &, std::string_view>
+  friend auto operator<=>(const InlineString &a, const S &b)
+      -> std::strong_ordering {
+    return a.view() <=> std::string_view(b);
+  }
+
+  friend auto operator==(const InlineString &a, const InlineString &b)
+      -> bool {
+    return a.view() == b.view();
+  }
+
+  friend auto operator<=>(const InlineString &a, const InlineString &b)
+      -> std::strong_ordering {
+    return a.view() <=> b.view();
+  }
+
+  friend auto operator+(InlineString a, std::string_view b) -> InlineString {
+    a.append(b);
+    return a;
+  }
+};
+
+} // namespace roots::str
+
+template <usize N> struct std::hash<roots::str::InlineString<N>> {
+  auto operator()(const roots::str::InlineString<N> &str) const -> size_t {
+    return std::hash<std::string_view>{}(str.view());
+  }
+};
+
+#endif
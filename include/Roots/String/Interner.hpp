@@ -0,0 +1,146 @@
+#ifndef Roots_String_Interner_hpp
+#define Roots_String_Interner_hpp
+
+#include "../_defines.hpp"
+#include <atomic>
+#include <compare>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace roots::str {
+
+class Interner;
+
+namespace detail {
+
+/// @brief An interned string as laid out in the interner's arena: the header
+/// is followed by the bytes and a terminating NUL
+struct InternEntry {
+  u64 hash;
+  u32 length;
+
+  auto data() const -> const i8 * {
+    return reinterpret_cast<const i8 *>(this + 1);
+  }
+};
+
+} // namespace detail
+
+/// @brief A handle to a string stored once in an Interner. Equality and
+/// hashing compare a single pointer; the text is readable as a string_view or
+/// NUL-terminated C string for as long as the interner lives (forever for the
+/// global one). A default-constructed Symbol is empty and equals no interned
+/// string, not even ""
+class Symbol {
+  friend class Interner;
+
+  const detail::InternEntry *_entry = nullptr;
+
+  explicit Symbol(const detail::InternEntry *entry) : _entry(entry) {}
+
+public:
+  Symbol() = default;
+
+  auto view() const -> std::string_view {
+    return _entry ? std::string_view(_entry->data(), _entry->length)
+                  : std::string_view();
+  }
+
+  auto str() const -> std::string { return std::string(view()); }
+
+  auto c_str() const -> const i8 * { return _entry ? _entry->data() : ""; }
+
+  auto size() const -> usize { return _entry ? _entry->length : 0; }
+
+  /// @brief True for a default-constructed Symbol
+  auto empty() const -> bool { return _entry == nullptr; }
+
+  /// @brief The string's hash, computed once at interning time
+  auto hash() const -> u64 { return _entry ? _entry->hash : 0; }
+
+  explicit operator bool() const { return _entry != nullptr; }
+
+  operator std::string_view() const { return view(); }
+
+  auto operator==(const Symbol &other) const -> bool {
+    return _entry == other._entry;
+  }
+
+  /// @brief An arbitrary but consistent order (by address), for use as a key
+  /// in ordered containers. Compare view()s for lexicographic order
+  auto operator<=>(const Symbol &other) const -> std::strong_ordering {
+    return std::compare_three_way{}(_entry, other._entry);
+  }
+};
+
+/// @brief A thread-safe string interner. Each distinct string is copied once
+/// into arena chunks that are never freed or moved while the interner lives,
+/// so Symbols and their views stay valid. Looking up a string that is already
+/// interned takes no lock: the hash table is an array of atomic entry pointers
+/// that writers fill in under a mutex and publish with release stores. When
+/// the table grows the old one is kept until the interner is destroyed, since
+/// readers may still be probing it (this at most doubles the table memory)
+class Interner {
+  struct Table {
+    usize mask;
+    std::unique_ptr<std::atomic<const detail::InternEntry *>[]> slots;
+
+    explicit Table(usize capacity);
+  };
+
+  std::atomic<Table *> _table;
+  std::vector<std::unique_ptr<Table>> _tables; // current and retired
+  std::vector<std::unique_ptr<u8[]>> _chunks;
+  u8 *_cursor = nullptr;
+  usize _remaining = 0;
+  std::atomic<usize> _size = 0;
+  usize _bytes = 0;
+  std::mutex _mutex;
+
+  static auto find(const Table *table, std::string_view str, u64 hash)
+      -> const detail::InternEntry *;
+  auto allocate(std::string_view str, u64 hash) -> detail::InternEntry *;
+  auto grow() -> void;
+
+public:
+  explicit Interner(usize expected = 1024);
+  ~Interner();
+
+  Interner(const Interner &) = delete;
+  auto operator=(const Interner &) -> Interner & = delete;
+
+  /// @brief The Symbol for `str`, copying it into the interner if new
+  auto intern(std::string_view str) -> Symbol;
+
+  /// @brief The Symbol for `str` if it has been interned, otherwise an
+  /// empty Symbol. Never locks or allocates
+  auto lookup(std::string_view str) const -> Symbol;
+
+  /// @brief The number of distinct strings interned
+  auto size() const -> usize {
+    return _size.load(std::memory_order_relaxed);
+  }
+
+  /// @brief Bytes of arena memory reserved for string storage
+  auto arenaBytes() -> usize;
+
+  /// @brief The process-wide interner, used by roots::str::intern
+  static auto global() -> Interner &;
+};
+
+/// @brief Interns `str` in the global interner
+auto intern(std::string_view str) -> Symbol;
+
+} // namespace roots::str
+
+template <> struct std::hash<roots::str::Symbol> {
+  auto operator()(const roots::str::Symbol &symbol) const -> size_t {
+    return static_cast<size_t>(symbol.hash());
+  }
+};
+
+#endif
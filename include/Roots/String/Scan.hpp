@@ -0,0 +1,141 @@
+#ifndef Roots_String_Scan_hpp
+#define Roots_String_Scan_hpp
+
+#include "../_defines.hpp"
+#include <algorithm>
+#include <bit>
+#include <string_view>
+#include <type_traits>
+
+namespace roots::str {
+
+/// @brief A set of bytes. Membership is a 256-bit table lookup; sets of up to
+/// kMaxVectorChars distinct bytes are also kept as a list so the vector
+/// scanners can compare against each one in parallel
+class AnyOf {
+public:
+  static constexpr usize kMaxVectorChars = 8;
+
+private:
+  u64 _table[4] = {};
+  i8 _chars[kMaxVectorChars] = {};
+  u32 _count = 0;
+
+public:
+  AnyOf() = default;
+
+  explicit AnyOf(std::string_view chars) {
+    for (i8 ch : chars) {
+      if (contains(ch))
+        continue;
+      u8 byte = static_cast<u8>(ch);
+      _table[byte / 64] |= u64(1) << (byte % 64);
+      if (_count < kMaxVectorChars)
+        _chars[_count] = ch;
+      ++_count;
+    }
+  }
+
+  auto contains(i8 ch) const -> bool {
+    u8 byte = static_cast<u8>(ch);
+    return (_table[byte / 64] >> (byte % 64)) & 1;
+  }
+
+  /// @brief The number of distinct bytes in the set
+  auto size() const -> usize { return _count; }
+
+  /// @brief The bytes of the set when there are at most kMaxVectorChars of
+  /// them, otherwise empty (larger sets are scanned through the table)
+  auto vectorChars() const -> std::string_view {
+    return _count <= kMaxVectorChars ? std::string_view(_chars, _count)
+                                     : std::string_view();
+  }
+};
+
+/// @brief A bitmask of the bytes in p[0, n) (n <= 64) equal to `ch`: bit i
+/// is set when p[i] matches. Full 64-byte blocks are compared with SSE2 or
+/// AVX2, whichever the CPU supports (see scanIsa)
+auto matchMask(const i8 *p, usize n, i8 ch) -> u64;
+
+/// @brief A bitmask of the bytes in p[0, n) (n <= 64) that are in `set`
+auto matchMask(const i8 *p, usize n, const AnyOf &set) -> u64;
+
+/// @brief The position of the first `ch` in text at or after `from`, or npos
+auto findByte(std::string_view text, i8 ch, usize from = 0) -> usize;
+
+/// @brief The position of the first byte of `set` in text at or after
+/// `from`, or npos
+auto findAnyOf(std::string_view text, const AnyOf &set, usize from = 0)
+    -> usize;
+
+/// @brief The number of times `ch` occurs in text (e.g. '\n' to count lines)
+auto countByte(std::string_view text, i8 ch) -> usize;
+
+/// @brief The instruction set the scanners selected at startup: "avx2",
+/// "sse2" or "scalar"
+auto scanIsa() -> std::string_view;
+
+/// @brief Finds successive matches of a byte or an AnyOf set in one string,
+/// keeping the match mask of the current 64-byte block so that finding the
+/// next short token is a bit scan rather than a fresh search. Long gaps
+/// fall back to findByte/findAnyOf. Calls must use the same text and
+/// non-decreasing positions to reuse the mask; anything else just reloads it
+template <typename Needle> class MaskScanner {
+  static_assert(std::is_same_v<Needle, i8> || std::is_same_v<Needle, AnyOf>,
+                "MaskScanner scans for an i8 or an AnyOf");
+
+  Needle _needle{};
+  const i8 *_text = nullptr;
+  usize _base = 0;
+  u64 _mask = 0;
+
+  auto load(std::string_view text, usize at) -> void {
+    _text = text.data();
+    _base = at;
+    _mask = matchMask(text.data() + at, std::min<usize>(64, text.size() - at),
+                      _needle);
+  }
+
+public:
+  MaskScanner() = default;
+  explicit MaskScanner(Needle needle) : _needle(needle) {}
+
+  auto needle() const -> const Needle & { return _needle; }
+
+  auto find(std::string_view text, usize from) -> usize {
+    if (from >= text.size())
+      return std::string_view::npos;
+    usize offset = from - _base; // wraps to >= 64 when from < _base
+    if (_text != text.data() || offset >= 64) {
+      load(text, from);
+      offset = 0;
+    }
+    u64 mask = _mask >> offset;
+    if (mask != 0)
+      return from + static_cast<usize>(std::countr_zero(mask));
+
+    // Tokens usually end in the next block; only search when it's empty too
+    usize next = _base + 64;
+    if (next >= text.size())
+      return std::string_view::npos;
+    load(text, next);
+    if (_mask != 0)
+      return next + static_cast<usize>(std::countr_zero(_mask));
+
+    next += 64;
+    if (next >= text.size())
+      return std::string_view::npos;
+    usize hit;
+    if constexpr (std::is_same_v<Needle, i8>)
+      hit = findByte(text, _needle, next);
+    else
+      hit = findAnyOf(text, _needle, next);
+    if (hit != std::string_view::npos)
+      load(text, hit);
+    return hit;
+  }
+};
+
+} // namespace roots::str
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef Roots_String_Split_hpp
+#define Roots_String_Split_hpp
+
+#include "../_defines.hpp"
+#include "Scan.hpp"
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <string_view>
+
+namespace roots::str {
+
+/// @brief Where a delimiter was found: its position and length, or npos
+struct SplitMatch {
+  usize pos = std::string_view::npos;
+  usize length = 0;
+};
+
+/// @brief Splits on a single character. Matches are found a 64-byte mask at
+/// a time (see MaskScanner), so short tokens cost a bit scan each
+class CharDelimiter {
+  MaskScanner<i8> _scanner;
+
+public:
+  CharDelimiter() = default;
+  explicit CharDelimiter(i8 ch) : _scanner(ch) {}
+
+  auto find(std::string_view text, usize from) -> SplitMatch {
+    return {_scanner.find(text, from), 1};
+  }
+};
+
+/// @brief Splits on a substring, scanning for its first byte and comparing
+/// the rest. An empty delimiter splits into single characters
+class StringDelimiter {
+  std::string_view _delim;
+  MaskScanner<i8> _first;
+
+public:
+  StringDelimiter() = default;
+  explicit StringDelimiter(std::string_view delim)
+      : _delim(delim), _first(delim.empty() ? '\0' : delim.front()) {}
+
+  auto find(std::string_view text, usize from) -> SplitMatch {
+    if (_delim.empty())
+      return {from + 1 < text.size() ? from + 1 : std::string_view::npos, 0};
+    usize pos = _first.find(text, from);
+    while (pos != std::string_view::npos &&
+           text.substr(pos, _delim.size()) != _delim)
+      pos = _first.find(text, pos + 1);
+    return {pos, _delim.size()};
+  }
+};
+
+/// @brief Splits on any one of a set of characters
+class AnyOfDelimiter {
+  MaskScanner<AnyOf> _scanner;
+
+public:
+  AnyOfDelimiter() = default;
+  explicit AnyOfDelimiter(const AnyOf &set) : _scanner(set) {}
+
+  auto find(std::string_view text, usize from) -> SplitMatch {
+    return {_scanner.find(text, from), 1};
+  }
+};
+
+struct SplitOptions {
+  /// @brief Split at most this many times; the rest of the string becomes
+  /// the last token. Skipped empty tokens don't count
+  usize maxSplit = std::string_view::npos;
+  /// @brief Drop empty tokens (so runs of delimiters act as one)
+  bool skipEmpty = false;
+};
+
+/// @brief A lazy split of a string_view: tokens are found one at a time as
+/// the range is iterated and are views into the source, so nothing is
+/// allocated and a loop that stops after a few fields never scans the rest.
+/// Works with range-for and as a C++20 forward range (std::views::take,
+/// std::ranges::distance, ...). The source must outlive the tokens
+template <typename Delimiter>
+class SplitRange : public std::ranges::view_interface<SplitRange<Delimiter>> {
+  std::string_view _text;
+  Delimiter _delim;
+  SplitOptions _options;
+
+public:
+  class Iterator {
+    std::string_view _text;
+    Delimiter _delim;
+    std::string_view _token;
+    usize _next = 0;     // where the next token starts
+    usize _splitsLeft = 0;
+    bool _skipEmpty = false;
+    bool _last = false;  // _token runs to the end of the text
+    bool _done = true;
+
+    auto advance() -> void {
+      do {
+        if (_last) {
+          _done = true;
+          return;
+        }
+        SplitMatch match;
+        if (_splitsLeft != 0)
+          match = _delim.find(_text, _next);
+        if (match.pos == std::string_view::npos) {
+          _token = std::string_view(_text.data() + _next, _text.size() - _next);
+          _last = true;
+        } else {
+          _token = std::string_view(_text.data() + _next, match.pos - _next);
+          _next = match.pos + match.length;
+          if (!_token.empty() || !_skipEmpty)
+            --_splitsLeft;
+        }
+      } while (_skipEmpty && _token.empty());
+    }
+
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::string_view;
+
+    Iterator() = default;
+
+    Iterator(std::string_view text, Delimiter delim, SplitOptions options)
+        : _text(text), _delim(delim), _splitsLeft(options.maxSplit),
+          _skipEmpty(options.skipEmpty), _done(false) {
+      advance();
+    }
+
+    auto operator*() const -> std::string_view { return _token; }
+
+    /// @brief The offset of the current token in the source
+    auto position() const -> usize {
+      return static_cast<usize>(_token.data() - _text.data());
+    }
+
+    /// @brief Everything from the current token to the end of the source
+    auto rest() const -> std::string_view { return _text.substr(position()); }
+
+    auto operator++() -> Iterator & {
+      advance();
+      return *this;
+    }
+
+    auto operator++(int) -> Iterator {
+      Iterator copy = *this;
+      advance();
+      return copy;
+    }
+
+    friend auto operator==(const Iterator &a, const Iterator &b) -> bool {
+      if (a._done || b._done)
+        return a._done == b._done;
+      return a._token.data() == b._token.data() &&
+             a._token.size() == b._token.size();
+    }
+
+    friend auto operator==(const Iterator &it, std::default_sentinel_t)
+        -> bool {
+      return it._done;
+    }
+  };
+
+  SplitRange() = default;
+
+  SplitRange(std::string_view text, Delimiter delim, SplitOptions options = {})
+      : _text(text), _delim(delim), _options(options) {}
+
+  auto begin() const -> Iterator { return Iterator(_text, _delim, _options); }
+  auto end() const -> std::default_sentinel_t { return std::default_sentinel; }
+};
+
+/// @brief Lazily splits `str` on the character `delim`
+inline auto splitRange(std::string_view str, i8 delim,
+                       SplitOptions options = {}) -> SplitRange<CharDelimiter> {
+  return {str, CharDelimiter(delim), options};
+}
+
+/// @brief Lazily splits `str` on the substring `delim`
+inline auto splitRange(std::string_view str, std::string_view delim,
+                       SplitOptions options = {})
+    -> SplitRange<StringDelimiter> {
+  return {str, StringDelimiter(delim), options};
+}
+
+/// @brief Lazily splits `str` on any of the characters in `delims`
+inline auto splitRange(std::string_view str, const AnyOf &delims,
+                       SplitOptions options = {})
+    -> SplitRange<AnyOfDelimiter> {
+  return {str, AnyOfDelimiter(delims), options};
+}
+
+} // namespace roots::str
+
+template <typename Delimiter>
+inline constexpr bool
+    std::ranges::enable_borrowed_range<roots::str::SplitRange<Delimiter>> =
+        true;
+
+#endif
@@ -3,7 +3,33 @@
 
 #include "./_defines.hpp"
 #include "Concepts.hpp"
+#include "Structures/BitSet.hpp"
+#include "Structures/BloomFilter.hpp"
+#include "Structures/BTree.hpp"
+#include "Structures/ConcurrentHashMap.hpp"
+#include "Structures/CuckooFilter.hpp"
+#include "Structures/FlatHashMap.hpp"
+#include "Structures/FlatMap.hpp"
+#include "Structures/Hash.hpp"
+#include "Structures/IndexedHeap.hpp"
+#include "Structures/LruCache.hpp"
+#include "Structures/MpmcQueue.hpp"
+#include "Structures/Persistent.hpp"
+#include "Structures/RadixTree.hpp"
+#include "Structures/RoaringBitmap.hpp"
+#include "Structures/Rope.hpp"
+#include "Structures/SmallVector.hpp"
+#include "Structures/SoaVector.hpp"
+#include "Structures/SpscQueue.hpp"
+#include "Structures/TimerWheel.hpp"
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -12,195 +38,569 @@ namespace roots::structures {
 
 using namespace roots::concepts;
 
-/// @brief A "bitflags"-like type that can be used with enums
-// (this type is not compatible with enum class)
-template <BitFlagConvertible T> class BitFlags {
-  u64 flags;
+/// @brief A "bitflags"-like type that can be used with enums, where each enum
+/// value is a bit index. N is the number of flags (64 by default, any width
+/// is allowed)
+template <BitFlagConvertible T, usize N = 64> class BitFlags {
+  BitSet<N> flags;
+
+  static constexpr auto bit(T flag) -> usize {
+    return static_cast<usize>(static_cast<u64>(flag));
+  }
 
 public:
-  BitFlags() : flags(0) {}
-  BitFlags(u64 flags) : flags(flags) {}
-  BitFlags(const BitFlags &other) : flags(other.flags) {}
+  constexpr BitFlags() = default;
+  constexpr BitFlags(u64 flags) : flags(flags) {}
+  constexpr BitFlags(const BitSet<N> &flags) : flags(flags) {}
 
-  auto operator=(const BitFlags &other) -> BitFlags & {
-    flags = other.flags;
-    return *this;
+  constexpr BitFlags(std::initializer_list<T> init) {
+    for (T flag : init)
+      set(flag);
   }
 
-  auto operator==(const BitFlags &other) const -> bool {
+  constexpr auto operator==(const BitFlags &other) const -> bool {
     return flags == other.flags;
   }
 
-  auto operator!=(const BitFlags &other) const -> bool {
-    return flags != other.flags;
+  constexpr auto operator!=(const BitFlags &other) const -> bool {
+    return !(flags == other.flags);
   }
 
-  auto operator[](T flag) const -> bool {
-    return flags & (1 << static_cast<u64>(flag));
-  }
+  constexpr auto operator[](T flag) const -> bool { return flags.test(bit(flag)); }
 
   // Allows for `flags[Flag::Foo] = true;`
-  auto operator[](T flag) -> bool & {
-    return *reinterpret_cast<bool *>(reinterpret_cast<u64>(&flags) +
-                                     static_cast<u64>(flag));
+  constexpr auto operator[](T flag) -> typename BitSet<N>::Reference {
+    return flags[bit(flag)];
   }
 
-  auto operator~() const -> BitFlags { return BitFlags(~flags); }
+  constexpr auto operator~() const -> BitFlags { return BitFlags(~flags); }
 
-  auto set(T flag, bool value = true) -> void {
-    if (value)
-      flags |= (1 << static_cast<u64>(flag));
-    else
-      flags &= ~(1 << static_cast<u64>(flag));
+  constexpr auto set(T flag, bool value = true) -> void {
+    flags.set(bit(flag), value);
+  }
+
+  constexpr auto get(T flag) const -> bool { return flags.test(bit(flag)); }
+
+  constexpr auto clear() -> void { flags.reset(); }
+
+  /// @brief The number of flags that are set
+  constexpr auto count() const -> usize { return flags.count(); }
+
+  constexpr auto any() const -> bool { return flags.any(); }
+
+  constexpr auto none() const -> bool { return flags.none(); }
+
+  /// @brief Iterates the set flags as bit indices
+  constexpr auto begin() const { return flags.begin(); }
+  constexpr auto end() const { return flags.end(); }
+
+  constexpr auto bits() const -> const BitSet<N> & { return flags; }
+
+  constexpr auto operator|(T flag) const -> BitFlags {
+    return BitFlags(*this) |= flag;
+  }
+
+  constexpr auto operator&(T flag) const -> BitFlags {
+    return BitFlags(*this) &= flag;
+  }
+
+  constexpr auto operator|=(T flag) -> BitFlags & {
+    set(flag);
+    return *this;
   }
 
-  auto get(T flag) const -> bool {
-    return flags & (1 << static_cast<u64>(flag));
+  /// @brief Keeps only `flag` (if it was set)
+  constexpr auto operator&=(T flag) -> BitFlags & {
+    bool wasSet = get(flag);
+    flags.reset();
+    set(flag, wasSet);
+    return *this;
   }
 
-  auto clear() -> void { flags = 0; }
+  constexpr auto operator|(const BitFlags &other) const -> BitFlags {
+    return BitFlags(flags | other.flags);
+  }
 
-  auto operator|(T flag) const -> BitFlags { return BitFlags(flags | flag); }
+  constexpr auto operator&(const BitFlags &other) const -> BitFlags {
+    return BitFlags(flags & other.flags);
+  }
 
-  auto operator&(T flag) const -> BitFlags { return BitFlags(flags & flag); }
+  constexpr auto operator^(const BitFlags &other) const -> BitFlags {
+    return BitFlags(flags ^ other.flags);
+  }
 
-  auto operator|=(T flag) -> BitFlags & {
-    flags |= flag;
+  constexpr auto operator|=(const BitFlags &other) -> BitFlags & {
+    flags |= other.flags;
     return *this;
   }
 
-  auto operator&=(T flag) -> BitFlags & {
-    flags &= flag;
+  constexpr auto operator&=(const BitFlags &other) -> BitFlags & {
+    flags &= other.flags;
     return *this;
   }
+
+  constexpr auto operator^=(const BitFlags &other) -> BitFlags & {
+    flags ^= other.flags;
+    return *this;
+  }
+
+  /// @brief Clears every flag that is set in `other`
+  constexpr auto andNot(const BitFlags &other) -> BitFlags & {
+    flags.andNot(other.flags);
+    return *this;
+  }
+
+  /// @brief True if every flag set here is also set in `other`
+  constexpr auto isSubsetOf(const BitFlags &other) const -> bool {
+    return flags.isSubsetOf(other.flags);
+  }
+
+  constexpr auto intersects(const BitFlags &other) const -> bool {
+    return flags.intersects(other.flags);
+  }
 };
 
-/// @brief An alternative to std::views::values
-template <typename K, typename V>
-auto values(const std::unordered_map<K, V> &map) -> std::vector<V> {
-  std::vector<V> values;
-  values.reserve(map.size());
-  for (const auto &[_, value] : map)
-    values.push_back(value);
-  return values;
+namespace detail {
+
+/// @brief Adapts a map iterator to yield only the I-th member of each entry
+template <std::forward_iterator It, usize I> class ElementIterator {
+  It _it;
+
+public:
+  using reference = decltype(std::get<I>(*std::declval<const It &>()));
+  using value_type = std::remove_cvref_t<reference>;
+  using pointer = std::add_pointer_t<reference>;
+  using difference_type = std::iter_difference_t<It>;
+  using iterator_concept =
+      std::conditional_t<std::bidirectional_iterator<It>,
+                         std::bidirectional_iterator_tag,
+                         std::forward_iterator_tag>;
+  using iterator_category = iterator_concept;
+
+  ElementIterator() = default;
+  explicit ElementIterator(It it) : _it(std::move(it)) {}
+
+  auto operator*() const -> reference { return std::get<I>(*_it); }
+  auto operator->() const -> pointer { return &std::get<I>(*_it); }
+
+  auto operator++() -> ElementIterator & {
+    ++_it;
+    return *this;
+  }
+
+  auto operator++(int) -> ElementIterator {
+    ElementIterator tmp = *this;
+    ++_it;
+    return tmp;
+  }
+
+  auto operator--() -> ElementIterator &
+    requires std::bidirectional_iterator<It>
+  {
+    --_it;
+    return *this;
+  }
+
+  auto operator--(int) -> ElementIterator
+    requires std::bidirectional_iterator<It>
+  {
+    ElementIterator tmp = *this;
+    --_it;
+    return tmp;
+  }
+
+  auto operator==(const ElementIterator &other) const -> bool {
+    return _it == other._it;
+  }
+
+  auto base() const -> const It & { return _it; }
+};
+
+} // namespace detail
+
+/// @brief A map-like range whose elements are key/value pairs
+template <typename M>
+concept PairRange = std::ranges::forward_range<M> &&
+                    requires(std::ranges::range_reference_t<M> entry) {
+                      std::get<0>(entry);
+                      std::get<1>(entry);
+                    };
+
+/// @brief A non-owning view over the I-th member (key or value) of every entry
+/// in a map. Nothing is copied; the map must outlive the view
+template <PairRange Map, usize I>
+class ElementsView : public std::ranges::view_interface<ElementsView<Map, I>> {
+  Map *_map = nullptr;
+
+public:
+  using iterator = detail::ElementIterator<std::ranges::iterator_t<Map>, I>;
+
+  ElementsView() = default;
+  explicit ElementsView(Map &map) : _map(&map) {}
+
+  auto begin() const -> iterator { return iterator(std::ranges::begin(*_map)); }
+  auto end() const -> iterator { return iterator(std::ranges::end(*_map)); }
+  auto size() const -> usize { return std::ranges::size(*_map); }
+};
+
+template <PairRange Map> using KeysView = ElementsView<Map, 0>;
+template <PairRange Map> using ValuesView = ElementsView<Map, 1>;
+
+/// @brief A lazy view of a map's keys (an alternative to std::views::keys)
+template <PairRange Map> auto keys(Map &map) -> KeysView<Map> {
+  return KeysView<Map>(map);
 }
 
-/// @brief An alternative to std::views::keys
-template <typename K, typename V>
-auto keys(const std::unordered_map<K, V> &map) -> std::vector<K> {
-  std::vector<K> keys;
-  keys.reserve(map.size());
-  for (const auto &[key, _] : map)
-    keys.push_back(key);
-  return keys;
+/// @brief A lazy view of a map's values (an alternative to std::views::values),
+/// mutable when the map is
+template <PairRange Map> auto values(Map &map) -> ValuesView<Map> {
+  return ValuesView<Map>(map);
 }
 
+/// @brief Copies a range (e.g. `keys(map)`) into a std::vector, for when a
+/// snapshot really is needed
+template <std::ranges::input_range R>
+auto collect(R &&range) -> std::vector<std::ranges::range_value_t<R>> {
+  std::vector<std::ranges::range_value_t<R>> result;
+  if constexpr (std::ranges::sized_range<R>)
+    result.reserve(std::ranges::size(range));
+  for (auto &&element : range)
+    result.push_back(element);
+  return result;
+}
+
+/// @brief A monostate / nil state type for TaggedUnion
+struct NilTag_t {
+  constexpr auto operator==(const NilTag_t &) const -> bool { return true; }
+};
+const NilTag_t NilTag = {};
+
+namespace detail {
+
+/// @brief Storage for one of Ts (or nothing), usable in constant expressions
+template <typename... Ts> union UnionStorage;
+
+template <> union UnionStorage<> {};
+
+template <typename T, typename... Rest> union UnionStorage<T, Rest...> {
+  T head;
+  UnionStorage<Rest...> tail;
+
+  constexpr UnionStorage() : tail() {}
+
+  constexpr ~UnionStorage()
+    requires(std::is_trivially_destructible_v<T> &&
+             (std::is_trivially_destructible_v<Rest> && ...))
+  = default;
+  constexpr ~UnionStorage() {}
+
+  template <usize I> constexpr auto get() -> auto & {
+    if constexpr (I == 0)
+      return head;
+    else
+      return tail.template get<I - 1>();
+  }
+
+  template <usize I> constexpr auto get() const -> const auto & {
+    if constexpr (I == 0)
+      return head;
+    else
+      return tail.template get<I - 1>();
+  }
+};
+
+template <typename T, typename... Ts> constexpr auto indexOf() -> usize {
+  usize index = 0;
+  bool found = false;
+  ((found = found || std::is_same_v<T, Ts>, index += found ? 0 : 1), ...);
+  return index;
+}
+
+} // namespace detail
+
 /// @brief A "tagged union"-like type that can be used to create dynamic tagged
-/// unions
+/// unions. It is either empty or holds exactly one of Ts, and the tag is the
+/// smallest unsigned type that can number the alternatives. When every
+/// alternative is trivially copyable the union is too (copies are memcpys).
+/// visit() dispatches through a switch, which compiles to a jump table
 template <typename... Ts> class TaggedUnion {
-  u64 tag;
-  union {
-    std::aligned_union_t<0, Ts...> data;
-    std::byte dummy;
-  };
+  static_assert(sizeof...(Ts) > 0, "TaggedUnion needs at least one type");
+  static_assert(sizeof...(Ts) < 65535, "TaggedUnion has too many types");
+
+  using Tag = std::conditional_t<(sizeof...(Ts) < 255), u8, u16>;
+  using Storage = detail::UnionStorage<Ts...>;
+
+  static constexpr bool kTriviallyCopyable =
+      (std::is_trivially_copyable_v<Ts> && ...);
+  static constexpr bool kTriviallyDestructible =
+      (std::is_trivially_destructible_v<Ts> && ...);
+
+  Storage _storage;
+  Tag _tag = 0; // 0 is empty, I + 1 holds the I-th type
+
+  template <typename T> static constexpr usize kIndex = detail::indexOf<T, Ts...>();
+
+  template <typename T>
+  static constexpr bool kHolds = kIndex<std::remove_cvref_t<T>> < sizeof...(Ts);
+
+  template <usize I>
+  using Alternative = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+  template <typename Self, typename F>
+  using VisitResult = std::invoke_result_t<
+      F, decltype(std::declval<Self &>()._storage.template get<0>())>;
+
+  template <usize I, typename Self, typename F>
+  static constexpr auto visitAt(Self &self, F &&fn) -> VisitResult<Self, F> {
+    if constexpr (I == 0) {
+      if constexpr (std::is_invocable_v<F, const NilTag_t &>)
+        return std::invoke(std::forward<F>(fn), NilTag);
+      else
+        throw std::runtime_error("TaggedUnion is empty");
+    } else {
+      return std::invoke(std::forward<F>(fn),
+                         self._storage.template get<I - 1>());
+    }
+  }
 
-public:
-  TaggedUnion() : tag(0), dummy{} {}
+  template <typename Self, typename F, usize... Is>
+  static constexpr auto visitTable(Self &self, F &&fn,
+                                   std::index_sequence<Is...>)
+      -> VisitResult<Self, F> {
+    constexpr VisitResult<Self, F> (*table[])(Self &, F &&) = {
+        &visitAt<Is, Self, F>...};
+    return table[self._tag](self, std::forward<F>(fn));
+  }
 
-  template <typename T> TaggedUnion(T &&value) : tag(1), dummy{} {
-    static_assert((std::is_same_v<T, Ts> || ...));
-    new (&data) std::decay_t<T>(std::forward<T>(value));
+  template <typename Self, typename F>
+  static constexpr auto visitImpl(Self &self, F &&fn) -> VisitResult<Self, F> {
+    constexpr usize kLast = sizeof...(Ts);
+    if constexpr (kLast < 16) {
+      // Cases past the last alternative are never taken, they only exist so
+      // the switch can be written out once
+#define ROOTS_TAGGED_UNION_CASE(I)                                             \
+  case I:                                                                      \
+    return visitAt<(I < kLast ? I : kLast)>(self, std::forward<F>(fn))
+      switch (self._tag) {
+        ROOTS_TAGGED_UNION_CASE(0);
+        ROOTS_TAGGED_UNION_CASE(1);
+        ROOTS_TAGGED_UNION_CASE(2);
+        ROOTS_TAGGED_UNION_CASE(3);
+        ROOTS_TAGGED_UNION_CASE(4);
+        ROOTS_TAGGED_UNION_CASE(5);
+        ROOTS_TAGGED_UNION_CASE(6);
+        ROOTS_TAGGED_UNION_CASE(7);
+        ROOTS_TAGGED_UNION_CASE(8);
+        ROOTS_TAGGED_UNION_CASE(9);
+        ROOTS_TAGGED_UNION_CASE(10);
+        ROOTS_TAGGED_UNION_CASE(11);
+        ROOTS_TAGGED_UNION_CASE(12);
+        ROOTS_TAGGED_UNION_CASE(13);
+        ROOTS_TAGGED_UNION_CASE(14);
+        ROOTS_TAGGED_UNION_CASE(15);
+      default:
+        ROOTS_UNREACHABLE;
+      }
+#undef ROOTS_TAGGED_UNION_CASE
+    } else {
+      return visitTable(self, std::forward<F>(fn),
+                        std::make_index_sequence<kLast + 1>());
+    }
   }
 
-  TaggedUnion(const TaggedUnion &other) : tag(other.tag), dummy{} {
-    if (tag != 0)
-      new (&data) std::decay_t<decltype(other.data)>(other.data);
+  template <usize I, typename... Args>
+  constexpr auto construct(Args &&...args) -> void {
+    std::construct_at(&_storage.template get<I>(), std::forward<Args>(args)...);
+    _tag = static_cast<Tag>(I + 1);
   }
-  
-  TaggedUnion(TaggedUnion &&other) : tag(other.tag), dummy{} {
-    if (tag != 0)
-      new (&data) std::decay_t<decltype(other.data)>(std::move(other.data));
+
+  // Builds this (currently empty) union from other's active alternative
+  template <typename Other> constexpr auto constructFrom(Other &&other) -> void {
+    if (other._tag == 0)
+      return;
+    std::forward<Other>(other).visit([this](auto &&value) {
+      using T = std::remove_cvref_t<decltype(value)>;
+      if constexpr (!std::is_same_v<T, NilTag_t>)
+        construct<kIndex<T>>(std::forward<decltype(value)>(value));
+    });
   }
 
-  ~TaggedUnion() {
-    if (tag != 0)
-      reinterpret_cast<std::decay_t<decltype(data)> *>(&data)->~decltype(data)();
+  template <typename Other> constexpr auto assignFrom(Other &&other) -> void {
+    if (_tag == other._tag && _tag != 0) {
+      std::forward<Other>(other).visit([this](auto &&value) {
+        using T = std::remove_cvref_t<decltype(value)>;
+        if constexpr (!std::is_same_v<T, NilTag_t>)
+          _storage.template get<kIndex<T>>() =
+              std::forward<decltype(value)>(value);
+      });
+      return;
+    }
+    clear();
+    constructFrom(std::forward<Other>(other));
   }
 
-  auto operator=(const TaggedUnion &other) -> TaggedUnion & {
-    if (tag != 0)
-      reinterpret_cast<std::decay_t<decltype(data)> *>(&data)->~decltype(data)();
-    tag = other.tag;
-    if (tag != 0)
-      new (&data) std::decay_t<decltype(other.data)>(other.data);
+public:
+  static constexpr usize npos = static_cast<usize>(-1);
+
+  constexpr TaggedUnion() = default;
+
+  template <typename T>
+    requires(kHolds<T> && !std::is_same_v<std::remove_cvref_t<T>, TaggedUnion>)
+  constexpr TaggedUnion(T &&value) {
+    construct<kIndex<std::remove_cvref_t<T>>>(std::forward<T>(value));
+  }
+
+  template <typename T, typename... Args>
+    requires kHolds<T>
+  constexpr explicit TaggedUnion(std::in_place_type_t<T>, Args &&...args) {
+    construct<kIndex<T>>(std::forward<Args>(args)...);
+  }
+
+  constexpr TaggedUnion(NilTag_t) {}
+
+  constexpr TaggedUnion(const TaggedUnion &)
+    requires kTriviallyCopyable
+  = default;
+  constexpr TaggedUnion(const TaggedUnion &other) { constructFrom(other); }
+
+  constexpr TaggedUnion(TaggedUnion &&)
+    requires kTriviallyCopyable
+  = default;
+  constexpr TaggedUnion(TaggedUnion &&other) noexcept(
+      (std::is_nothrow_move_constructible_v<Ts> && ...)) {
+    constructFrom(std::move(other));
+  }
+
+  constexpr ~TaggedUnion()
+    requires kTriviallyDestructible
+  = default;
+  constexpr ~TaggedUnion() { clear(); }
+
+  constexpr auto operator=(const TaggedUnion &) -> TaggedUnion &
+    requires kTriviallyCopyable
+  = default;
+  constexpr auto operator=(const TaggedUnion &other) -> TaggedUnion & {
+    if (this != &other)
+      assignFrom(other);
     return *this;
   }
 
-  auto operator=(TaggedUnion &&other) -> TaggedUnion & {
-    if (tag != 0)
-      reinterpret_cast<std::decay_t<decltype(data)> *>(&data)->~decltype(data)();
-    tag = other.tag;
-    if (tag != 0)
-      new (&data) std::decay_t<decltype(other.data)>(std::move(other.data));
+  constexpr auto operator=(TaggedUnion &&) -> TaggedUnion &
+    requires kTriviallyCopyable
+  = default;
+  constexpr auto operator=(TaggedUnion &&other) -> TaggedUnion & {
+    if (this != &other)
+      assignFrom(std::move(other));
     return *this;
   }
 
-  template<typename T>
-  auto get() -> T& {
-    static_assert((std::is_same_v<T, Ts> || ...));
-    if (tag != 0)
-      return *reinterpret_cast<T*>(&data);
-    else
-      throw std::runtime_error("TaggedUnion is empty");
+  /// @brief The index of the held type in Ts, or npos when empty
+  constexpr auto index() const -> usize {
+    return _tag == 0 ? npos : static_cast<usize>(_tag - 1);
   }
 
-  template<typename T>
-  auto get() const -> const T& {
-    static_assert((std::is_same_v<T, Ts> || ...));
-    if (tag != 0)
-      return *reinterpret_cast<const T*>(&data);
-    else
-      throw std::runtime_error("TaggedUnion is empty");
+  constexpr auto empty() const -> bool { return _tag == 0; }
+
+  template <typename T> constexpr auto is() const -> bool {
+    static_assert(kHolds<T>, "T is not one of the union's types");
+    return _tag == kIndex<T> + 1;
+  }
+
+  template <typename T> constexpr auto get() -> T & {
+    if (!is<T>())
+      throw std::runtime_error(_tag == 0 ? "TaggedUnion is empty"
+                                         : "TaggedUnion holds another type");
+    return _storage.template get<kIndex<T>>();
   }
 
-  template<typename T>
-  auto is() const -> bool {
-    static_assert((std::is_same_v<T, Ts> || ...));
-    return tag == 0;
+  template <typename T> constexpr auto get() const -> const T & {
+    if (!is<T>())
+      throw std::runtime_error(_tag == 0 ? "TaggedUnion is empty"
+                                         : "TaggedUnion holds another type");
+    return _storage.template get<kIndex<T>>();
   }
 
-  template<typename T>
-  auto set(T&& value) -> void {
-    static_assert((std::is_same_v<T, Ts> || ...));
-    if (tag != 0)
-      reinterpret_cast<std::decay_t<decltype(data)> *>(&data)->~decltype(data)();
-    tag = 1;
-    new (&data) std::decay_t<T>(std::forward<T>(value));
+  /// @brief A pointer to the value if it holds a T, nullptr otherwise
+  template <typename T> constexpr auto getIf() -> T * {
+    return is<T>() ? &_storage.template get<kIndex<T>>() : nullptr;
   }
 
-  auto clear() -> void {
-    if (tag != 0)
-      reinterpret_cast<std::decay_t<decltype(data)> *>(&data)->~decltype(data)();
-    tag = 0;
+  template <typename T> constexpr auto getIf() const -> const T * {
+    return is<T>() ? &_storage.template get<kIndex<T>>() : nullptr;
   }
 
-  auto operator==(const TaggedUnion& other) const -> bool {
-    if (tag != other.tag)
+  template <typename T>
+    requires kHolds<T>
+  constexpr auto set(T &&value) -> void {
+    using U = std::remove_cvref_t<T>;
+    if (is<U>()) {
+      _storage.template get<kIndex<U>>() = std::forward<T>(value);
+      return;
+    }
+    clear();
+    construct<kIndex<U>>(std::forward<T>(value));
+  }
+
+  template <typename T, typename... Args>
+    requires kHolds<T>
+  constexpr auto emplace(Args &&...args) -> T & {
+    clear();
+    construct<kIndex<T>>(std::forward<Args>(args)...);
+    return _storage.template get<kIndex<T>>();
+  }
+
+  constexpr auto clear() -> void {
+    if constexpr (!kTriviallyDestructible) {
+      if (_tag != 0) {
+        visit([](auto &value) {
+          using T = std::remove_cvref_t<decltype(value)>;
+          if constexpr (!std::is_same_v<T, NilTag_t>)
+            std::destroy_at(&value);
+        });
+      }
+    }
+    _tag = 0;
+  }
+
+  /// @brief Calls fn with the held value. When empty, fn is called with
+  /// NilTag if it accepts it, otherwise std::runtime_error is thrown
+  template <typename F> constexpr auto visit(F &&fn) & -> decltype(auto) {
+    return visitImpl(*this, std::forward<F>(fn));
+  }
+
+  template <typename F> constexpr auto visit(F &&fn) const & -> decltype(auto) {
+    return visitImpl(*this, std::forward<F>(fn));
+  }
+
+  template <typename F> constexpr auto visit(F &&fn) && -> decltype(auto) {
+    return visitImpl(*this, [&fn](auto &value) -> decltype(auto)
+                       requires std::is_invocable_v<F, decltype(std::move(value))>
+                     { return std::invoke(std::forward<F>(fn), std::move(value)); });
+  }
+
+  constexpr auto swap(TaggedUnion &other) -> void {
+    TaggedUnion tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  constexpr auto operator==(const TaggedUnion &other) const -> bool {
+    if (_tag != other._tag)
       return false;
-    if (tag == 0)
-      return true;
-    return data == other.data;
+    return visit([&other](const auto &value) {
+      using T = std::remove_cvref_t<decltype(value)>;
+      if constexpr (std::is_same_v<T, NilTag_t>)
+        return true;
+      else
+        return value == other._storage.template get<kIndex<T>>();
+    });
   }
 
-  auto operator!=(const TaggedUnion& other) const -> bool {
+  constexpr auto operator!=(const TaggedUnion &other) const -> bool {
     return !(*this == other);
   }
 };
 
-/// @brief A monostate / nil state type for TaggedUnion
-struct NilTag_t {};
-const NilTag_t NilTag = {};
-
 } // namespace roots::structures
 
 #endif
@@ -0,0 +1,1115 @@
+#ifndef Roots_Structures_BTree_hpp
+#define Roots_Structures_BTree_hpp
+
+#include "../_defines.hpp"
+#include "FlatMap.hpp"
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace roots::structures {
+
+namespace detail {
+
+/// @brief Value type of the maps underlying BTreeSet; takes no space in nodes
+struct BTreeNoValue {
+  auto operator==(const BTreeNoValue &) const -> bool { return true; }
+};
+
+template <typename V, usize N> struct BTreeValues {
+  V data[N];
+
+  auto operator[](usize i) -> V & { return data[i]; }
+  auto operator[](usize i) const -> const V & { return data[i]; }
+};
+
+template <usize N> struct BTreeValues<BTreeNoValue, N> {
+  static inline BTreeNoValue none;
+
+  auto operator[](usize) const -> BTreeNoValue & { return none; }
+};
+
+template <typename C, typename K>
+concept NaturalOrder =
+    std::is_same_v<C, std::less<>> || std::is_same_v<C, std::less<K>>;
+
+/// @brief Integer keys ordered by operator< can be searched with SIMD
+/// compares: the lower bound in a sorted node is the number of keys < key
+template <typename K, typename C, typename Q>
+concept SimdSearchable = std::is_integral_v<K> && std::is_same_v<K, Q> &&
+                         (sizeof(K) == 4 || sizeof(K) == 8) &&
+                         NaturalOrder<C, K>;
+
+/// @brief Index of the first of the `count` sorted keys that is not less
+/// than `key`
+template <typename K, typename Q, typename C>
+auto nodeLowerIndex(const K *keys, usize count, const Q &key, const C &comp)
+    -> usize {
+  if constexpr (SimdSearchable<K, C, Q>) {
+    // Compare as signed; flipping the sign bit maps unsigned order onto it
+    using S = std::make_signed_t<K>;
+    constexpr K kBias =
+        std::is_signed_v<K> ? K(0) : K(K(1) << (sizeof(K) * 8 - 1));
+    usize less = 0;
+    usize i = 0;
+#if defined(__AVX2__)
+    if constexpr (sizeof(K) == 8) {
+      __m256i needle = _mm256_set1_epi64x(static_cast<i64>(key ^ kBias));
+      __m256i bias = _mm256_set1_epi64x(static_cast<i64>(kBias));
+      for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)),
+            bias);
+        __m256i lt = _mm256_cmpgt_epi64(needle, v);
+        less += static_cast<usize>(
+            std::popcount(static_cast<u32>(_mm256_movemask_pd(_mm256_castsi256_pd(lt)))));
+      }
+    } else {
+      __m256i needle = _mm256_set1_epi32(static_cast<i32>(key ^ kBias));
+      __m256i bias = _mm256_set1_epi32(static_cast<i32>(kBias));
+      for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)),
+            bias);
+        __m256i lt = _mm256_cmpgt_epi32(needle, v);
+        less += static_cast<usize>(
+            std::popcount(static_cast<u32>(_mm256_movemask_ps(_mm256_castsi256_ps(lt)))));
+      }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    // SSE2 has no 64-bit compare; 32-bit keys still go four at a time
+    if constexpr (sizeof(K) == 4) {
+      __m128i needle = _mm_set1_epi32(static_cast<i32>(key ^ kBias));
+      __m128i bias = _mm_set1_epi32(static_cast<i32>(kBias));
+      for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_xor_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i)), bias);
+        __m128i lt = _mm_cmpgt_epi32(needle, v);
+        less += static_cast<usize>(
+            std::popcount(static_cast<u32>(_mm_movemask_ps(_mm_castsi128_ps(lt)))));
+      }
+    }
+#endif
+    for (; i < count; ++i)
+      less += static_cast<S>(keys[i] ^ kBias) < static_cast<S>(key ^ kBias);
+    return less;
+  } else if constexpr (std::is_arithmetic_v<K> && NaturalOrder<C, K>) {
+    usize less = 0;
+    for (usize i = 0; i < count; ++i)
+      less += keys[i] < key;
+    return less;
+  } else {
+    return static_cast<usize>(branchlessLowerBound(keys, count, key, comp) -
+                              keys);
+  }
+}
+
+} // namespace detail
+
+/// @brief An ordered map stored as a B+ tree. Nodes are sized to a few cache
+/// lines (NodeBytes), so a lookup touches a handful of cache lines instead of
+/// one per level like std::map, and the sorted keys within a node are
+/// searched with SIMD compares for integer keys. Entries live in the leaves,
+/// which are linked for fast in-order and range iteration.
+///
+/// K and V must be default constructible and movable. Unlike std::map, any
+/// insert or erase invalidates iterators and references
+template <typename K, typename V, typename C = std::less<>,
+          usize NodeBytes = 256>
+class BTreeMap {
+  static constexpr bool kIsSet = std::is_same_v<V, detail::BTreeNoValue>;
+  static constexpr usize kValueBytes = kIsSet ? 0 : sizeof(V);
+
+public:
+  /// @brief Entries per leaf and keys per internal node
+  static constexpr usize kLeafSlots = std::clamp<usize>(
+      (NodeBytes - 3 * sizeof(void *)) / (sizeof(K) + kValueBytes), 4, 256);
+  static constexpr usize kInternalSlots = std::clamp<usize>(
+      (NodeBytes - 2 * sizeof(void *)) / (sizeof(K) + sizeof(void *)), 4, 256);
+
+private:
+  static constexpr usize kMinLeaf = kLeafSlots / 2;
+  static constexpr usize kMinInternal = kInternalSlots / 2;
+  static constexpr usize kMaxDepth = 64;
+
+  struct Node {
+    u16 count = 0;
+    bool leaf = true;
+  };
+
+  struct alignas(kRootsCacheLineSize) Leaf : Node {
+    Leaf *prev = nullptr;
+    Leaf *next = nullptr;
+    K keys[kLeafSlots];
+    [[no_unique_address]] detail::BTreeValues<V, kLeafSlots> values;
+  };
+
+  struct alignas(kRootsCacheLineSize) Internal : Node {
+    K keys[kInternalSlots];
+    Node *children[kInternalSlots + 1];
+
+    Internal() { this->leaf = false; }
+  };
+
+  struct PathEntry {
+    Internal *node;
+    usize child;
+  };
+
+  Node *_root = nullptr;
+  Leaf *_first = nullptr;
+  Leaf *_last = nullptr;
+  usize _size = 0;
+  usize _depth = 0; // internal levels above the leaves
+  [[no_unique_address]] C _comp;
+
+  static auto asLeaf(Node *node) -> Leaf * { return static_cast<Leaf *>(node); }
+  static auto asInternal(Node *node) -> Internal * {
+    return static_cast<Internal *>(node);
+  }
+
+  template <typename Q>
+  auto lowerIndex(const K *keys, usize count, const Q &key) const -> usize {
+    return detail::nodeLowerIndex(keys, count, key, _comp);
+  }
+
+  /// @brief The child of an internal node whose range holds `key`
+  template <typename Q>
+  auto childIndex(const Internal *node, const Q &key) const -> usize {
+    usize i = lowerIndex(node->keys, node->count, key);
+    if (i < node->count && !_comp(key, node->keys[i]))
+      ++i;
+    return i;
+  }
+
+  template <typename Q> auto findLeaf(const Q &key) const -> Leaf * {
+    Node *node = _root;
+    for (usize level = 0; level < _depth; ++level) {
+      Internal *in = asInternal(node);
+      node = in->children[childIndex(in, key)];
+    }
+    return asLeaf(node);
+  }
+
+  template <typename Q>
+  auto findLeaf(const Q &key, PathEntry *path) const -> Leaf * {
+    Node *node = _root;
+    for (usize level = 0; level < _depth; ++level) {
+      Internal *in = asInternal(node);
+      usize child = childIndex(in, key);
+      path[level] = {in, child};
+      node = in->children[child];
+    }
+    return asLeaf(node);
+  }
+
+  static auto destroy(Node *node, usize depth) -> void {
+    if (depth == 0) {
+      delete asLeaf(node);
+      return;
+    }
+    Internal *in = asInternal(node);
+    for (usize i = 0; i <= in->count; ++i)
+      destroy(in->children[i], depth - 1);
+    delete in;
+  }
+
+  /// @brief Builds the tree from `count` sorted, unique entries
+  template <typename It> auto bulkLoad(It it, usize count) -> void {
+    clear();
+    if (count == 0)
+      return;
+
+    std::vector<std::pair<Node *, K>> level;
+    usize leaves = (count + kLeafSlots - 1) / kLeafSlots;
+    level.reserve(leaves);
+    Leaf *prev = nullptr;
+    for (usize j = 0; j < leaves; ++j) {
+      usize n = count / leaves + (j < count % leaves ? 1 : 0);
+      Leaf *leaf = new Leaf();
+      for (usize i = 0; i < n; ++i, ++it) {
+        // Sets load plain keys; maps (and set copies) load pair-likes
+        auto &&entry = *it;
+        using Entry = std::remove_cvref_t<decltype(entry)>;
+        if constexpr (kIsSet && std::is_convertible_v<const Entry &, const K &>) {
+          leaf->keys[i] = entry;
+        } else {
+          leaf->keys[i] = entry.first;
+          if constexpr (!kIsSet)
+            leaf->values[i] = entry.second;
+        }
+      }
+      leaf->count = static_cast<u16>(n);
+      leaf->prev = prev;
+      (prev ? prev->next : _first) = leaf;
+      prev = leaf;
+      level.emplace_back(leaf, leaf->keys[0]);
+    }
+    _last = prev;
+
+    // Each internal level spreads its children evenly over as few nodes as
+    // fit, using each child's smallest key as the separator before it
+    while (level.size() > 1) {
+      std::vector<std::pair<Node *, K>> parents;
+      usize groups = (level.size() + kInternalSlots) / (kInternalSlots + 1);
+      usize k = 0;
+      for (usize g = 0; g < groups; ++g) {
+        usize n = level.size() / groups + (g < level.size() % groups ? 1 : 0);
+        Internal *in = new Internal();
+        for (usize i = 0; i < n; ++i) {
+          in->children[i] = level[k + i].first;
+          if (i != 0)
+            in->keys[i - 1] = std::move(level[k + i].second);
+        }
+        in->count = static_cast<u16>(n - 1);
+        parents.emplace_back(in, std::move(level[k].second));
+        k += n;
+      }
+      level = std::move(parents);
+      ++_depth;
+    }
+    _root = level[0].first;
+    _size = count;
+  }
+
+  /// @brief Splits a full leaf, returning the new right half
+  auto splitLeaf(Leaf *leaf) -> Leaf * {
+    Leaf *right = new Leaf();
+    usize keep = kLeafSlots / 2;
+    usize moved = kLeafSlots - keep;
+    std::move(leaf->keys + keep, leaf->keys + kLeafSlots, right->keys);
+    if constexpr (!kIsSet)
+      std::move(leaf->values.data + keep, leaf->values.data + kLeafSlots,
+                right->values.data);
+    leaf->count = static_cast<u16>(keep);
+    right->count = static_cast<u16>(moved);
+    right->prev = leaf;
+    right->next = leaf->next;
+    (leaf->next ? leaf->next->prev : _last) = right;
+    leaf->next = right;
+    return right;
+  }
+
+  static auto insertChild(Internal *in, usize at, K key, Node *child) -> void {
+    std::move_backward(in->keys + at, in->keys + in->count,
+                       in->keys + in->count + 1);
+    std::move_backward(in->children + at + 1, in->children + in->count + 1,
+                       in->children + in->count + 2);
+    in->keys[at] = std::move(key);
+    in->children[at + 1] = child;
+    ++in->count;
+  }
+
+  /// @brief Adds (key, child) to the node at path[level - 1], right of the
+  /// child the path went through, splitting full nodes upwards and growing a
+  /// new root once level reaches 0
+  auto insertUpwards(PathEntry *path, usize level, K key, Node *child)
+      -> void {
+    while (true) {
+      if (level == 0) {
+        Internal *root = new Internal();
+        root->children[0] = _root;
+        root->children[1] = child;
+        root->keys[0] = std::move(key);
+        root->count = 1;
+        _root = root;
+        ++_depth;
+        return;
+      }
+      PathEntry &entry = path[level - 1];
+      Internal *in = entry.node;
+      if (in->count < kInternalSlots) {
+        insertChild(in, entry.child, std::move(key), child);
+        return;
+      }
+
+      // Split around the middle key, which moves up a level
+      usize mid = kInternalSlots / 2;
+      Internal *right = new Internal();
+      K up = std::move(in->keys[mid]);
+      std::move(in->keys + mid + 1, in->keys + kInternalSlots, right->keys);
+      std::copy(in->children + mid + 1, in->children + kInternalSlots + 1,
+                right->children);
+      right->count = static_cast<u16>(kInternalSlots - mid - 1);
+      in->count = static_cast<u16>(mid);
+      if (entry.child <= mid)
+        insertChild(in, entry.child, std::move(key), child);
+      else
+        insertChild(right, entry.child - mid - 1, std::move(key), child);
+
+      key = std::move(up);
+      child = right;
+      --level;
+    }
+  }
+
+  /// @brief Inserts key at `pos` in a leaf known to have room
+  template <typename KK, typename... Args>
+  static auto leafInsert(Leaf *leaf, usize pos, KK &&key, Args &&...args)
+      -> void {
+    std::move_backward(leaf->keys + pos, leaf->keys + leaf->count,
+                       leaf->keys + leaf->count + 1);
+    leaf->keys[pos] = std::forward<KK>(key);
+    if constexpr (!kIsSet) {
+      std::move_backward(leaf->values.data + pos,
+                         leaf->values.data + leaf->count,
+                         leaf->values.data + leaf->count + 1);
+      leaf->values[pos] = V(std::forward<Args>(args)...);
+    }
+    ++leaf->count;
+  }
+
+  struct EmplaceResult {
+    Leaf *leaf;
+    usize index;
+    bool inserted;
+  };
+
+  template <typename KK, typename... Args>
+  auto emplaceKey(KK &&key, Args &&...args) -> EmplaceResult {
+    if (_root == nullptr) {
+      _first = _last = new Leaf();
+      _root = _first;
+    }
+    PathEntry path[kMaxDepth];
+    Leaf *leaf = findLeaf(key, path);
+    usize pos = lowerIndex(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && !_comp(key, leaf->keys[pos]))
+      return {leaf, pos, false};
+
+    if (leaf->count == kLeafSlots) {
+      Leaf *right = splitLeaf(leaf);
+      if (pos > leaf->count) {
+        pos -= leaf->count;
+        leaf = right;
+      }
+      leafInsert(leaf, pos, std::forward<KK>(key), std::forward<Args>(args)...);
+      insertUpwards(path, _depth, right->keys[0], right);
+    } else {
+      leafInsert(leaf, pos, std::forward<KK>(key), std::forward<Args>(args)...);
+    }
+    ++_size;
+    return {leaf, pos, true};
+  }
+
+  static auto removeChild(Internal *in, usize keyIndex) -> void {
+    // Removes keys[keyIndex] and the child to its right
+    std::move(in->keys + keyIndex + 1, in->keys + in->count,
+              in->keys + keyIndex);
+    std::copy(in->children + keyIndex + 2, in->children + in->count + 1,
+              in->children + keyIndex + 1);
+    --in->count;
+  }
+
+  auto fixLeaf(Leaf *leaf, PathEntry *path, usize level) -> void {
+    Internal *parent = path[level - 1].node;
+    usize i = path[level - 1].child;
+    Leaf *left = i > 0 ? asLeaf(parent->children[i - 1]) : nullptr;
+    Leaf *right = i < parent->count ? asLeaf(parent->children[i + 1]) : nullptr;
+
+    if (left && left->count > kMinLeaf) {
+      std::move_backward(leaf->keys, leaf->keys + leaf->count,
+                         leaf->keys + leaf->count + 1);
+      leaf->keys[0] = std::move(left->keys[left->count - 1]);
+      if constexpr (!kIsSet) {
+        std::move_backward(leaf->values.data, leaf->values.data + leaf->count,
+                           leaf->values.data + leaf->count + 1);
+        leaf->values[0] = std::move(left->values[left->count - 1]);
+      }
+      --left->count;
+      ++leaf->count;
+      parent->keys[i - 1] = leaf->keys[0];
+      return;
+    }
+    if (right && right->count > kMinLeaf) {
+      leaf->keys[leaf->count] = std::move(right->keys[0]);
+      std::move(right->keys + 1, right->keys + right->count, right->keys);
+      if constexpr (!kIsSet) {
+        leaf->values[leaf->count] = std::move(right->values[0]);
+        std::move(right->values.data + 1, right->values.data + right->count,
+                  right->values.data);
+      }
+      ++leaf->count;
+      --right->count;
+      parent->keys[i] = right->keys[0];
+      return;
+    }
+
+    // Merge with a sibling, always folding the right node into the left one
+    if (left) {
+      mergeLeaves(left, leaf);
+      removeChild(parent, i - 1);
+    } else {
+      mergeLeaves(leaf, right);
+      removeChild(parent, i);
+    }
+    fixInternal(parent, path, level - 1);
+  }
+
+  auto mergeLeaves(Leaf *left, Leaf *right) -> void {
+    std::move(right->keys, right->keys + right->count,
+              left->keys + left->count);
+    if constexpr (!kIsSet)
+      std::move(right->values.data, right->values.data + right->count,
+                left->values.data + left->count);
+    left->count = static_cast<u16>(left->count + right->count);
+    left->next = right->next;
+    (right->next ? right->next->prev : _last) = left;
+    delete right;
+  }
+
+  auto fixInternal(Internal *node, PathEntry *path, usize level) -> void {
+    if (level == 0) {
+      // The root may shrink to a single child, which then becomes the root
+      if (node->count == 0) {
+        _root = node->children[0];
+        --_depth;
+        delete node;
+      }
+      return;
+    }
+    if (node->count >= kMinInternal)
+      return;
+
+    Internal *parent = path[level - 1].node;
+    usize i = path[level - 1].child;
+    Internal *left = i > 0 ? asInternal(parent->children[i - 1]) : nullptr;
+    Internal *right =
+        i < parent->count ? asInternal(parent->children[i + 1]) : nullptr;
+
+    if (left && left->count > kMinInternal) {
+      std::move_backward(node->keys, node->keys + node->count,
+                         node->keys + node->count + 1);
+      std::copy_backward(node->children, node->children + node->count + 1,
+                         node->children + node->count + 2);
+      node->keys[0] = std::move(parent->keys[i - 1]);
+      node->children[0] = left->children[left->count];
+      parent->keys[i - 1] = std::move(left->keys[left->count - 1]);
+      --left->count;
+      ++node->count;
+      return;
+    }
+    if (right && right->count > kMinInternal) {
+      node->keys[node->count] = std::move(parent->keys[i]);
+      node->children[node->count + 1] = right->children[0];
+      parent->keys[i] = std::move(right->keys[0]);
+      std::move(right->keys + 1, right->keys + right->count, right->keys);
+      std::copy(right->children + 1, right->children + right->count + 1,
+                right->children);
+      --right->count;
+      ++node->count;
+      return;
+    }
+
+    if (left) {
+      mergeInternals(left, parent->keys[i - 1], node);
+      removeChild(parent, i - 1);
+    } else {
+      mergeInternals(node, parent->keys[i], right);
+      removeChild(parent, i);
+    }
+    fixInternal(parent, path, level - 1);
+  }
+
+  static auto mergeInternals(Internal *left, K &separator, Internal *right)
+      -> void {
+    left->keys[left->count] = std::move(separator);
+    std::move(right->keys, right->keys + right->count,
+              left->keys + left->count + 1);
+    std::copy(right->children, right->children + right->count + 1,
+              left->children + left->count + 1);
+    left->count = static_cast<u16>(left->count + 1 + right->count);
+    delete right;
+  }
+
+  template <typename Q> auto eraseKey(const Q &key) -> usize {
+    if (_root == nullptr)
+      return 0;
+    PathEntry path[kMaxDepth];
+    Leaf *leaf = findLeaf(key, path);
+    usize pos = lowerIndex(leaf->keys, leaf->count, key);
+    if (pos == leaf->count || _comp(key, leaf->keys[pos]))
+      return 0;
+
+    std::move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+    if constexpr (!kIsSet)
+      std::move(leaf->values.data + pos + 1, leaf->values.data + leaf->count,
+                leaf->values.data + pos);
+    --leaf->count;
+    --_size;
+
+    if (_depth == 0) {
+      if (leaf->count == 0) {
+        delete leaf;
+        _root = _first = _last = nullptr;
+      }
+    } else if (leaf->count < kMinLeaf) {
+      fixLeaf(leaf, path, _depth);
+    }
+    return 1;
+  }
+
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  using size_type = usize;
+  using difference_type = isize;
+  using key_compare = C;
+
+  /// @brief A bidirectional iterator over (key, value) entries in key order.
+  /// Dereferences to a pair of references, like FlatMap's iterators
+  template <bool Const> class Iterator {
+    friend class BTreeMap;
+    template <bool> friend class Iterator;
+    using Value = std::conditional_t<Const, const V, V>;
+
+    Leaf *_leaf = nullptr;
+    usize _index = 0;
+
+    Iterator(Leaf *leaf, usize index) : _leaf(leaf), _index(index) {}
+
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::pair<K, V>;
+    using difference_type = isize;
+    using reference = std::pair<const K &, Value &>;
+
+    struct pointer {
+      reference ref;
+      auto operator->() -> reference * { return &ref; }
+    };
+
+    Iterator() = default;
+
+    template <bool C2 = Const, typename = std::enable_if_t<C2>>
+    Iterator(const Iterator<false> &other)
+        : _leaf(other._leaf), _index(other._index) {}
+
+    auto operator*() const -> reference {
+      return {_leaf->keys[_index], _leaf->values[_index]};
+    }
+    auto operator->() const -> pointer { return {**this}; }
+
+    auto key() const -> const K & { return _leaf->keys[_index]; }
+    auto value() const -> Value & { return _leaf->values[_index]; }
+
+    auto operator++() -> Iterator & {
+      if (++_index == _leaf->count && _leaf->next != nullptr) {
+        _leaf = _leaf->next;
+        _index = 0;
+      }
+      return *this;
+    }
+    auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    auto operator--() -> Iterator & {
+      if (_index == 0) {
+        _leaf = _leaf->prev;
+        _index = _leaf->count;
+      }
+      --_index;
+      return *this;
+    }
+    auto operator--(int) -> Iterator {
+      Iterator tmp = *this;
+      --*this;
+      return tmp;
+    }
+
+    auto operator==(const Iterator &other) const -> bool {
+      return _leaf == other._leaf && _index == other._index;
+    }
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+private:
+  auto makeIterator(Leaf *leaf, usize index) const -> iterator {
+    // A position one past a leaf's last entry is the start of the next leaf
+    if (leaf != nullptr && index == leaf->count && leaf->next != nullptr)
+      return iterator(leaf->next, 0);
+    return iterator(leaf, index);
+  }
+
+  template <typename Q> auto lowerBoundIt(const Q &key) const -> iterator {
+    if (_root == nullptr)
+      return iterator();
+    Leaf *leaf = findLeaf(key);
+    return makeIterator(leaf, lowerIndex(leaf->keys, leaf->count, key));
+  }
+
+  template <typename Q> auto upperBoundIt(const Q &key) const -> iterator {
+    if (_root == nullptr)
+      return iterator();
+    Leaf *leaf = findLeaf(key);
+    usize pos = lowerIndex(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && !_comp(key, leaf->keys[pos]))
+      ++pos;
+    return makeIterator(leaf, pos);
+  }
+
+  template <typename Q> auto findIt(const Q &key) const -> iterator {
+    if (_root == nullptr)
+      return iterator();
+    Leaf *leaf = findLeaf(key);
+    usize pos = lowerIndex(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && !_comp(key, leaf->keys[pos]))
+      return iterator(leaf, pos);
+    return endIt();
+  }
+
+  auto endIt() const -> iterator {
+    return iterator(_last, _last ? _last->count : 0);
+  }
+
+  template <typename KK, typename... Args>
+  auto tryEmplaceImpl(KK &&key, Args &&...args) -> std::pair<iterator, bool> {
+    auto [leaf, pos, inserted] =
+        emplaceKey(std::forward<KK>(key), std::forward<Args>(args)...);
+    return {iterator(leaf, pos), inserted};
+  }
+
+  /// @brief Sorts (key, value) entries and drops later duplicates
+  static auto normalize(std::vector<value_type> &entries, const C &comp)
+      -> void {
+    std::stable_sort(entries.begin(), entries.end(),
+                     [&comp](const value_type &a, const value_type &b) {
+                       return comp(a.first, b.first);
+                     });
+    auto last = std::unique(entries.begin(), entries.end(),
+                            [&comp](const value_type &a, const value_type &b) {
+                              return !comp(a.first, b.first);
+                            });
+    entries.erase(last, entries.end());
+  }
+
+public:
+  BTreeMap() = default;
+  explicit BTreeMap(const C &comp) : _comp(comp) {}
+
+  /// @brief Builds the map from entries in any order (the first of equal keys
+  /// wins) by sorting them and bulk loading
+  template <std::input_iterator It>
+  BTreeMap(It first, It last, const C &comp = C()) : _comp(comp) {
+    std::vector<value_type> entries(first, last);
+    normalize(entries, _comp);
+    bulkLoad(entries.begin(), entries.size());
+  }
+
+  BTreeMap(std::initializer_list<value_type> init, const C &comp = C())
+      : BTreeMap(init.begin(), init.end(), comp) {}
+
+  /// @brief Bulk loads already sorted, unique entries in O(n), packing the
+  /// leaves nearly full
+  template <std::forward_iterator It>
+  BTreeMap(SortedUnique_t, It first, It last, const C &comp = C())
+      : _comp(comp) {
+    bulkLoad(first, static_cast<usize>(std::distance(first, last)));
+  }
+
+  BTreeMap(const BTreeMap &other) : _comp(other._comp) {
+    bulkLoad(other.begin(), other.size());
+  }
+
+  BTreeMap(BTreeMap &&other) noexcept
+      : _root(std::exchange(other._root, nullptr)),
+        _first(std::exchange(other._first, nullptr)),
+        _last(std::exchange(other._last, nullptr)),
+        _size(std::exchange(other._size, 0)),
+        _depth(std::exchange(other._depth, 0)), _comp(other._comp) {}
+
+  ~BTreeMap() { clear(); }
+
+  auto operator=(const BTreeMap &other) -> BTreeMap & {
+    if (this != &other) {
+      _comp = other._comp;
+      bulkLoad(other.begin(), other.size());
+    }
+    return *this;
+  }
+
+  auto operator=(BTreeMap &&other) noexcept -> BTreeMap & {
+    if (this != &other) {
+      clear();
+      _root = std::exchange(other._root, nullptr);
+      _first = std::exchange(other._first, nullptr);
+      _last = std::exchange(other._last, nullptr);
+      _size = std::exchange(other._size, 0);
+      _depth = std::exchange(other._depth, 0);
+      _comp = other._comp;
+    }
+    return *this;
+  }
+
+  auto begin() -> iterator { return iterator(_first, 0); }
+  auto begin() const -> const_iterator { return iterator(_first, 0); }
+  auto cbegin() const -> const_iterator { return begin(); }
+  auto end() -> iterator { return endIt(); }
+  auto end() const -> const_iterator { return endIt(); }
+  auto cend() const -> const_iterator { return end(); }
+
+  auto empty() const -> bool { return _size == 0; }
+  auto size() const -> usize { return _size; }
+
+  /// @brief Levels in the tree, leaves included (0 when empty)
+  auto height() const -> usize { return _root ? _depth + 1 : 0; }
+
+  auto key_comp() const -> C { return _comp; }
+
+  auto clear() -> void {
+    if (_root != nullptr)
+      destroy(_root, _depth);
+    _root = _first = _last = nullptr;
+    _size = _depth = 0;
+  }
+
+  auto find(const K &key) -> iterator { return findIt(key); }
+  auto find(const K &key) const -> const_iterator { return findIt(key); }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto find(const Q &key) -> iterator {
+    return findIt(key);
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto find(const Q &key) const -> const_iterator {
+    return findIt(key);
+  }
+
+  auto contains(const K &key) const -> bool { return findIt(key) != endIt(); }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto contains(const Q &key) const -> bool {
+    return findIt(key) != endIt();
+  }
+
+  auto count(const K &key) const -> usize { return contains(key) ? 1 : 0; }
+
+  auto lower_bound(const K &key) -> iterator { return lowerBoundIt(key); }
+  auto lower_bound(const K &key) const -> const_iterator {
+    return lowerBoundIt(key);
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto lower_bound(const Q &key) -> iterator {
+    return lowerBoundIt(key);
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto lower_bound(const Q &key) const -> const_iterator {
+    return lowerBoundIt(key);
+  }
+
+  auto upper_bound(const K &key) -> iterator { return upperBoundIt(key); }
+  auto upper_bound(const K &key) const -> const_iterator {
+    return upperBoundIt(key);
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto upper_bound(const Q &key) -> iterator {
+    return upperBoundIt(key);
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto upper_bound(const Q &key) const -> const_iterator {
+    return upperBoundIt(key);
+  }
+
+  /// @brief The entries with keys in [low, high)
+  auto range(const K &low, const K &high) -> std::ranges::subrange<iterator> {
+    return {lowerBoundIt(low), lowerBoundIt(high)};
+  }
+
+  auto range(const K &low, const K &high) const
+      -> std::ranges::subrange<const_iterator> {
+    return {const_iterator(lowerBoundIt(low)),
+            const_iterator(lowerBoundIt(high))};
+  }
+
+  auto at(const K &key) -> V & {
+    iterator it = findIt(key);
+    if (it == endIt())
+      throw std::out_of_range("BTreeMap::at: key not found");
+    return it.value();
+  }
+
+  auto at(const K &key) const -> const V & {
+    return const_cast<BTreeMap *>(this)->at(key);
+  }
+
+  auto operator[](const K &key) -> V & { return tryEmplaceImpl(key).first.value(); }
+  auto operator[](K &&key) -> V & {
+    return tryEmplaceImpl(std::move(key)).first.value();
+  }
+
+  template <typename... Args>
+  auto try_emplace(const K &key, Args &&...args) -> std::pair<iterator, bool> {
+    return tryEmplaceImpl(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  auto try_emplace(K &&key, Args &&...args) -> std::pair<iterator, bool> {
+    return tryEmplaceImpl(std::move(key), std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  auto insert_or_assign(const K &key, M &&value) -> std::pair<iterator, bool> {
+    auto result = tryEmplaceImpl(key, std::forward<M>(value));
+    if (!result.second)
+      result.first.value() = std::forward<M>(value);
+    return result;
+  }
+
+  template <typename M>
+  auto insert_or_assign(K &&key, M &&value) -> std::pair<iterator, bool> {
+    auto result = tryEmplaceImpl(std::move(key), std::forward<M>(value));
+    if (!result.second)
+      result.first.value() = std::forward<M>(value);
+    return result;
+  }
+
+  auto insert(const value_type &entry) -> std::pair<iterator, bool> {
+    return tryEmplaceImpl(entry.first, entry.second);
+  }
+
+  auto insert(value_type &&entry) -> std::pair<iterator, bool> {
+    return tryEmplaceImpl(std::move(entry.first), std::move(entry.second));
+  }
+
+  template <std::input_iterator It> auto insert(It first, It last) -> void {
+    for (; first != last; ++first)
+      insert(*first);
+  }
+
+  auto insert(std::initializer_list<value_type> init) -> void {
+    insert(init.begin(), init.end());
+  }
+
+  template <typename... Args>
+  auto emplace(Args &&...args) -> std::pair<iterator, bool> {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  auto erase(const K &key) -> usize { return eraseKey(key); }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto erase(const Q &key) -> usize {
+    return eraseKey(key);
+  }
+
+  /// @brief Erases the entry at `pos`, returning an iterator to the entry
+  /// after it
+  auto erase(const_iterator pos) -> iterator {
+    K key = pos.key();
+    eraseKey(key);
+    return upperBoundIt(key);
+  }
+
+  auto erase(iterator pos) -> iterator { return erase(const_iterator(pos)); }
+
+  /// @brief Erases the entries in [first, last), returning `last`'s position
+  auto erase(const_iterator first, const_iterator last) -> iterator {
+    if (first == last)
+      return iterator(first._leaf, first._index);
+    std::vector<K> keys;
+    for (; first != last; ++first)
+      keys.push_back(first.key());
+    for (const K &key : keys)
+      eraseKey(key);
+    return upperBoundIt(keys.back());
+  }
+
+  auto swap(BTreeMap &other) noexcept -> void {
+    std::swap(_root, other._root);
+    std::swap(_first, other._first);
+    std::swap(_last, other._last);
+    std::swap(_size, other._size);
+    std::swap(_depth, other._depth);
+    std::swap(_comp, other._comp);
+  }
+
+  auto operator==(const BTreeMap &other) const -> bool {
+    if (_size != other._size)
+      return false;
+    for (auto a = begin(), b = other.begin(); a != end(); ++a, ++b)
+      if (!(a.key() == b.key()) || !(a.value() == b.value()))
+        return false;
+    return true;
+  }
+};
+
+/// @brief An ordered set stored as a B+ tree; see BTreeMap
+template <typename K, typename C = std::less<>, usize NodeBytes = 256>
+class BTreeSet {
+  using Map = BTreeMap<K, detail::BTreeNoValue, C, NodeBytes>;
+  Map _map;
+
+public:
+  using key_type = K;
+  using value_type = K;
+  using size_type = usize;
+  using key_compare = C;
+
+  /// @brief A bidirectional iterator over the keys in order
+  class Iterator {
+    friend class BTreeSet;
+    typename Map::const_iterator _it;
+
+    explicit Iterator(typename Map::const_iterator it) : _it(it) {}
+
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = K;
+    using difference_type = isize;
+    using reference = const K &;
+    using pointer = const K *;
+
+    Iterator() = default;
+
+    auto operator*() const -> const K & { return _it.key(); }
+    auto operator->() const -> const K * { return &_it.key(); }
+
+    auto operator++() -> Iterator & {
+      ++_it;
+      return *this;
+    }
+    auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      ++_it;
+      return tmp;
+    }
+    auto operator--() -> Iterator & {
+      --_it;
+      return *this;
+    }
+    auto operator--(int) -> Iterator {
+      Iterator tmp = *this;
+      --_it;
+      return tmp;
+    }
+
+    auto operator==(const Iterator &other) const -> bool {
+      return _it == other._it;
+    }
+  };
+
+  using iterator = Iterator;
+  using const_iterator = Iterator;
+
+  BTreeSet() = default;
+  explicit BTreeSet(const C &comp) : _map(comp) {}
+
+  template <std::input_iterator It>
+  BTreeSet(It first, It last, const C &comp = C()) : _map(comp) {
+    std::vector<K> keys(first, last);
+    std::stable_sort(keys.begin(), keys.end(), comp);
+    keys.erase(std::unique(keys.begin(), keys.end(),
+                           [&comp](const K &a, const K &b) {
+                             return !comp(a, b);
+                           }),
+               keys.end());
+    _map = Map(SortedUnique, keys.begin(), keys.end(), comp);
+  }
+
+  BTreeSet(std::initializer_list<K> init, const C &comp = C())
+      : BTreeSet(init.begin(), init.end(), comp) {}
+
+  /// @brief Bulk loads already sorted, unique keys in O(n)
+  template <std::forward_iterator It>
+  BTreeSet(SortedUnique_t, It first, It last, const C &comp = C())
+      : _map(SortedUnique, first, last, comp) {}
+
+  auto begin() const -> iterator { return Iterator(_map.begin()); }
+  auto end() const -> iterator { return Iterator(_map.end()); }
+
+  auto empty() const -> bool { return _map.empty(); }
+  auto size() const -> usize { return _map.size(); }
+  auto height() const -> usize { return _map.height(); }
+  auto clear() -> void { _map.clear(); }
+
+  auto find(const K &key) const -> iterator { return Iterator(_map.find(key)); }
+  auto contains(const K &key) const -> bool { return _map.contains(key); }
+  auto count(const K &key) const -> usize { return _map.count(key); }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto find(const Q &key) const -> iterator {
+    return Iterator(_map.find(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto contains(const Q &key) const -> bool {
+    return _map.contains(key);
+  }
+
+  auto lower_bound(const K &key) const -> iterator {
+    return Iterator(_map.lower_bound(key));
+  }
+
+  auto upper_bound(const K &key) const -> iterator {
+    return Iterator(_map.upper_bound(key));
+  }
+
+  /// @brief The keys in [low, high)
+  auto range(const K &low, const K &high) const
+      -> std::ranges::subrange<iterator> {
+    return {lower_bound(low), lower_bound(high)};
+  }
+
+  auto insert(const K &key) -> std::pair<iterator, bool> {
+    auto [it, inserted] = _map.try_emplace(key);
+    return {Iterator(it), inserted};
+  }
+
+  auto insert(K &&key) -> std::pair<iterator, bool> {
+    auto [it, inserted] = _map.try_emplace(std::move(key));
+    return {Iterator(it), inserted};
+  }
+
+  template <std::input_iterator It> auto insert(It first, It last) -> void {
+    for (; first != last; ++first)
+      insert(*first);
+  }
+
+  auto erase(const K &key) -> usize { return _map.erase(key); }
+
+  auto erase(iterator pos) -> iterator {
+    return Iterator(_map.erase(pos._it));
+  }
+
+  auto operator==(const BTreeSet &other) const -> bool {
+    return _map == other._map;
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef Roots_Structures_BitSet_hpp
+#define Roots_Structures_BitSet_hpp
+
+#include "../_defines.hpp"
+#include <bit>
+#include <iterator>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace roots::structures {
+
+namespace detail {
+
+enum class BitOp { And, Or, Xor, AndNot };
+
+template <BitOp Op> constexpr auto applyBitOp(u64 a, u64 b) -> u64 {
+  if constexpr (Op == BitOp::And)
+    return a & b;
+  else if constexpr (Op == BitOp::Or)
+    return a | b;
+  else if constexpr (Op == BitOp::Xor)
+    return a ^ b;
+  else
+    return a & ~b;
+}
+
+/// @brief dst[i] = dst[i] Op src[i] for `count` words, using the widest
+/// vector registers the target has
+template <BitOp Op>
+auto applyBitOpWords(u64 *dst, const u64 *src, usize count) -> void {
+  usize i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= count; i += 4) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i r;
+    if constexpr (Op == BitOp::And)
+      r = _mm256_and_si256(a, b);
+    else if constexpr (Op == BitOp::Or)
+      r = _mm256_or_si256(a, b);
+    else if constexpr (Op == BitOp::Xor)
+      r = _mm256_xor_si256(a, b);
+    else
+      r = _mm256_andnot_si256(b, a);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), r);
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  for (; i + 2 <= count; i += 2) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i r;
+    if constexpr (Op == BitOp::And)
+      r = _mm_and_si128(a, b);
+    else if constexpr (Op == BitOp::Or)
+      r = _mm_or_si128(a, b);
+    else if constexpr (Op == BitOp::Xor)
+      r = _mm_xor_si128(a, b);
+    else
+      r = _mm_andnot_si128(b, a);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), r);
+  }
+#endif
+  for (; i < count; ++i)
+    dst[i] = applyBitOp<Op>(dst[i], src[i]);
+}
+
+} // namespace detail
+
+/// @brief A fixed-size set of N bits. Unlike std::bitset it is usable in
+/// constant expressions throughout, has SIMD bulk operations and can iterate
+/// its set bits (in increasing order) without testing every position
+template <usize N> class BitSet {
+  static_assert(N > 0, "BitSet needs at least one bit");
+
+public:
+  static constexpr usize kWordCount = (N + 63) / 64;
+
+private:
+  static constexpr u64 kLastWordMask =
+      N % 64 == 0 ? ~0ULL : (1ULL << (N % 64)) - 1;
+
+  u64 _words[kWordCount] = {};
+
+  static constexpr auto word(usize bit) -> usize { return bit / 64; }
+  static constexpr auto mask(usize bit) -> u64 { return 1ULL << (bit % 64); }
+
+  constexpr auto trim() -> void { _words[kWordCount - 1] &= kLastWordMask; }
+
+  template <detail::BitOp Op> constexpr auto apply(const BitSet &other) -> void {
+    if (std::is_constant_evaluated() || kWordCount < 2) {
+      for (usize i = 0; i < kWordCount; ++i)
+        _words[i] = detail::applyBitOp<Op>(_words[i], other._words[i]);
+    } else {
+      detail::applyBitOpWords<Op>(_words, other._words, kWordCount);
+    }
+  }
+
+public:
+  /// @brief A writable reference to one bit
+  class Reference {
+    friend class BitSet;
+    u64 *_word;
+    u64 _mask;
+
+    constexpr Reference(u64 *word, u64 mask) : _word(word), _mask(mask) {}
+
+  public:
+    constexpr operator bool() const { return (*_word & _mask) != 0; }
+
+    constexpr auto operator=(bool value) -> Reference & {
+      if (value)
+        *_word |= _mask;
+      else
+        *_word &= ~_mask;
+      return *this;
+    }
+
+    constexpr auto operator=(const Reference &other) -> Reference & {
+      return *this = static_cast<bool>(other);
+    }
+
+    constexpr auto flip() -> Reference & {
+      *_word ^= _mask;
+      return *this;
+    }
+  };
+
+  /// @brief Iterates the indices of the set bits
+  class Iterator {
+    const u64 *_words = nullptr;
+    usize _word = kWordCount;
+    u64 _bits = 0;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = usize;
+    using difference_type = isize;
+    using reference = usize;
+    using pointer = void;
+
+    constexpr Iterator() = default;
+
+    constexpr Iterator(const u64 *words, usize word)
+        : _words(words), _word(word), _bits(word < kWordCount ? words[word] : 0) {
+      skipEmpty();
+    }
+
+    constexpr auto skipEmpty() -> void {
+      while (_bits == 0 && ++_word < kWordCount)
+        _bits = _words[_word];
+    }
+
+    constexpr auto operator*() const -> usize {
+      return _word * 64 + static_cast<usize>(std::countr_zero(_bits));
+    }
+
+    constexpr auto operator++() -> Iterator & {
+      _bits &= _bits - 1;
+      skipEmpty();
+      return *this;
+    }
+
+    constexpr auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    constexpr auto operator==(const Iterator &other) const -> bool {
+      return _word == other._word && _bits == other._bits;
+    }
+  };
+
+  constexpr BitSet() = default;
+
+  /// @brief Initializes the low 64 bits from `bits`
+  constexpr explicit BitSet(u64 bits) {
+    _words[0] = bits;
+    trim();
+  }
+
+  static constexpr auto size() -> usize { return N; }
+
+  constexpr auto test(usize bit) const -> bool {
+    return (_words[word(bit)] & mask(bit)) != 0;
+  }
+
+  constexpr auto operator[](usize bit) const -> bool { return test(bit); }
+
+  constexpr auto operator[](usize bit) -> Reference {
+    return Reference(&_words[word(bit)], mask(bit));
+  }
+
+  constexpr auto set(usize bit, bool value = true) -> BitSet & {
+    if (value)
+      _words[word(bit)] |= mask(bit);
+    else
+      _words[word(bit)] &= ~mask(bit);
+    return *this;
+  }
+
+  constexpr auto reset(usize bit) -> BitSet & { return set(bit, false); }
+
+  constexpr auto flip(usize bit) -> BitSet & {
+    _words[word(bit)] ^= mask(bit);
+    return *this;
+  }
+
+  /// @brief Sets every bit
+  constexpr auto set() -> BitSet & {
+    for (auto &w : _words)
+      w = ~0ULL;
+    trim();
+    return *this;
+  }
+
+  /// @brief Clears every bit
+  constexpr auto reset() -> BitSet & {
+    for (auto &w : _words)
+      w = 0;
+    return *this;
+  }
+
+  /// @brief Flips every bit
+  constexpr auto flip() -> BitSet & {
+    for (auto &w : _words)
+      w = ~w;
+    trim();
+    return *this;
+  }
+
+  /// @brief The number of set bits
+  constexpr auto count() const -> usize {
+    usize total = 0;
+    for (u64 w : _words)
+      total += static_cast<usize>(std::popcount(w));
+    return total;
+  }
+
+  constexpr auto any() const -> bool {
+    u64 acc = 0;
+    for (u64 w : _words)
+      acc |= w;
+    return acc != 0;
+  }
+
+  constexpr auto none() const -> bool { return !any(); }
+
+  constexpr auto all() const -> bool {
+    for (usize i = 0; i + 1 < kWordCount; ++i)
+      if (_words[i] != ~0ULL)
+        return false;
+    return _words[kWordCount - 1] == kLastWordMask;
+  }
+
+  /// @brief Index of the lowest set bit, or N if there is none
+  constexpr auto findFirst() const -> usize {
+    for (usize i = 0; i < kWordCount; ++i)
+      if (_words[i] != 0)
+        return i * 64 + static_cast<usize>(std::countr_zero(_words[i]));
+    return N;
+  }
+
+  /// @brief Index of the lowest set bit after `bit`, or N if there is none
+  constexpr auto findNext(usize bit) const -> usize {
+    ++bit;
+    if (bit >= N)
+      return N;
+    usize i = word(bit);
+    u64 w = _words[i] & (~0ULL << (bit % 64));
+    while (true) {
+      if (w != 0)
+        return i * 64 + static_cast<usize>(std::countr_zero(w));
+      if (++i == kWordCount)
+        return N;
+      w = _words[i];
+    }
+  }
+
+  constexpr auto begin() const -> Iterator { return Iterator(_words, 0); }
+  constexpr auto end() const -> Iterator { return Iterator(); }
+
+  /// @brief True if every bit set here is also set in `other`
+  constexpr auto isSubsetOf(const BitSet &other) const -> bool {
+    u64 acc = 0;
+    for (usize i = 0; i < kWordCount; ++i)
+      acc |= _words[i] & ~other._words[i];
+    return acc == 0;
+  }
+
+  /// @brief True if any bit is set in both
+  constexpr auto intersects(const BitSet &other) const -> bool {
+    u64 acc = 0;
+    for (usize i = 0; i < kWordCount; ++i)
+      acc |= _words[i] & other._words[i];
+    return acc != 0;
+  }
+
+  constexpr auto operator&=(const BitSet &other) -> BitSet & {
+    apply<detail::BitOp::And>(other);
+    return *this;
+  }
+
+  constexpr auto operator|=(const BitSet &other) -> BitSet & {
+    apply<detail::BitOp::Or>(other);
+    return *this;
+  }
+
+  constexpr auto operator^=(const BitSet &other) -> BitSet & {
+    apply<detail::BitOp::Xor>(other);
+    return *this;
+  }
+
+  /// @brief Clears every bit that is set in `other` (this & ~other)
+  constexpr auto andNot(const BitSet &other) -> BitSet & {
+    apply<detail::BitOp::AndNot>(other);
+    return *this;
+  }
+
+  constexpr auto operator~() const -> BitSet { return BitSet(*this).flip(); }
+
+  friend constexpr auto operator&(BitSet a, const BitSet &b) -> BitSet {
+    return a &= b;
+  }
+
+  friend constexpr auto operator|(BitSet a, const BitSet &b) -> BitSet {
+    return a |= b;
+  }
+
+  friend constexpr auto operator^(BitSet a, const BitSet &b) -> BitSet {
+    return a ^= b;
+  }
+
+  constexpr auto operator==(const BitSet &other) const -> bool {
+    for (usize i = 0; i < kWordCount; ++i)
+      if (_words[i] != other._words[i])
+        return false;
+    return true;
+  }
+
+  /// @brief The low 64 bits
+  constexpr auto toU64() const -> u64 { return _words[0]; }
+
+  /// @brief Direct access to the underlying words (bit i is in word i / 64)
+  constexpr auto words() const -> const u64 * { return _words; }
+  static constexpr auto wordCount() -> usize { return kWordCount; }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef Roots_Structures_BloomFilter_hpp
+#define Roots_Structures_BloomFilter_hpp
+
+#include "../_defines.hpp"
+#include "../Error.hpp"
+#include "../bws_result.hpp"
+#include "Hash.hpp"
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace roots::structures {
+
+using namespace roots::err;
+
+/// @brief A blocked Bloom filter: every key maps to one 64-byte block (one
+/// cache line) and sets one bit in each of its eight words, so an insert or
+/// lookup touches a single cache line and is a handful of vector operations.
+/// It answers "definitely absent" or "probably present", which makes it a
+/// cheap guard in front of an expensive probe or syscall
+class BloomFilter {
+public:
+  static constexpr usize kWordsPerBlock = 8;
+
+  struct alignas(kRootsCacheLineSize) Block {
+    u64 words[kWordsPerBlock];
+  };
+
+private:
+  std::vector<Block> _blocks;
+  u64 _count = 0;
+
+  auto blockIndex(u64 hash) const -> usize {
+    return static_cast<usize>(((hash >> 32) * _blocks.size()) >> 32);
+  }
+
+public:
+  BloomFilter() = default;
+
+  /// @brief Sizes the filter so that, once `expectedItems` keys are added,
+  /// lookups of absent keys come back positive with about `falsePositiveRate`
+  /// probability
+  explicit BloomFilter(usize expectedItems, f64 falsePositiveRate = 0.01);
+
+  /// @brief Adds a pre-computed 64-bit hash (it should be well mixed)
+  auto addHash(u64 hash) -> void;
+
+  /// @brief False if the hash was definitely never added
+  auto containsHash(u64 hash) const -> bool;
+
+  template <typename T, typename H = Hash<std::decay_t<const T>>>
+  auto add(const T &value) -> void {
+    addHash(hashOf(H{}, value));
+  }
+
+  template <typename T, typename H = Hash<std::decay_t<const T>>>
+  auto contains(const T &value) const -> bool {
+    return containsHash(hashOf(H{}, value));
+  }
+
+  /// @brief Adds every key of `other`, which must have the same block count
+  auto merge(const BloomFilter &other) -> roots::result<void, Error>;
+
+  auto clear() -> void;
+
+  /// @brief The number of add calls (duplicates included)
+  auto insertCount() const -> u64 { return _count; }
+  auto blockCount() const -> usize { return _blocks.size(); }
+  auto sizeInBytes() const -> usize { return _blocks.size() * sizeof(Block); }
+
+  /// @brief The expected false positive rate at the current insert count
+  auto estimatedFalsePositiveRate() const -> f64;
+
+  /// @brief Serializes to a little-endian buffer readable by deserialize().
+  /// Filters built from hashOf are only portable between builds that hash
+  /// keys the same way
+  auto serialize() const -> std::vector<u8>;
+
+  /// @brief Reads a buffer written by serialize(), failing if the header
+  /// disagrees with the payload size or uses another hash count
+  static auto deserialize(std::span<const u8> bytes)
+      -> roots::result<BloomFilter, Error>;
+};
+
+} // namespace roots::structures
+
+#endif
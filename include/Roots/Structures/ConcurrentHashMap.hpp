@@ -0,0 +1,193 @@
+#ifndef Roots_Structures_ConcurrentHashMap_hpp
+#define Roots_Structures_ConcurrentHashMap_hpp
+
+#include "../_defines.hpp"
+#include "FlatHashMap.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+
+namespace roots::structures {
+
+/// @brief A thread-safe hash map split into independently locked shards, each
+/// a FlatHashMap behind a reader-writer lock. The shard is picked from the top
+/// bits of the key's hash, so threads touching different keys rarely contend.
+/// Values are handed out by copy (or inside a callback that runs under the
+/// shard lock), never by reference, since another thread may erase them
+template <typename K, typename V, typename H = Hash<K>,
+          typename E = std::equal_to<>>
+class ConcurrentHashMap {
+  using Map = FlatHashMap<K, V, H, E>;
+
+  struct alignas(kRootsCacheLineSize) Shard {
+    mutable std::shared_mutex mutex;
+    Map map;
+  };
+
+  std::unique_ptr<Shard[]> _shards;
+  usize _shardCount = 0;
+  u32 _shardShift = 0;
+  H _hash;
+
+  template <typename Q> auto shardFor(const Q &key) const -> Shard & {
+    if (_shardCount == 1)
+      return _shards[0];
+    return _shards[hashOf(_hash, key) >> _shardShift];
+  }
+
+  static auto defaultShardCount() -> usize {
+    usize threads = std::max<usize>(std::thread::hardware_concurrency(), 1);
+    return std::bit_ceil(threads * 4);
+  }
+
+public:
+  /// @brief Creates the map with `shardCount` shards (rounded up to a power of
+  /// two); 0 picks four shards per hardware thread
+  explicit ConcurrentHashMap(usize shardCount = 0) {
+    if (shardCount == 0)
+      shardCount = defaultShardCount();
+    _shardCount = std::bit_ceil(shardCount);
+    _shardShift = 64 - static_cast<u32>(std::countr_zero(_shardCount));
+    _shards = std::make_unique<Shard[]>(_shardCount);
+  }
+
+  ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+  auto operator=(const ConcurrentHashMap &) -> ConcurrentHashMap & = delete;
+
+  auto shardCount() const -> usize { return _shardCount; }
+
+  /// @brief The total number of entries; only a snapshot under concurrency
+  auto size() const -> usize {
+    usize total = 0;
+    for (usize i = 0; i < _shardCount; ++i) {
+      std::shared_lock lock(_shards[i].mutex);
+      total += _shards[i].map.size();
+    }
+    return total;
+  }
+
+  auto empty() const -> bool { return size() == 0; }
+
+  auto clear() -> void {
+    for (usize i = 0; i < _shardCount; ++i) {
+      std::unique_lock lock(_shards[i].mutex);
+      _shards[i].map.clear();
+    }
+  }
+
+  /// @brief Reserves room for `count` entries spread evenly over the shards
+  auto reserve(usize count) -> void {
+    usize perShard = (count + _shardCount - 1) / _shardCount;
+    for (usize i = 0; i < _shardCount; ++i) {
+      std::unique_lock lock(_shards[i].mutex);
+      _shards[i].map.reserve(perShard);
+    }
+  }
+
+  /// @brief A copy of the value for `key`, if present
+  auto get(const K &key) const -> std::optional<V> {
+    Shard &shard = shardFor(key);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end())
+      return std::nullopt;
+    return it->second;
+  }
+
+  auto contains(const K &key) const -> bool {
+    Shard &shard = shardFor(key);
+    std::shared_lock lock(shard.mutex);
+    return shard.map.contains(key);
+  }
+
+  /// @brief Calls fn(const V &) under the shard's read lock if `key` is
+  /// present, returns whether it was
+  template <typename F> auto visit(const K &key, F &&fn) const -> bool {
+    Shard &shard = shardFor(key);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end())
+      return false;
+    std::invoke(std::forward<F>(fn), std::as_const(it->second));
+    return true;
+  }
+
+  /// @brief Calls fn(V &) under the shard's write lock if `key` is present,
+  /// returns whether it was
+  template <typename F> auto update(const K &key, F &&fn) -> bool {
+    Shard &shard = shardFor(key);
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end())
+      return false;
+    std::invoke(std::forward<F>(fn), it->second);
+    return true;
+  }
+
+  /// @brief Inserts if `key` is absent, returns whether it was inserted
+  template <typename... Args> auto emplace(K key, Args &&...args) -> bool {
+    Shard &shard = shardFor(key);
+    std::unique_lock lock(shard.mutex);
+    return shard.map.try_emplace(std::move(key), std::forward<Args>(args)...)
+        .second;
+  }
+
+  auto insert(K key, V value) -> bool {
+    return emplace(std::move(key), std::move(value));
+  }
+
+  /// @brief Inserts or overwrites, returns true if `key` was new
+  auto insertOrAssign(K key, V value) -> bool {
+    Shard &shard = shardFor(key);
+    std::unique_lock lock(shard.mutex);
+    return shard.map.insert_or_assign(std::move(key), std::move(value)).second;
+  }
+
+  /// @brief Removes `key`, returns whether it was present
+  auto erase(const K &key) -> bool {
+    Shard &shard = shardFor(key);
+    std::unique_lock lock(shard.mutex);
+    return shard.map.erase(key) != 0;
+  }
+
+  /// @brief Returns the value for `key`, first inserting fn(key) if it is
+  /// absent. The common hit path only takes the read lock; fn runs under the
+  /// write lock, so it is called at most once per key even under contention
+  template <typename F> auto computeIfAbsent(const K &key, F &&fn) -> V {
+    Shard &shard = shardFor(key);
+    {
+      std::shared_lock lock(shard.mutex);
+      auto it = shard.map.find(key);
+      if (it != shard.map.end())
+        return it->second;
+    }
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it != shard.map.end())
+      return it->second;
+    return shard.map.try_emplace(key, std::invoke(std::forward<F>(fn), key))
+        .first->second;
+  }
+
+  /// @brief Calls fn(const K &, const V &) for every entry, one shard at a
+  /// time under its read lock. Entries added or removed concurrently in other
+  /// shards may or may not be seen
+  template <typename F> auto forEach(F &&fn) const -> void {
+    for (usize i = 0; i < _shardCount; ++i) {
+      std::shared_lock lock(_shards[i].mutex);
+      for (const auto &[key, value] : _shards[i].map)
+        fn(key, value);
+    }
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef Roots_Structures_CuckooFilter_hpp
+#define Roots_Structures_CuckooFilter_hpp
+
+#include "../_defines.hpp"
+#include "../Error.hpp"
+#include "../bws_result.hpp"
+#include "Hash.hpp"
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace roots::structures {
+
+using namespace roots::err;
+
+/// @brief An approximate set that stores a short fingerprint of each key in
+/// one of two 4-slot buckets (cuckoo hashing). Like BloomFilter it answers
+/// "definitely absent" or "probably present", but keys can also be erased.
+/// Erasing a key that was never added may remove another key's fingerprint
+class CuckooFilter {
+public:
+  static constexpr usize kBucketSize = 4;
+
+private:
+  static constexpr u32 kMaxKicks = 500;
+
+  std::vector<u16> _slots; // kBucketSize fingerprints per bucket, 0 is empty
+  usize _bucketMask = 0;
+  u32 _fingerprintBits = 0;
+  u64 _count = 0;
+  u64 _rng = 0x9E3779B97F4A7C15ULL;
+
+  // A fingerprint that could not be placed after kMaxKicks relocations; while
+  // it is held the filter is full and further adds fail
+  struct Victim {
+    usize index = 0;
+    u16 fingerprint = 0;
+    bool used = false;
+  } _victim;
+
+  auto fingerprint(u64 hash) const -> u16;
+  auto altIndex(usize index, u16 fingerprint) const -> usize;
+  auto bucketHas(usize index, u16 fingerprint) const -> bool;
+  auto bucketInsert(usize index, u16 fingerprint) -> bool;
+  auto bucketErase(usize index, u16 fingerprint) -> bool;
+  auto insertFingerprint(usize index, u16 fingerprint) -> bool;
+
+public:
+  CuckooFilter() = default;
+
+  /// @brief Sizes the filter for `expectedItems` keys and picks the
+  /// fingerprint width (4 to 16 bits) that keeps lookups of absent keys below
+  /// about `falsePositiveRate`
+  explicit CuckooFilter(usize expectedItems, f64 falsePositiveRate = 0.01);
+
+  /// @brief Adds a pre-computed 64-bit hash (it should be well mixed).
+  /// Returns false if the filter is too full to take it
+  auto addHash(u64 hash) -> bool;
+
+  /// @brief False if the hash is definitely not in the filter
+  auto containsHash(u64 hash) const -> bool;
+
+  /// @brief Removes one copy of the hash, returns whether one was found
+  auto eraseHash(u64 hash) -> bool;
+
+  template <typename T, typename H = Hash<std::decay_t<const T>>>
+  auto add(const T &value) -> bool {
+    return addHash(hashOf(H{}, value));
+  }
+
+  template <typename T, typename H = Hash<std::decay_t<const T>>>
+  auto contains(const T &value) const -> bool {
+    return containsHash(hashOf(H{}, value));
+  }
+
+  template <typename T, typename H = Hash<std::decay_t<const T>>>
+  auto erase(const T &value) -> bool {
+    return eraseHash(hashOf(H{}, value));
+  }
+
+  auto clear() -> void;
+
+  /// @brief The number of fingerprints held
+  auto size() const -> u64 { return _count; }
+  auto empty() const -> bool { return _count == 0; }
+
+  /// @brief The number of fingerprint slots
+  auto capacity() const -> usize { return _slots.size(); }
+  auto loadFactor() const -> f64;
+  auto fingerprintBits() const -> u32 { return _fingerprintBits; }
+  auto sizeInBytes() const -> usize { return _slots.size() * sizeof(u16); }
+
+  /// @brief Serializes to a little-endian buffer readable by deserialize().
+  /// Filters built from hashOf are only portable between builds that hash
+  /// keys the same way
+  auto serialize() const -> std::vector<u8>;
+
+  /// @brief Reads a buffer written by serialize(), failing if the header
+  /// disagrees with the payload, a fingerprint is wider than the stored
+  /// width, or the count does not match the occupied slots
+  static auto deserialize(std::span<const u8> bytes)
+      -> roots::result<CuckooFilter, Error>;
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,741 @@
+#ifndef Roots_Structures_FlatHashMap_hpp
+#define Roots_Structures_FlatHashMap_hpp
+
+#include "../_defines.hpp"
+#include "../Memory.hpp"
+#include "Hash.hpp"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace roots::structures {
+
+namespace detail {
+
+// Control bytes are explicitly signed: i8 is plain char, which is unsigned on
+// ARM and would flip the full/special tests below
+using CtrlByte = std::int8_t;
+
+// Control bytes: a full slot stores the low 7 bits of its hash (H2), special
+// states all have the sign bit set so they can be found with one compare
+enum Ctrl : CtrlByte {
+  kCtrlEmpty = -128,  // 0b10000000
+  kCtrlDeleted = -2,  // 0b11111110
+  kCtrlSentinel = -1, // 0b11111111
+};
+
+/// @brief The set of matching positions within a group. Stride is the number
+/// of mask bits per control byte (1 for SIMD movemasks, 8 for SWAR)
+template <typename Mask, u32 Width, u32 Stride> class CtrlMask {
+  Mask _mask;
+
+public:
+  explicit CtrlMask(Mask mask) : _mask(mask) {}
+
+  explicit operator bool() const { return _mask != 0; }
+
+  auto lowest() const -> u32 { return std::countr_zero(_mask) / Stride; }
+
+  auto trailingZeros() const -> u32 { return std::countr_zero(_mask) / Stride; }
+
+  auto leadingZeros() const -> u32 {
+    constexpr u32 kUnused = sizeof(Mask) * 8 - Width * Stride;
+    return static_cast<u32>(std::countl_zero(
+               static_cast<Mask>(_mask << kUnused))) /
+           Stride;
+  }
+
+  auto begin() const -> CtrlMask { return *this; }
+  auto end() const -> CtrlMask { return CtrlMask(0); }
+  auto operator*() const -> u32 { return lowest(); }
+  auto operator++() -> CtrlMask & {
+    _mask &= _mask - 1;
+    return *this;
+  }
+  auto operator!=(const CtrlMask &other) const -> bool {
+    return _mask != other._mask;
+  }
+};
+
+#if defined(__AVX2__)
+
+struct CtrlGroup {
+  static constexpr u32 kWidth = 32;
+  using Mask = CtrlMask<u32, kWidth, 1>;
+
+  __m256i ctrl;
+
+  explicit CtrlGroup(const CtrlByte *pos)
+      : ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos))) {}
+
+  auto match(CtrlByte h2) const -> Mask {
+    return Mask(static_cast<u32>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(h2), ctrl))));
+  }
+
+  auto matchEmpty() const -> Mask { return match(kCtrlEmpty); }
+
+  auto matchEmptyOrDeleted() const -> Mask {
+    return Mask(static_cast<u32>(_mm256_movemask_epi8(
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(kCtrlSentinel), ctrl))));
+  }
+};
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct CtrlGroup {
+  static constexpr u32 kWidth = 16;
+  using Mask = CtrlMask<u16, kWidth, 1>;
+
+  __m128i ctrl;
+
+  explicit CtrlGroup(const CtrlByte *pos)
+      : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pos))) {}
+
+  auto match(CtrlByte h2) const -> Mask {
+    return Mask(static_cast<u16>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+  }
+
+  auto matchEmpty() const -> Mask { return match(kCtrlEmpty); }
+
+  auto matchEmptyOrDeleted() const -> Mask {
+    return Mask(static_cast<u16>(_mm_movemask_epi8(
+        _mm_cmpgt_epi8(_mm_set1_epi8(kCtrlSentinel), ctrl))));
+  }
+};
+
+#else
+
+// Portable fallback: treats 8 control bytes as one u64 (SWAR)
+struct CtrlGroup {
+  static constexpr u32 kWidth = 8;
+  using Mask = CtrlMask<u64, kWidth, 8>;
+
+  static constexpr u64 kLsbs = 0x0101010101010101ULL;
+  static constexpr u64 kMsbs = 0x8080808080808080ULL;
+
+  u64 ctrl;
+
+  explicit CtrlGroup(const CtrlByte *pos) {
+    std::memcpy(&ctrl, pos, sizeof(ctrl));
+#if ROOTS_BYTE_ORDER == ROOTS_BIG_ENDIAN
+    ctrl = ROOTS_BSWAP64(ctrl);
+#endif
+  }
+
+  // May report false positives, which the key comparison filters out
+  auto match(CtrlByte h2) const -> Mask {
+    u64 x = ctrl ^ (kLsbs * static_cast<u8>(h2));
+    return Mask((x - kLsbs) & ~x & kMsbs);
+  }
+
+  auto matchEmpty() const -> Mask { return Mask(ctrl & ~(ctrl << 6) & kMsbs); }
+
+  auto matchEmptyOrDeleted() const -> Mask {
+    return Mask(ctrl & ~(ctrl << 7) & kMsbs);
+  }
+};
+
+#endif
+
+} // namespace detail
+
+/// @brief An open-addressing hash map in the style of Swiss tables. Slots are
+/// stored in one flat array next to a byte of metadata each, and lookups scan
+/// a whole group of metadata bytes at once with SIMD (SSE2, or AVX2 when the
+/// target supports it, with a portable fallback). The API mirrors
+/// std::unordered_map, except that references are invalidated by rehashing
+template <typename K, typename V, typename H = Hash<K>,
+          typename E = std::equal_to<>>
+class FlatHashMap {
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+  using size_type = usize;
+  using difference_type = isize;
+  using hasher = H;
+  using key_equal = E;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+
+private:
+  using Group = detail::CtrlGroup;
+  using CtrlByte = detail::CtrlByte;
+  static constexpr usize kGroupWidth = Group::kWidth;
+
+  value_type *_slots = nullptr;
+  CtrlByte *_ctrl = nullptr;
+  usize _capacity = 0; // always 0 or a power of two >= kGroupWidth
+  usize _size = 0;
+  usize _growthLeft = 0;
+  [[no_unique_address]] H _hash;
+  [[no_unique_address]] E _eq;
+
+  static constexpr auto maxLoad(usize capacity) -> usize {
+    return capacity - capacity / 8;
+  }
+
+  static constexpr auto capacityFor(usize count) -> usize {
+    usize capacity = kGroupWidth;
+    while (maxLoad(capacity) < count)
+      capacity *= 2;
+    return capacity;
+  }
+
+  static constexpr auto slotAlign() -> usize {
+    return alignof(value_type) > 16 ? alignof(value_type) : 16;
+  }
+
+  static auto allocBytes(usize capacity) -> usize {
+    return capacity * sizeof(value_type) + capacity + kGroupWidth;
+  }
+
+  static auto h1(u64 hash) -> usize { return static_cast<usize>(hash >> 7); }
+  static auto h2(u64 hash) -> CtrlByte {
+    return static_cast<CtrlByte>(hash & 0x7f);
+  }
+
+  template <typename Q> auto hashKey(const Q &key) const -> u64 {
+    return hashOf(_hash, key);
+  }
+
+  // Writes a control byte, keeping the cloned tail in sync so group loads
+  // that run off the end of the table wrap around
+  auto setCtrl(usize index, CtrlByte value) -> void {
+    _ctrl[index] = value;
+    if (index < kGroupWidth)
+      _ctrl[_capacity + index] = value;
+  }
+
+  static auto mutableKey(value_type &slot) -> K & {
+    return const_cast<K &>(slot.first);
+  }
+
+  template <typename Q> auto findIndex(const Q &key) const -> usize {
+    if (_size == 0)
+      return _capacity;
+    return findIndex(key, hashKey(key));
+  }
+
+  template <typename Q> auto findIndex(const Q &key, u64 hash) const -> usize {
+    usize mask = _capacity - 1;
+    usize pos = h1(hash) & mask;
+    for (usize step = kGroupWidth;; step += kGroupWidth) {
+      Group group(_ctrl + pos);
+      for (u32 bit : group.match(h2(hash))) {
+        usize index = (pos + bit) & mask;
+        if (_eq(_slots[index].first, key))
+          return index;
+      }
+      if (group.matchEmpty())
+        return _capacity;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  auto findFreeSlot(u64 hash) const -> usize {
+    usize mask = _capacity - 1;
+    usize pos = h1(hash) & mask;
+    for (usize step = kGroupWidth;; step += kGroupWidth) {
+      auto free = Group(_ctrl + pos).matchEmptyOrDeleted();
+      if (free)
+        return (pos + free.lowest()) & mask;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  /// @brief Where findOrPrepareInsert found or reserved room for a key
+  struct InsertSlot {
+    usize index;
+    bool inserted;
+    u64 hash;
+  };
+
+  // Returns the slot holding `key`, or picks a free one for it. A free slot
+  // stays unclaimed until finishInsert, so a throwing constructor leaves the
+  // table as it was
+  template <typename Q> auto findOrPrepareInsert(const Q &key) -> InsertSlot {
+    u64 hash = hashKey(key);
+    if (_size != 0) {
+      usize found = findIndex(key, hash);
+      if (found != _capacity)
+        return {found, false, hash};
+    }
+
+    if (_growthLeft == 0)
+      growForInsert();
+    return {findFreeSlot(hash), true, hash};
+  }
+
+  // Claims a slot once its entry has been constructed
+  auto finishInsert(const InsertSlot &slot) -> void {
+    if (_ctrl[slot.index] == detail::kCtrlEmpty)
+      --_growthLeft;
+    setCtrl(slot.index, h2(slot.hash));
+    ++_size;
+  }
+
+  auto growForInsert() -> void {
+    // Lots of tombstones: rebuilding at the same size is enough
+    if (_capacity != 0 && _size + 1 <= maxLoad(_capacity) / 2)
+      resize(_capacity);
+    else
+      resize(capacityFor(_size + 1));
+  }
+
+  auto resize(usize capacity) -> void {
+    value_type *oldSlots = _slots;
+    CtrlByte *oldCtrl = _ctrl;
+    usize oldCapacity = _capacity;
+
+    auto *mem = static_cast<u8 *>(
+        mem::allocAligned(allocBytes(capacity), slotAlign()));
+    _slots = reinterpret_cast<value_type *>(mem);
+    _ctrl = reinterpret_cast<CtrlByte *>(mem + capacity * sizeof(value_type));
+    _capacity = capacity;
+    std::memset(_ctrl, detail::kCtrlEmpty, capacity + kGroupWidth);
+    _growthLeft = maxLoad(capacity) - _size;
+
+    if (oldCapacity == 0)
+      return;
+
+    for (usize i = 0; i < oldCapacity; ++i) {
+      if (oldCtrl[i] < 0)
+        continue;
+      u64 hash = hashKey(oldSlots[i].first);
+      usize index = findFreeSlot(hash);
+      setCtrl(index, h2(hash));
+      std::construct_at(&mutableKey(_slots[index]), std::move(mutableKey(oldSlots[i])));
+      std::construct_at(&_slots[index].second, std::move(oldSlots[i].second));
+      std::destroy_at(&oldSlots[i]);
+    }
+    mem::freeAligned(oldSlots, allocBytes(oldCapacity), slotAlign());
+  }
+
+  auto destroyAll() -> void {
+    if constexpr (!std::is_trivially_destructible_v<value_type>) {
+      for (usize i = 0; i < _capacity; ++i)
+        if (_ctrl[i] >= 0)
+          std::destroy_at(&_slots[i]);
+    }
+  }
+
+  auto eraseIndex(usize index) -> void {
+    std::destroy_at(&_slots[index]);
+    --_size;
+
+    // A slot can go back to empty (instead of a tombstone) when no probe
+    // window covering it can ever have been completely full
+    bool neverFull = _capacity <= kGroupWidth;
+    if (!neverFull) {
+      usize before = (index - kGroupWidth) & (_capacity - 1);
+      auto emptyAfter = Group(_ctrl + index).matchEmpty();
+      auto emptyBefore = Group(_ctrl + before).matchEmpty();
+      neverFull = emptyAfter && emptyBefore &&
+                  emptyAfter.trailingZeros() + emptyBefore.leadingZeros() <
+                      kGroupWidth;
+    }
+    setCtrl(index, neverFull ? detail::kCtrlEmpty : detail::kCtrlDeleted);
+    if (neverFull)
+      ++_growthLeft;
+  }
+
+  template <bool Const> class Iterator {
+    friend class FlatHashMap;
+    template <bool> friend class Iterator;
+    using Entry = std::pair<const K, V>;
+    using Slot = std::conditional_t<Const, const Entry, Entry>;
+
+    const CtrlByte *_ctrl = nullptr;
+    const CtrlByte *_end = nullptr;
+    Slot *_slot = nullptr;
+
+    Iterator(const CtrlByte *ctrl, const CtrlByte *end, Slot *slot)
+        : _ctrl(ctrl), _end(end), _slot(slot) {
+      skipEmpty();
+    }
+
+    auto skipEmpty() -> void {
+      while (_ctrl != _end && *_ctrl < 0) {
+        ++_ctrl;
+        ++_slot;
+      }
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Entry;
+    using difference_type = isize;
+    using pointer = Slot *;
+    using reference = Slot &;
+
+    Iterator() = default;
+
+    // iterator -> const_iterator
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &other)
+        : _ctrl(other._ctrl), _end(other._end), _slot(other._slot) {}
+
+    auto operator*() const -> reference { return *_slot; }
+    auto operator->() const -> pointer { return _slot; }
+
+    auto operator++() -> Iterator & {
+      ++_ctrl;
+      ++_slot;
+      skipEmpty();
+      return *this;
+    }
+
+    auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    auto operator==(const Iterator &other) const -> bool {
+      return _ctrl == other._ctrl;
+    }
+
+    auto operator!=(const Iterator &other) const -> bool {
+      return _ctrl != other._ctrl;
+    }
+  };
+
+  auto atIndex(usize index) -> V & {
+    if (index == _capacity)
+      throw std::out_of_range("FlatHashMap key not found");
+    return _slots[index].second;
+  }
+
+  template <typename Q, typename... Args>
+  auto emplaceKey(Q &&key, Args &&...args) -> std::pair<Iterator<false>, bool> {
+    InsertSlot slot = findOrPrepareInsert(key);
+    if (slot.inserted) {
+      std::construct_at(&_slots[slot.index], std::piecewise_construct,
+                        std::forward_as_tuple(std::forward<Q>(key)),
+                        std::forward_as_tuple(std::forward<Args>(args)...));
+      finishInsert(slot);
+    }
+    return {iteratorAt(slot.index), slot.inserted};
+  }
+
+  template <typename Q, typename M>
+  auto assignKey(Q &&key, M &&value) -> std::pair<Iterator<false>, bool> {
+    InsertSlot slot = findOrPrepareInsert(key);
+    if (slot.inserted) {
+      std::construct_at(&_slots[slot.index], std::forward<Q>(key),
+                        std::forward<M>(value));
+      finishInsert(slot);
+    } else {
+      _slots[slot.index].second = std::forward<M>(value);
+    }
+    return {iteratorAt(slot.index), slot.inserted};
+  }
+
+  template <typename Q> auto eraseKey(const Q &key) -> usize {
+    usize index = findIndex(key);
+    if (index == _capacity)
+      return 0;
+    eraseIndex(index);
+    return 1;
+  }
+
+  auto iteratorAt(usize index) -> Iterator<false> {
+    return Iterator<false>(_ctrl + index, _ctrl + _capacity, _slots + index);
+  }
+
+  auto iteratorAt(usize index) const -> Iterator<true> {
+    return Iterator<true>(_ctrl + index, _ctrl + _capacity, _slots + index);
+  }
+
+public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  FlatHashMap() = default;
+
+  explicit FlatHashMap(usize count, const H &hash = H(), const E &eq = E())
+      : _hash(hash), _eq(eq) {
+    reserve(count);
+  }
+
+  FlatHashMap(std::initializer_list<value_type> init) {
+    reserve(init.size());
+    for (const auto &entry : init)
+      insert(entry);
+  }
+
+  template <std::input_iterator It> FlatHashMap(It first, It last) {
+    if constexpr (std::forward_iterator<It>)
+      reserve(static_cast<usize>(std::distance(first, last)));
+    for (; first != last; ++first)
+      insert(*first);
+  }
+
+  FlatHashMap(const FlatHashMap &other) : _hash(other._hash), _eq(other._eq) {
+    reserve(other._size);
+    for (const auto &entry : other)
+      insert(entry);
+  }
+
+  FlatHashMap(FlatHashMap &&other) noexcept
+      : _slots(std::exchange(other._slots, nullptr)),
+        _ctrl(std::exchange(other._ctrl, nullptr)),
+        _capacity(std::exchange(other._capacity, 0)),
+        _size(std::exchange(other._size, 0)),
+        _growthLeft(std::exchange(other._growthLeft, 0)),
+        _hash(std::move(other._hash)), _eq(std::move(other._eq)) {}
+
+  ~FlatHashMap() {
+    if (_capacity == 0)
+      return;
+    destroyAll();
+    mem::freeAligned(_slots, allocBytes(_capacity), slotAlign());
+  }
+
+  auto operator=(const FlatHashMap &other) -> FlatHashMap & {
+    if (this != &other) {
+      FlatHashMap copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  auto operator=(FlatHashMap &&other) noexcept -> FlatHashMap & {
+    if (this != &other) {
+      FlatHashMap moved(std::move(other));
+      swap(moved);
+    }
+    return *this;
+  }
+
+  auto begin() -> iterator { return iteratorAt(0); }
+  auto begin() const -> const_iterator { return iteratorAt(0); }
+  auto cbegin() const -> const_iterator { return iteratorAt(0); }
+  auto end() -> iterator { return iteratorAt(_capacity); }
+  auto end() const -> const_iterator { return iteratorAt(_capacity); }
+  auto cend() const -> const_iterator { return iteratorAt(_capacity); }
+
+  auto empty() const -> bool { return _size == 0; }
+  auto size() const -> usize { return _size; }
+  auto capacity() const -> usize { return _capacity; }
+
+  auto load_factor() const -> f32 {
+    return _capacity == 0 ? 0.0f
+                          : static_cast<f32>(_size) / static_cast<f32>(_capacity);
+  }
+
+  auto max_load_factor() const -> f32 { return 7.0f / 8.0f; }
+
+  auto hash_function() const -> H { return _hash; }
+  auto key_eq() const -> E { return _eq; }
+
+  /// @brief Makes room for `count` elements without further rehashing
+  auto reserve(usize count) -> void {
+    if (count > _size + _growthLeft)
+      resize(capacityFor(count));
+  }
+
+  /// @brief Rebuilds the table with room for at least `count` elements
+  /// (dropping tombstones); rehash(0) shrinks the table to fit
+  auto rehash(usize count) -> void {
+    if (count == 0 && _size == 0) {
+      FlatHashMap empty(0, _hash, _eq);
+      swap(empty);
+      return;
+    }
+    resize(capacityFor(std::max(count, _size)));
+  }
+
+  auto clear() -> void {
+    if (_capacity == 0)
+      return;
+    destroyAll();
+    std::memset(_ctrl, detail::kCtrlEmpty, _capacity + kGroupWidth);
+    _size = 0;
+    _growthLeft = maxLoad(_capacity);
+  }
+
+  auto find(const K &key) -> iterator { return iteratorAt(findIndex(key)); }
+
+  auto find(const K &key) const -> const_iterator {
+    return iteratorAt(findIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentHash<H, E>
+  auto find(const Q &key) -> iterator {
+    return iteratorAt(findIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentHash<H, E>
+  auto find(const Q &key) const -> const_iterator {
+    return iteratorAt(findIndex(key));
+  }
+
+  auto contains(const K &key) const -> bool {
+    return findIndex(key) != _capacity;
+  }
+
+  template <typename Q>
+    requires TransparentHash<H, E>
+  auto contains(const Q &key) const -> bool {
+    return findIndex(key) != _capacity;
+  }
+
+  auto count(const K &key) const -> usize { return contains(key) ? 1 : 0; }
+
+  template <typename Q>
+    requires TransparentHash<H, E>
+  auto count(const Q &key) const -> usize {
+    return contains(key) ? 1 : 0;
+  }
+
+  auto at(const K &key) -> V & { return atIndex(findIndex(key)); }
+
+  auto at(const K &key) const -> const V & {
+    return const_cast<FlatHashMap *>(this)->atIndex(findIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentHash<H, E>
+  auto at(const Q &key) -> V & {
+    return atIndex(findIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentHash<H, E>
+  auto at(const Q &key) const -> const V & {
+    return const_cast<FlatHashMap *>(this)->atIndex(findIndex(key));
+  }
+
+  template <typename... Args>
+  auto try_emplace(const K &key, Args &&...args) -> std::pair<iterator, bool> {
+    return emplaceKey(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  auto try_emplace(K &&key, Args &&...args) -> std::pair<iterator, bool> {
+    return emplaceKey(std::move(key), std::forward<Args>(args)...);
+  }
+
+  /// @brief Heterogeneous try_emplace, a K is only built from `key` when it
+  /// isn't already present
+  template <typename Q, typename... Args>
+    requires(TransparentHash<H, E> &&
+             !std::same_as<std::remove_cvref_t<Q>, K> &&
+             std::constructible_from<K, Q &&>)
+  auto try_emplace(Q &&key, Args &&...args) -> std::pair<iterator, bool> {
+    return emplaceKey(std::forward<Q>(key), std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  auto insert_or_assign(const K &key, M &&value) -> std::pair<iterator, bool> {
+    return assignKey(key, std::forward<M>(value));
+  }
+
+  template <typename M>
+  auto insert_or_assign(K &&key, M &&value) -> std::pair<iterator, bool> {
+    return assignKey(std::move(key), std::forward<M>(value));
+  }
+
+  auto insert(const value_type &entry) -> std::pair<iterator, bool> {
+    return emplaceKey(entry.first, entry.second);
+  }
+
+  auto insert(value_type &&entry) -> std::pair<iterator, bool> {
+    return emplaceKey(std::move(mutableKey(entry)), std::move(entry.second));
+  }
+
+  template <std::input_iterator It> auto insert(It first, It last) -> void {
+    for (; first != last; ++first)
+      insert(*first);
+  }
+
+  auto insert(std::initializer_list<value_type> init) -> void {
+    insert(init.begin(), init.end());
+  }
+
+  template <typename... Args>
+  auto emplace(Args &&...args) -> std::pair<iterator, bool> {
+    value_type entry(std::forward<Args>(args)...);
+    return insert(std::move(entry));
+  }
+
+  auto operator[](const K &key) -> V & { return emplaceKey(key).first->second; }
+
+  auto operator[](K &&key) -> V & {
+    return emplaceKey(std::move(key)).first->second;
+  }
+
+  template <typename Q>
+    requires(TransparentHash<H, E> &&
+             !std::same_as<std::remove_cvref_t<Q>, K> &&
+             std::constructible_from<K, Q &&>)
+  auto operator[](Q &&key) -> V & {
+    return emplaceKey(std::forward<Q>(key)).first->second;
+  }
+
+  auto erase(const K &key) -> usize { return eraseKey(key); }
+
+  template <typename Q>
+    requires(TransparentHash<H, E> &&
+             !std::is_convertible_v<Q, iterator> &&
+             !std::is_convertible_v<Q, const_iterator>)
+  auto erase(const Q &key) -> usize {
+    return eraseKey(key);
+  }
+
+  auto erase(const_iterator pos) -> iterator {
+    usize index = static_cast<usize>(pos._ctrl - _ctrl);
+    eraseIndex(index);
+    return iteratorAt(index + 1);
+  }
+
+  auto erase(iterator pos) -> iterator { return erase(const_iterator(pos)); }
+
+  auto swap(FlatHashMap &other) noexcept -> void {
+    std::swap(_slots, other._slots);
+    std::swap(_ctrl, other._ctrl);
+    std::swap(_capacity, other._capacity);
+    std::swap(_size, other._size);
+    std::swap(_growthLeft, other._growthLeft);
+    std::swap(_hash, other._hash);
+    std::swap(_eq, other._eq);
+  }
+
+  friend auto swap(FlatHashMap &a, FlatHashMap &b) noexcept -> void {
+    a.swap(b);
+  }
+
+  auto operator==(const FlatHashMap &other) const -> bool {
+    if (_size != other._size)
+      return false;
+    for (const auto &[key, value] : *this) {
+      auto it = other.find(key);
+      if (it == other.end() || !(it->second == value))
+        return false;
+    }
+    return true;
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,647 @@
+#ifndef Roots_Structures_FlatMap_hpp
+#define Roots_Structures_FlatMap_hpp
+
+#include "../_defines.hpp"
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace roots::structures {
+
+/// @brief Tag for constructing a FlatMap/FlatSet from input that is already
+/// sorted and free of duplicates
+struct SortedUnique_t {};
+const SortedUnique_t SortedUnique = {};
+
+template <typename C>
+concept TransparentCompare = requires { typename C::is_transparent; };
+
+/// @brief lower_bound without data-dependent branches: the loop always runs
+/// log2(n) times and the compiler emits conditional moves, so lookups don't
+/// pay for branch mispredictions on random keys
+template <typename T, typename Q, typename C>
+auto branchlessLowerBound(const T *first, usize count, const Q &key,
+                          const C &comp) -> const T * {
+  if (count == 0)
+    return first;
+  const T *base = first;
+  while (count > 1) {
+    usize half = count / 2;
+    base = comp(base[half], key) ? base + half : base;
+    count -= half;
+  }
+  return base + (comp(*base, key) ? 1 : 0);
+}
+
+/// @brief A set stored as one sorted, contiguous array. Meant for data that
+/// is built once (or in bulk) and then queried many times; single inserts and
+/// erases are O(n)
+template <typename K, typename C = std::less<>> class FlatSet {
+  std::vector<K> _keys;
+  [[no_unique_address]] C _comp;
+
+  auto equivalent(const K &a, const K &b) const -> bool {
+    return !_comp(a, b) && !_comp(b, a);
+  }
+
+  // Sorts (stably, so the first of several equal keys wins) and dedupes the
+  // keys from `from` onwards
+  auto normalizeFrom(usize from) -> void {
+    auto first = _keys.begin() + static_cast<isize>(from);
+    std::stable_sort(first, _keys.end(), _comp);
+    _keys.erase(std::unique(first, _keys.end(),
+                            [&](const K &a, const K &b) {
+                              return equivalent(a, b);
+                            }),
+                _keys.end());
+  }
+
+  template <typename Q> auto lowerIndex(const Q &key) const -> usize {
+    return static_cast<usize>(
+        branchlessLowerBound(_keys.data(), _keys.size(), key, _comp) -
+        _keys.data());
+  }
+
+  template <typename Q> auto findIndex(const Q &key) const -> usize {
+    usize index = lowerIndex(key);
+    if (index != _keys.size() && !_comp(key, _keys[index]))
+      return index;
+    return _keys.size();
+  }
+
+public:
+  using key_type = K;
+  using value_type = K;
+  using size_type = usize;
+  using key_compare = C;
+  using iterator = typename std::vector<K>::const_iterator;
+  using const_iterator = iterator;
+
+  FlatSet() = default;
+
+  /// @brief Builds the set from unsorted keys (sorted once, duplicates
+  /// dropped)
+  explicit FlatSet(std::vector<K> keys, const C &comp = C())
+      : _keys(std::move(keys)), _comp(comp) {
+    normalizeFrom(0);
+  }
+
+  FlatSet(SortedUnique_t, std::vector<K> keys, const C &comp = C())
+      : _keys(std::move(keys)), _comp(comp) {}
+
+  FlatSet(std::initializer_list<K> init, const C &comp = C())
+      : FlatSet(std::vector<K>(init), comp) {}
+
+  template <std::input_iterator It>
+  FlatSet(It first, It last, const C &comp = C())
+      : FlatSet(std::vector<K>(first, last), comp) {}
+
+  auto begin() const -> const_iterator { return _keys.begin(); }
+  auto end() const -> const_iterator { return _keys.end(); }
+  auto cbegin() const -> const_iterator { return _keys.begin(); }
+  auto cend() const -> const_iterator { return _keys.end(); }
+
+  auto empty() const -> bool { return _keys.empty(); }
+  auto size() const -> usize { return _keys.size(); }
+  auto reserve(usize count) -> void { _keys.reserve(count); }
+  auto shrink_to_fit() -> void { _keys.shrink_to_fit(); }
+  auto clear() -> void { _keys.clear(); }
+
+  /// @brief The sorted keys as one contiguous span
+  auto keys() const -> std::span<const K> { return _keys; }
+
+  /// @brief Releases the underlying sorted vector, leaving the set empty
+  auto extract() && -> std::vector<K> { return std::move(_keys); }
+
+  auto lower_bound(const K &key) const -> const_iterator {
+    return begin() + static_cast<isize>(lowerIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto lower_bound(const Q &key) const -> const_iterator {
+    return begin() + static_cast<isize>(lowerIndex(key));
+  }
+
+  auto upper_bound(const K &key) const -> const_iterator {
+    return std::upper_bound(begin(), end(), key, _comp);
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto upper_bound(const Q &key) const -> const_iterator {
+    return std::upper_bound(begin(), end(), key, _comp);
+  }
+
+  auto find(const K &key) const -> const_iterator {
+    return begin() + static_cast<isize>(findIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto find(const Q &key) const -> const_iterator {
+    return begin() + static_cast<isize>(findIndex(key));
+  }
+
+  auto contains(const K &key) const -> bool {
+    return findIndex(key) != _keys.size();
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto contains(const Q &key) const -> bool {
+    return findIndex(key) != _keys.size();
+  }
+
+  auto count(const K &key) const -> usize { return contains(key) ? 1 : 0; }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto count(const Q &key) const -> usize {
+    return contains(key) ? 1 : 0;
+  }
+
+  auto insert(K key) -> std::pair<const_iterator, bool> {
+    usize index = lowerIndex(key);
+    if (index != _keys.size() && !_comp(key, _keys[index]))
+      return {begin() + static_cast<isize>(index), false};
+    _keys.insert(_keys.begin() + static_cast<isize>(index), std::move(key));
+    return {begin() + static_cast<isize>(index), true};
+  }
+
+  /// @brief Bulk insert: the new keys are sorted on their own and then merged
+  /// in with one linear pass, instead of n shifting inserts
+  template <std::input_iterator It> auto insert(It first, It last) -> void {
+    usize oldSize = _keys.size();
+    _keys.insert(_keys.end(), first, last);
+    normalizeFrom(oldSize);
+    auto middle = _keys.begin() + static_cast<isize>(oldSize);
+    std::inplace_merge(_keys.begin(), middle, _keys.end(), _comp);
+    // inplace_merge is stable, so existing keys come before new equal ones
+    _keys.erase(std::unique(_keys.begin(), _keys.end(),
+                            [&](const K &a, const K &b) {
+                              return equivalent(a, b);
+                            }),
+                _keys.end());
+  }
+
+  auto insert(std::initializer_list<K> init) -> void {
+    insert(init.begin(), init.end());
+  }
+
+  auto erase(const_iterator pos) -> const_iterator {
+    return _keys.erase(pos);
+  }
+
+  auto erase(const_iterator first, const_iterator last) -> const_iterator {
+    return _keys.erase(first, last);
+  }
+
+  auto erase(const K &key) -> usize {
+    usize index = findIndex(key);
+    if (index == _keys.size())
+      return 0;
+    _keys.erase(_keys.begin() + static_cast<isize>(index));
+    return 1;
+  }
+
+  auto operator==(const FlatSet &other) const -> bool {
+    return _keys == other._keys;
+  }
+};
+
+/// @brief A map stored as two sorted, contiguous arrays (keys and values), so
+/// lookups only ever touch the densely packed keys. Meant for tables that are
+/// built once (or in bulk) and queried many times; single inserts and erases
+/// are O(n). Like std::flat_map, dereferencing an iterator yields a
+/// pair of references rather than a reference to a pair
+template <typename K, typename V, typename C = std::less<>> class FlatMap {
+  std::vector<K> _keys;
+  std::vector<V> _values;
+  [[no_unique_address]] C _comp;
+
+  auto equivalent(const K &a, const K &b) const -> bool {
+    return !_comp(a, b) && !_comp(b, a);
+  }
+
+  template <typename Q> auto lowerIndex(const Q &key) const -> usize {
+    return static_cast<usize>(
+        branchlessLowerBound(_keys.data(), _keys.size(), key, _comp) -
+        _keys.data());
+  }
+
+  template <typename Q> auto upperIndex(const Q &key) const -> usize {
+    return static_cast<usize>(
+        std::upper_bound(_keys.begin(), _keys.end(), key, _comp) -
+        _keys.begin());
+  }
+
+  template <typename Q> auto findIndex(const Q &key) const -> usize {
+    usize index = lowerIndex(key);
+    if (index != _keys.size() && !_comp(key, _keys[index]))
+      return index;
+    return _keys.size();
+  }
+
+  // Sorts the entries from `from` onwards by key (stably, so the first of
+  // several equal keys wins) and drops duplicates
+  auto normalizeFrom(usize from) -> void {
+    usize count = _keys.size() - from;
+    std::vector<usize> order(count);
+    std::iota(order.begin(), order.end(), from);
+    std::stable_sort(order.begin(), order.end(), [&](usize a, usize b) {
+      return _comp(_keys[a], _keys[b]);
+    });
+
+    std::vector<K> keys;
+    std::vector<V> values;
+    keys.reserve(count);
+    values.reserve(count);
+    for (usize index : order) {
+      if (!keys.empty() && equivalent(keys.back(), _keys[index]))
+        continue;
+      keys.push_back(std::move(_keys[index]));
+      values.push_back(std::move(_values[index]));
+    }
+
+    _keys.erase(_keys.begin() + static_cast<isize>(from), _keys.end());
+    _values.erase(_values.begin() + static_cast<isize>(from), _values.end());
+    std::move(keys.begin(), keys.end(), std::back_inserter(_keys));
+    std::move(values.begin(), values.end(), std::back_inserter(_values));
+  }
+
+  template <bool Const> class Iterator {
+    friend class FlatMap;
+    template <bool> friend class Iterator;
+    using Value = std::conditional_t<Const, const V, V>;
+
+    const K *_key = nullptr;
+    Value *_value = nullptr;
+
+    Iterator(const K *key, Value *value) : _key(key), _value(value) {}
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::pair<K, V>;
+    using difference_type = isize;
+    using reference = std::pair<const K &, Value &>;
+
+    struct pointer {
+      reference ref;
+      auto operator->() -> reference * { return &ref; }
+    };
+
+    Iterator() = default;
+
+    template <bool C2 = Const, typename = std::enable_if_t<C2>>
+    Iterator(const Iterator<false> &other)
+        : _key(other._key), _value(other._value) {}
+
+    auto operator*() const -> reference { return {*_key, *_value}; }
+    auto operator->() const -> pointer { return {**this}; }
+    auto operator[](isize n) const -> reference { return *(*this + n); }
+
+    auto key() const -> const K & { return *_key; }
+    auto value() const -> Value & { return *_value; }
+
+    auto operator++() -> Iterator & {
+      ++_key;
+      ++_value;
+      return *this;
+    }
+    auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    auto operator--() -> Iterator & {
+      --_key;
+      --_value;
+      return *this;
+    }
+    auto operator--(int) -> Iterator {
+      Iterator tmp = *this;
+      --*this;
+      return tmp;
+    }
+    auto operator+=(isize n) -> Iterator & {
+      _key += n;
+      _value += n;
+      return *this;
+    }
+    auto operator-=(isize n) -> Iterator & { return *this += -n; }
+    friend auto operator+(Iterator it, isize n) -> Iterator { return it += n; }
+    friend auto operator+(isize n, Iterator it) -> Iterator { return it += n; }
+    friend auto operator-(Iterator it, isize n) -> Iterator { return it -= n; }
+    friend auto operator-(const Iterator &a, const Iterator &b) -> isize {
+      return a._key - b._key;
+    }
+    auto operator==(const Iterator &other) const -> bool {
+      return _key == other._key;
+    }
+    auto operator<=>(const Iterator &other) const {
+      return _key <=> other._key;
+    }
+  };
+
+  auto iteratorAt(usize index) -> Iterator<false> {
+    return {_keys.data() + index, _values.data() + index};
+  }
+
+  auto iteratorAt(usize index) const -> Iterator<true> {
+    return {_keys.data() + index, _values.data() + index};
+  }
+
+  auto atIndex(usize index) const -> usize {
+    if (index == _keys.size())
+      throw std::out_of_range("FlatMap key not found");
+    return index;
+  }
+
+  template <typename Q, typename... Args>
+  auto emplaceKey(Q &&key, Args &&...args) -> std::pair<Iterator<false>, bool> {
+    usize index = lowerIndex(key);
+    if (index != _keys.size() && !_comp(key, _keys[index]))
+      return {iteratorAt(index), false};
+    auto keyIt = _keys.emplace(_keys.begin() + static_cast<isize>(index),
+                               std::forward<Q>(key));
+    try {
+      _values.emplace(_values.begin() + static_cast<isize>(index),
+                      std::forward<Args>(args)...);
+    } catch (...) {
+      // Keep the parallel arrays the same length
+      _keys.erase(keyIt);
+      throw;
+    }
+    return {iteratorAt(index), true};
+  }
+
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  using size_type = usize;
+  using key_compare = C;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  FlatMap() = default;
+
+  /// @brief Builds the map from unsorted, parallel key and value arrays
+  /// (sorted once; for duplicate keys the first entry wins)
+  FlatMap(std::vector<K> keys, std::vector<V> values, const C &comp = C())
+      : _keys(std::move(keys)), _values(std::move(values)), _comp(comp) {
+    if (_keys.size() != _values.size())
+      throw std::invalid_argument("FlatMap keys and values differ in size");
+    normalizeFrom(0);
+  }
+
+  FlatMap(SortedUnique_t, std::vector<K> keys, std::vector<V> values,
+          const C &comp = C())
+      : _keys(std::move(keys)), _values(std::move(values)), _comp(comp) {
+    if (_keys.size() != _values.size())
+      throw std::invalid_argument("FlatMap keys and values differ in size");
+  }
+
+  FlatMap(std::initializer_list<value_type> init, const C &comp = C())
+      : FlatMap(init.begin(), init.end(), comp) {}
+
+  /// @brief Builds the map from an unsorted range of key/value pairs
+  template <std::input_iterator It>
+  FlatMap(It first, It last, const C &comp = C()) : _comp(comp) {
+    insert(first, last);
+  }
+
+  auto begin() -> iterator { return iteratorAt(0); }
+  auto begin() const -> const_iterator { return iteratorAt(0); }
+  auto cbegin() const -> const_iterator { return iteratorAt(0); }
+  auto end() -> iterator { return iteratorAt(_keys.size()); }
+  auto end() const -> const_iterator { return iteratorAt(_keys.size()); }
+  auto cend() const -> const_iterator { return iteratorAt(_keys.size()); }
+
+  auto empty() const -> bool { return _keys.empty(); }
+  auto size() const -> usize { return _keys.size(); }
+
+  auto reserve(usize count) -> void {
+    _keys.reserve(count);
+    _values.reserve(count);
+  }
+
+  auto shrink_to_fit() -> void {
+    _keys.shrink_to_fit();
+    _values.shrink_to_fit();
+  }
+
+  auto clear() -> void {
+    _keys.clear();
+    _values.clear();
+  }
+
+  /// @brief The sorted keys as one contiguous span
+  auto keys() const -> std::span<const K> { return _keys; }
+
+  /// @brief The values, in key order, as one contiguous span
+  auto values() -> std::span<V> { return _values; }
+  auto values() const -> std::span<const V> { return _values; }
+
+  auto lower_bound(const K &key) -> iterator {
+    return iteratorAt(lowerIndex(key));
+  }
+
+  auto lower_bound(const K &key) const -> const_iterator {
+    return iteratorAt(lowerIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto lower_bound(const Q &key) -> iterator {
+    return iteratorAt(lowerIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto lower_bound(const Q &key) const -> const_iterator {
+    return iteratorAt(lowerIndex(key));
+  }
+
+  auto upper_bound(const K &key) -> iterator {
+    return iteratorAt(upperIndex(key));
+  }
+
+  auto upper_bound(const K &key) const -> const_iterator {
+    return iteratorAt(upperIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto upper_bound(const Q &key) -> iterator {
+    return iteratorAt(upperIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto upper_bound(const Q &key) const -> const_iterator {
+    return iteratorAt(upperIndex(key));
+  }
+
+  auto find(const K &key) -> iterator { return iteratorAt(findIndex(key)); }
+
+  auto find(const K &key) const -> const_iterator {
+    return iteratorAt(findIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto find(const Q &key) -> iterator {
+    return iteratorAt(findIndex(key));
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto find(const Q &key) const -> const_iterator {
+    return iteratorAt(findIndex(key));
+  }
+
+  auto contains(const K &key) const -> bool {
+    return findIndex(key) != _keys.size();
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto contains(const Q &key) const -> bool {
+    return findIndex(key) != _keys.size();
+  }
+
+  auto count(const K &key) const -> usize { return contains(key) ? 1 : 0; }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto count(const Q &key) const -> usize {
+    return contains(key) ? 1 : 0;
+  }
+
+  auto at(const K &key) -> V & { return _values[atIndex(findIndex(key))]; }
+
+  auto at(const K &key) const -> const V & {
+    return _values[atIndex(findIndex(key))];
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto at(const Q &key) -> V & {
+    return _values[atIndex(findIndex(key))];
+  }
+
+  template <typename Q>
+    requires TransparentCompare<C>
+  auto at(const Q &key) const -> const V & {
+    return _values[atIndex(findIndex(key))];
+  }
+
+  auto operator[](const K &key) -> V & { return emplaceKey(key).first.value(); }
+
+  auto operator[](K &&key) -> V & {
+    return emplaceKey(std::move(key)).first.value();
+  }
+
+  template <typename... Args>
+  auto try_emplace(const K &key, Args &&...args) -> std::pair<iterator, bool> {
+    return emplaceKey(key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  auto try_emplace(K &&key, Args &&...args) -> std::pair<iterator, bool> {
+    return emplaceKey(std::move(key), std::forward<Args>(args)...);
+  }
+
+  template <typename M>
+  auto insert_or_assign(const K &key, M &&value) -> std::pair<iterator, bool> {
+    auto result = emplaceKey(key, std::forward<M>(value));
+    if (!result.second)
+      result.first.value() = std::forward<M>(value);
+    return result;
+  }
+
+  auto insert(const value_type &entry) -> std::pair<iterator, bool> {
+    return emplaceKey(entry.first, entry.second);
+  }
+
+  auto insert(value_type &&entry) -> std::pair<iterator, bool> {
+    return emplaceKey(std::move(entry.first), std::move(entry.second));
+  }
+
+  /// @brief Bulk insert: the new entries are sorted on their own and then
+  /// merged with the existing ones in one linear pass. Existing keys win
+  template <std::input_iterator It> auto insert(It first, It last) -> void {
+    usize oldSize = _keys.size();
+    try {
+      for (; first != last; ++first) {
+        auto &&[key, value] = *first;
+        _keys.emplace_back(key);
+        _values.emplace_back(value);
+      }
+    } catch (...) {
+      // Drop the unsorted tail so the map is left as it was
+      _keys.erase(_keys.begin() + static_cast<isize>(oldSize), _keys.end());
+      _values.erase(_values.begin() + static_cast<isize>(oldSize),
+                    _values.end());
+      throw;
+    }
+    normalizeFrom(oldSize);
+    if (oldSize == 0)
+      return;
+
+    usize total = _keys.size();
+    std::vector<K> keys;
+    std::vector<V> values;
+    keys.reserve(total);
+    values.reserve(total);
+    usize a = 0, b = oldSize;
+    while (a < oldSize || b < total) {
+      bool takeOld = b == total ||
+                     (a < oldSize && !_comp(_keys[b], _keys[a]));
+      usize index = takeOld ? a++ : b++;
+      if (takeOld && b < total && !_comp(_keys[index], _keys[b]))
+        ++b; // same key in both, keep the existing entry
+      keys.push_back(std::move(_keys[index]));
+      values.push_back(std::move(_values[index]));
+    }
+    _keys = std::move(keys);
+    _values = std::move(values);
+  }
+
+  auto insert(std::initializer_list<value_type> init) -> void {
+    insert(init.begin(), init.end());
+  }
+
+  auto erase(const_iterator pos) -> iterator {
+    usize index = static_cast<usize>(pos._key - _keys.data());
+    _keys.erase(_keys.begin() + static_cast<isize>(index));
+    _values.erase(_values.begin() + static_cast<isize>(index));
+    return iteratorAt(index);
+  }
+
+  auto erase(iterator pos) -> iterator { return erase(const_iterator(pos)); }
+
+  auto erase(const K &key) -> usize {
+    usize index = findIndex(key);
+    if (index == _keys.size())
+      return 0;
+    erase(const_iterator(iteratorAt(index)));
+    return 1;
+  }
+
+  auto operator==(const FlatMap &other) const -> bool {
+    return _keys == other._keys && _values == other._values;
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef Roots_Structures_Hash_hpp
+#define Roots_Structures_Hash_hpp
+
+#include "../_defines.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace roots::structures {
+
+/// @brief Spreads the entropy of a hash across all 64 bits (murmur3 fmix64)
+constexpr auto mixHash(u64 h) -> u64 {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/// @brief The default hasher for roots::structures containers. Unlike
+/// std::hash every bit of the result is usable (std::hash is the identity for
+/// integers), and string hashers are transparent so lookups can take a
+/// std::string_view or C string without building a std::string
+template <typename T> struct Hash {
+  using is_avalanching = void;
+
+  auto operator()(const T &value) const -> u64 {
+    return mixHash(static_cast<u64>(std::hash<T>{}(value)));
+  }
+};
+
+struct StringHash {
+  using is_avalanching = void;
+  using is_transparent = void;
+
+  auto operator()(std::string_view value) const -> u64 {
+    return mixHash(static_cast<u64>(std::hash<std::string_view>{}(value)));
+  }
+};
+
+template <> struct Hash<std::string> : StringHash {};
+template <> struct Hash<std::string_view> : StringHash {};
+template <> struct Hash<const char *> : StringHash {};
+
+/// @brief True when H already produces well-mixed 64-bit hashes
+template <typename H>
+concept AvalanchingHash = requires { typename H::is_avalanching; };
+
+/// @brief True when H and E accept keys other than the container's key type
+template <typename H, typename E>
+concept TransparentHash = requires {
+  typename H::is_transparent;
+  typename E::is_transparent;
+};
+
+/// @brief Hashes `value` with H, mixing the result when H doesn't already
+template <typename H, typename K>
+auto hashOf(const H &hasher, const K &value) -> u64 {
+  if constexpr (AvalanchingHash<H>)
+    return static_cast<u64>(hasher(value));
+  else
+    return mixHash(static_cast<u64>(hasher(value)));
+}
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef Roots_Structures_IndexedHeap_hpp
+#define Roots_Structures_IndexedHeap_hpp
+
+#include "../_defines.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace roots::structures {
+
+/// @brief A d-ary heap (4-ary by default) that hands out a stable handle for
+/// every element, so an element can later be updated (decrease- or
+/// increase-key) or erased in O(log n) instead of the O(n) search
+/// std::priority_queue would need. With Compare = std::less<> the smallest
+/// element is on top (the opposite of std::priority_queue). A wider node
+/// keeps the tree shallow and puts all children of a node in one or two
+/// cache lines, which is usually faster than a binary heap for pops
+template <typename T, typename Compare = std::less<>, u32 Arity = 4>
+class IndexedHeap {
+  static_assert(Arity >= 2, "IndexedHeap needs at least two children per node");
+
+public:
+  using Handle = u32;
+  static constexpr Handle npos = static_cast<Handle>(-1);
+
+private:
+  struct Slot {
+    T value;
+    Handle handle;
+  };
+
+  std::vector<Slot> _heap;
+  std::vector<u32> _positions; // handle -> heap index, or npos when free
+  std::vector<Handle> _freeHandles;
+  [[no_unique_address]] Compare _compare;
+
+  auto place(usize index, Slot &&slot) -> void {
+    _positions[slot.handle] = static_cast<u32>(index);
+    _heap[index] = std::move(slot);
+  }
+
+  /// @brief Moves the element at `index` up until its parent is not after it
+  auto siftUp(usize index) -> void {
+    Slot slot = std::move(_heap[index]);
+    while (index > 0) {
+      usize parent = (index - 1) / Arity;
+      if (!_compare(slot.value, _heap[parent].value))
+        break;
+      place(index, std::move(_heap[parent]));
+      index = parent;
+    }
+    place(index, std::move(slot));
+  }
+
+  /// @brief Moves the element at `index` down below any child that comes first
+  auto siftDown(usize index) -> void {
+    Slot slot = std::move(_heap[index]);
+    usize size = _heap.size();
+    while (true) {
+      usize first = index * Arity + 1;
+      if (first >= size)
+        break;
+      usize last = std::min(first + Arity, size);
+      usize best = first;
+      for (usize child = first + 1; child < last; ++child)
+        if (_compare(_heap[child].value, _heap[best].value))
+          best = child;
+      if (!_compare(_heap[best].value, slot.value))
+        break;
+      place(index, std::move(_heap[best]));
+      index = best;
+    }
+    place(index, std::move(slot));
+  }
+
+  auto position(Handle handle) const -> u32 {
+    if (!contains(handle))
+      throw std::out_of_range("IndexedHeap handle is not in the heap");
+    return _positions[handle];
+  }
+
+  /// @brief Removes the element at heap index `index`
+  auto removeAt(usize index) -> void {
+    Handle handle = _heap[index].handle;
+    _positions[handle] = npos;
+    _freeHandles.push_back(handle);
+    Slot last = std::move(_heap.back());
+    _heap.pop_back();
+    if (index == _heap.size())
+      return;
+    place(index, std::move(last));
+    if (index > 0 && _compare(_heap[index].value,
+                              _heap[(index - 1) / Arity].value))
+      siftUp(index);
+    else
+      siftDown(index);
+  }
+
+public:
+  IndexedHeap() = default;
+  explicit IndexedHeap(Compare compare) : _compare(std::move(compare)) {}
+
+  auto size() const -> usize { return _heap.size(); }
+  auto empty() const -> bool { return _heap.empty(); }
+
+  auto reserve(usize capacity) -> void {
+    _heap.reserve(capacity);
+    _positions.reserve(capacity);
+  }
+
+  auto clear() -> void {
+    _heap.clear();
+    _positions.clear();
+    _freeHandles.clear();
+  }
+
+  /// @brief Adds an element, returns the handle that identifies it until it
+  /// is popped or erased (handles are then reused)
+  auto push(T value) -> Handle {
+    Handle handle;
+    if (!_freeHandles.empty()) {
+      handle = _freeHandles.back();
+      _freeHandles.pop_back();
+    } else {
+      handle = static_cast<Handle>(_positions.size());
+      _positions.push_back(npos);
+    }
+    _heap.push_back(Slot{std::move(value), handle});
+    siftUp(_heap.size() - 1);
+    return handle;
+  }
+
+  /// @brief The first element by Compare (the smallest by default)
+  auto top() const -> const T & { return _heap.front().value; }
+
+  auto topHandle() const -> Handle { return _heap.front().handle; }
+
+  /// @brief Removes and returns the top element
+  auto pop() -> T {
+    if (_heap.empty())
+      throw std::out_of_range("IndexedHeap is empty");
+    T value = std::move(_heap.front().value);
+    removeAt(0);
+    return value;
+  }
+
+  auto contains(Handle handle) const -> bool {
+    return handle < _positions.size() && _positions[handle] != npos;
+  }
+
+  auto get(Handle handle) const -> const T & {
+    return _heap[position(handle)].value;
+  }
+
+  /// @brief Replaces an element's value and restores the heap order, moving
+  /// it either way (decrease-key or increase-key)
+  auto update(Handle handle, T value) -> void {
+    usize index = position(handle);
+    bool earlier = _compare(value, _heap[index].value);
+    _heap[index].value = std::move(value);
+    if (earlier)
+      siftUp(index);
+    else
+      siftDown(index);
+  }
+
+  /// @brief Removes an element by handle, returns false if it wasn't present
+  auto erase(Handle handle) -> bool {
+    if (!contains(handle))
+      return false;
+    removeAt(_positions[handle]);
+    return true;
+  }
+};
+
+} // namespace roots::structures
+
+#endif
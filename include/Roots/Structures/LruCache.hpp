@@ -0,0 +1,339 @@
+#ifndef Roots_Structures_LruCache_hpp
+#define Roots_Structures_LruCache_hpp
+
+#include "../_defines.hpp"
+#include "FlatHashMap.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace roots::structures {
+
+/// @brief A least-recently-used cache with O(1) get, put and eviction. Entries
+/// live in one vector threaded by an index-linked recency list (no allocation
+/// per entry) and are found through a FlatHashMap. The capacity bounds the
+/// total weight of the entries; without a weigher every entry weighs 1, so it
+/// bounds the entry count. Not thread-safe, see ShardedLruCache
+template <typename K, typename V, typename H = Hash<K>,
+          typename E = std::equal_to<>>
+class LruCache {
+public:
+  using Weigher = std::function<usize(const K &, const V &)>;
+  using EvictionCallback = std::function<void(const K &, V &)>;
+
+private:
+  static constexpr u32 kNil = ~0u;
+
+  struct Node {
+    std::optional<std::pair<K, V>> entry;
+    usize weight = 0;
+    u32 prev = kNil;
+    u32 next = kNil;
+  };
+
+  std::vector<Node> _nodes;
+  FlatHashMap<K, u32, H, E> _index;
+  u32 _head = kNil; // most recently used
+  u32 _tail = kNil; // least recently used
+  u32 _free = kNil; // unused nodes, linked through `next`
+  usize _weight = 0;
+  usize _capacity;
+  Weigher _weigher;
+  EvictionCallback _onEvict;
+
+  auto unlink(u32 i) -> void {
+    Node &node = _nodes[i];
+    (node.prev == kNil ? _head : _nodes[node.prev].next) = node.next;
+    (node.next == kNil ? _tail : _nodes[node.next].prev) = node.prev;
+  }
+
+  auto pushFront(u32 i) -> void {
+    Node &node = _nodes[i];
+    node.prev = kNil;
+    node.next = _head;
+    (_head == kNil ? _tail : _nodes[_head].prev) = i;
+    _head = i;
+  }
+
+  auto touch(u32 i) -> void {
+    if (_head == i)
+      return;
+    unlink(i);
+    pushFront(i);
+  }
+
+  auto weigh(const K &key, const V &value) const -> usize {
+    return _weigher ? _weigher(key, value) : 1;
+  }
+
+  auto allocNode() -> u32 {
+    if (_free != kNil) {
+      u32 i = _free;
+      _free = _nodes[i].next;
+      return i;
+    }
+    _nodes.emplace_back();
+    return static_cast<u32>(_nodes.size() - 1);
+  }
+
+  /// @brief Unlinks and frees node i, returning its entry
+  auto removeNode(u32 i) -> std::pair<K, V> {
+    unlink(i);
+    Node &node = _nodes[i];
+    std::pair<K, V> entry = std::move(*node.entry);
+    node.entry.reset();
+    _weight -= node.weight;
+    _index.erase(entry.first);
+    node.next = _free;
+    _free = i;
+    return entry;
+  }
+
+  auto evictToCapacity() -> void {
+    while (_weight > _capacity && _tail != kNil) {
+      std::pair<K, V> entry = removeNode(_tail);
+      if (_onEvict)
+        _onEvict(entry.first, entry.second);
+    }
+  }
+
+public:
+  explicit LruCache(usize capacity, Weigher weigher = {},
+                    EvictionCallback onEvict = {})
+      : _capacity(capacity), _weigher(std::move(weigher)),
+        _onEvict(std::move(onEvict)) {}
+
+  auto size() const -> usize { return _index.size(); }
+  auto empty() const -> bool { return _index.empty(); }
+
+  /// @brief The summed weight of all entries
+  auto weight() const -> usize { return _weight; }
+  auto capacity() const -> usize { return _capacity; }
+
+  /// @brief Changes the capacity, evicting entries if it shrank
+  auto setCapacity(usize capacity) -> void {
+    _capacity = capacity;
+    evictToCapacity();
+  }
+
+  auto setEvictionCallback(EvictionCallback onEvict) -> void {
+    _onEvict = std::move(onEvict);
+  }
+
+  auto contains(const K &key) const -> bool { return _index.contains(key); }
+
+  /// @brief The value for `key` (marking it most recently used), or nullptr.
+  /// The pointer is invalidated by the next put/erase
+  auto get(const K &key) -> V * {
+    auto it = _index.find(key);
+    if (it == _index.end())
+      return nullptr;
+    touch(it->second);
+    return &_nodes[it->second].entry->second;
+  }
+
+  /// @brief Like get() but leaves the recency order alone
+  auto peek(const K &key) const -> const V * {
+    auto it = _index.find(key);
+    if (it == _index.end())
+      return nullptr;
+    return &_nodes[it->second].entry->second;
+  }
+
+  /// @brief Inserts or replaces the value for `key` as the most recently used
+  /// entry, then evicts least recently used entries (calling the eviction
+  /// callback) until the weight fits. An entry heavier than the whole
+  /// capacity is never stored: it goes straight to the eviction callback
+  /// (dropping any older value for `key`) and the other entries are kept
+  auto put(K key, V value) -> void {
+    usize w = weigh(key, value);
+    if (w > _capacity) {
+      erase(key);
+      if (_onEvict)
+        _onEvict(key, value);
+      return;
+    }
+    auto [it, inserted] = _index.try_emplace(key, kNil);
+    if (inserted) {
+      u32 i = allocNode();
+      it->second = i;
+      _nodes[i].entry.emplace(std::move(key), std::move(value));
+      _nodes[i].weight = w;
+      pushFront(i);
+    } else {
+      Node &node = _nodes[it->second];
+      node.entry->second = std::move(value);
+      _weight -= node.weight;
+      node.weight = w;
+      touch(it->second);
+    }
+    _weight += w;
+    evictToCapacity();
+  }
+
+  /// @brief Removes `key` without calling the eviction callback, returns
+  /// whether it was present
+  auto erase(const K &key) -> bool {
+    auto it = _index.find(key);
+    if (it == _index.end())
+      return false;
+    removeNode(it->second);
+    return true;
+  }
+
+  /// @brief Removes and returns the least recently used entry (no callback)
+  auto popLeastRecent() -> std::optional<std::pair<K, V>> {
+    if (_tail == kNil)
+      return std::nullopt;
+    return removeNode(_tail);
+  }
+
+  auto clear() -> void {
+    _nodes.clear();
+    _index.clear();
+    _head = _tail = _free = kNil;
+    _weight = 0;
+  }
+
+  /// @brief Calls fn(const K &, const V &) from most to least recently used
+  template <typename F> auto forEach(F &&fn) const -> void {
+    for (u32 i = _head; i != kNil; i = _nodes[i].next)
+      fn(_nodes[i].entry->first, _nodes[i].entry->second);
+  }
+};
+
+/// @brief A thread-safe LRU cache made of independently locked LruCache
+/// shards, picked by key hash. Recency and capacity are tracked per shard (so
+/// eviction order is only approximately global). Values are returned by copy;
+/// the weigher and eviction callback run under the shard's lock
+template <typename K, typename V, typename H = Hash<K>,
+          typename E = std::equal_to<>>
+class ShardedLruCache {
+  using Cache = LruCache<K, V, H, E>;
+
+  struct alignas(kRootsCacheLineSize) Shard {
+    std::mutex mutex;
+    Cache cache;
+
+    Shard(usize capacity, typename Cache::Weigher weigher,
+          typename Cache::EvictionCallback onEvict)
+        : cache(capacity, std::move(weigher), std::move(onEvict)) {}
+  };
+
+  std::vector<std::unique_ptr<Shard>> _shards;
+  u32 _shardShift = 0;
+  usize _capacity;
+  H _hash;
+
+  auto shardFor(const K &key) const -> Shard & {
+    if (_shards.size() == 1)
+      return *_shards[0];
+    return *_shards[hashOf(_hash, key) >> _shardShift];
+  }
+
+  auto shardCapacity(usize capacity) const -> usize {
+    return (capacity + _shards.size() - 1) / _shards.size();
+  }
+
+public:
+  /// @brief `capacity` is split evenly over `shardCount` shards (rounded up to
+  /// a power of two; 0 picks two per hardware thread)
+  explicit ShardedLruCache(usize capacity, usize shardCount = 0,
+                           typename Cache::Weigher weigher = {},
+                           typename Cache::EvictionCallback onEvict = {})
+      : _capacity(capacity) {
+    if (shardCount == 0)
+      shardCount = std::max<usize>(std::thread::hardware_concurrency(), 1) * 2;
+    shardCount = std::bit_ceil(shardCount);
+    _shardShift = 64 - static_cast<u32>(std::countr_zero(shardCount));
+    _shards.reserve(shardCount);
+    usize perShard = (capacity + shardCount - 1) / shardCount;
+    for (usize i = 0; i < shardCount; ++i)
+      _shards.push_back(std::make_unique<Shard>(perShard, weigher, onEvict));
+  }
+
+  auto shardCount() const -> usize { return _shards.size(); }
+  auto capacity() const -> usize { return _capacity; }
+
+  auto setCapacity(usize capacity) -> void {
+    _capacity = capacity;
+    for (auto &shard : _shards) {
+      std::lock_guard lock(shard->mutex);
+      shard->cache.setCapacity(shardCapacity(capacity));
+    }
+  }
+
+  auto size() const -> usize {
+    usize total = 0;
+    for (auto &shard : _shards) {
+      std::lock_guard lock(shard->mutex);
+      total += shard->cache.size();
+    }
+    return total;
+  }
+
+  auto weight() const -> usize {
+    usize total = 0;
+    for (auto &shard : _shards) {
+      std::lock_guard lock(shard->mutex);
+      total += shard->cache.weight();
+    }
+    return total;
+  }
+
+  /// @brief A copy of the value for `key`, marking it most recently used
+  auto get(const K &key) -> std::optional<V> {
+    Shard &shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    if (V *value = shard.cache.get(key))
+      return *value;
+    return std::nullopt;
+  }
+
+  auto contains(const K &key) const -> bool {
+    Shard &shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    return shard.cache.contains(key);
+  }
+
+  auto put(K key, V value) -> void {
+    Shard &shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    shard.cache.put(std::move(key), std::move(value));
+  }
+
+  /// @brief Returns the cached value for `key`, or caches and returns fn(key).
+  /// fn runs without the lock held, so concurrent misses on one key may each
+  /// call it (the last put wins)
+  template <typename F> auto getOrCompute(const K &key, F &&fn) -> V {
+    if (std::optional<V> hit = get(key))
+      return std::move(*hit);
+    V value = std::invoke(std::forward<F>(fn), key);
+    put(key, value);
+    return value;
+  }
+
+  auto erase(const K &key) -> bool {
+    Shard &shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    return shard.cache.erase(key);
+  }
+
+  auto clear() -> void {
+    for (auto &shard : _shards) {
+      std::lock_guard lock(shard->mutex);
+      shard->cache.clear();
+    }
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef Roots_Structures_MpmcQueue_hpp
+#define Roots_Structures_MpmcQueue_hpp
+
+#include "../_defines.hpp"
+#include "../Memory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace roots::structures {
+
+/// @brief A bounded multi-producer/multi-consumer queue (Dmitry Vyukov's
+/// sequence-numbered ring). Every slot carries a sequence number that tells
+/// producers and consumers whether it is theirs to fill or drain, so the only
+/// shared writes are one CAS on the enqueue or dequeue position. The blocking
+/// push()/pop() sleep on the slot's sequence with std::atomic::wait (a futex
+/// on Linux) instead of spinning
+template <typename T> class MpmcQueue {
+  struct Cell {
+    std::atomic<usize> sequence;
+    alignas(T) u8 storage[sizeof(T)];
+
+    auto value() -> T * { return reinterpret_cast<T *>(storage); }
+  };
+
+  static constexpr usize kCellAlignment =
+      std::max<usize>(alignof(Cell), kRootsCacheLineSize);
+
+  alignas(kRootsCacheLineSize) std::atomic<usize> _enqueuePos = 0;
+  alignas(kRootsCacheLineSize) std::atomic<usize> _dequeuePos = 0;
+  alignas(kRootsCacheLineSize) Cell *_cells = nullptr;
+  usize _mask = 0;
+
+  /// @brief Claims a slot to write to; nullptr if the queue is full (and
+  /// `seen` then holds the sequence to wait on)
+  auto claimPush(usize &pos, usize &seen) -> Cell * {
+    pos = _enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell *cell = &_cells[pos & _mask];
+      usize seq = cell->sequence.load(std::memory_order_acquire);
+      isize diff = static_cast<isize>(seq) - static_cast<isize>(pos);
+      if (diff == 0) {
+        if (_enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+          return cell;
+      } else if (diff < 0) {
+        seen = seq;
+        return nullptr;
+      } else {
+        pos = _enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// @brief Claims a filled slot to read from; nullptr if the queue is empty
+  auto claimPop(usize &pos, usize &seen) -> Cell * {
+    pos = _dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell *cell = &_cells[pos & _mask];
+      usize seq = cell->sequence.load(std::memory_order_acquire);
+      isize diff = static_cast<isize>(seq) - static_cast<isize>(pos + 1);
+      if (diff == 0) {
+        if (_dequeuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+          return cell;
+      } else if (diff < 0) {
+        seen = seq;
+        return nullptr;
+      } else {
+        pos = _dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  static auto publish(Cell *cell, usize seq) -> void {
+    cell->sequence.store(seq, std::memory_order_release);
+    cell->sequence.notify_all();
+  }
+
+  auto take(Cell *cell, usize pos) -> T {
+    T out(std::move(*cell->value()));
+    std::destroy_at(cell->value());
+    publish(cell, pos + _mask + 1);
+    return out;
+  }
+
+public:
+  explicit MpmcQueue(usize capacity) {
+    capacity = std::bit_ceil(std::max<usize>(capacity, 2));
+    _cells = static_cast<Cell *>(
+        mem::allocAligned(capacity * sizeof(Cell), kCellAlignment));
+    for (usize i = 0; i < capacity; ++i)
+      std::construct_at(&_cells[i].sequence, i);
+    _mask = capacity - 1;
+  }
+
+  MpmcQueue(const MpmcQueue &) = delete;
+  auto operator=(const MpmcQueue &) -> MpmcQueue & = delete;
+
+  ~MpmcQueue() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      usize end = _enqueuePos.load(std::memory_order_relaxed);
+      for (usize i = _dequeuePos.load(std::memory_order_relaxed); i != end; ++i)
+        std::destroy_at(_cells[i & _mask].value());
+    }
+    mem::freeAligned(_cells, capacity() * sizeof(Cell), kCellAlignment);
+  }
+
+  auto capacity() const -> usize { return _mask + 1; }
+
+  /// @brief The number of queued elements; only a snapshot under concurrency
+  auto size() const -> usize {
+    usize tail = _enqueuePos.load(std::memory_order_acquire);
+    usize head = _dequeuePos.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  auto empty() const -> bool { return size() == 0; }
+
+  /// @brief Constructs an element in place, false if the queue is full
+  template <typename... Args> auto tryEmplace(Args &&...args) -> bool {
+    usize pos, seen;
+    Cell *cell = claimPush(pos, seen);
+    if (cell == nullptr)
+      return false;
+    std::construct_at(cell->value(), std::forward<Args>(args)...);
+    publish(cell, pos + 1);
+    return true;
+  }
+
+  auto tryPush(const T &value) -> bool { return tryEmplace(value); }
+  auto tryPush(T &&value) -> bool { return tryEmplace(std::move(value)); }
+
+  /// @brief Constructs an element in place, sleeping while the queue is full
+  template <typename... Args> auto emplace(Args &&...args) -> void {
+    usize pos, seen;
+    Cell *cell;
+    while ((cell = claimPush(pos, seen)) == nullptr)
+      _cells[pos & _mask].sequence.wait(seen, std::memory_order_acquire);
+    std::construct_at(cell->value(), std::forward<Args>(args)...);
+    publish(cell, pos + 1);
+  }
+
+  auto push(const T &value) -> void { emplace(value); }
+  auto push(T &&value) -> void { emplace(std::move(value)); }
+
+  /// @brief Removes the oldest element into `out`, false if empty
+  auto tryPop(T &out) -> bool {
+    usize pos, seen;
+    Cell *cell = claimPop(pos, seen);
+    if (cell == nullptr)
+      return false;
+    out = take(cell, pos);
+    return true;
+  }
+
+  auto tryPop() -> std::optional<T> {
+    usize pos, seen;
+    Cell *cell = claimPop(pos, seen);
+    if (cell == nullptr)
+      return std::nullopt;
+    return take(cell, pos);
+  }
+
+  /// @brief Removes the oldest element, sleeping while the queue is empty
+  auto pop() -> T {
+    usize pos, seen;
+    Cell *cell;
+    while ((cell = claimPop(pos, seen)) == nullptr)
+      _cells[pos & _mask].sequence.wait(seen, std::memory_order_acquire);
+    return take(cell, pos);
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,945 @@
+#ifndef Roots_Structures_Persistent_hpp
+#define Roots_Structures_Persistent_hpp
+
+#include "../_defines.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace roots::structures {
+
+namespace detail {
+
+/// @brief The header shared by persistent tree nodes: an atomic reference
+/// count (nodes are shared between versions, possibly across threads) and
+/// the id of the transient allowed to modify the node in place (0: none)
+struct PersistentNode {
+  std::atomic<u32> refs = 1;
+  u64 edit;
+
+  explicit PersistentNode(u64 edit) : edit(edit) {}
+};
+
+/// @brief A fresh, never reused transient id
+inline auto newEditId() -> u64 {
+  static std::atomic<u64> next = 1;
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline auto retainNode(PersistentNode *node) -> void {
+  if (node != nullptr)
+    node->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// @brief Drops a reference, returns true if it was the last one
+inline auto releaseNode(PersistentNode *node) -> bool {
+  return node != nullptr &&
+         node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+} // namespace detail
+
+/// @brief An immutable vector with structural sharing (a 32-way trie of
+/// leaves plus a separate tail leaf, as in Clojure). Copying is O(1) and
+/// gives an independent snapshot; pushBack, set and popBack return a new
+/// vector in O(log32 n), copying only the path to the changed leaf and
+/// sharing everything else. Nodes are reference counted atomically, so
+/// snapshots can be handed to other threads and read while a writer keeps
+/// producing new versions. For many updates in a row use transient(), which
+/// edits its own nodes in place
+template <typename T> class PersistentVector {
+  static constexpr u32 kBits = 5;
+  static constexpr u32 kWidth = 1u << kBits;
+  static constexpr usize kMask = kWidth - 1;
+
+  struct Node : detail::PersistentNode {
+    bool leaf;
+    Node(u64 edit, bool leaf) : detail::PersistentNode(edit), leaf(leaf) {}
+  };
+
+  struct Leaf : Node {
+    u32 count = 0;
+    alignas(T) u8 storage[kWidth * sizeof(T)];
+
+    explicit Leaf(u64 edit) : Node(edit, true) {}
+    ~Leaf() { std::destroy_n(values(), count); }
+
+    auto values() -> T * { return reinterpret_cast<T *>(storage); }
+    auto values() const -> const T * {
+      return reinterpret_cast<const T *>(storage);
+    }
+  };
+
+  struct Branch : Node {
+    Node *children[kWidth] = {};
+    explicit Branch(u64 edit) : Node(edit, false) {}
+  };
+
+  Branch *_root = nullptr;
+  Leaf *_tail = nullptr;
+  usize _size = 0;
+  u32 _shift = kBits;
+
+  static auto release(Node *node) -> void {
+    if (!detail::releaseNode(node))
+      return;
+    if (node->leaf) {
+      delete static_cast<Leaf *>(node);
+    } else {
+      auto *branch = static_cast<Branch *>(node);
+      for (Node *child : branch->children)
+        release(child);
+      delete branch;
+    }
+  }
+
+  static auto clone(const Leaf *leaf, u64 edit) -> Leaf * {
+    auto *copy = new Leaf(edit);
+    std::uninitialized_copy_n(leaf->values(), leaf->count, copy->values());
+    copy->count = leaf->count;
+    return copy;
+  }
+
+  static auto clone(const Branch *branch, u64 edit) -> Branch * {
+    auto *copy = new Branch(edit);
+    for (u32 i = 0; i < kWidth; ++i) {
+      copy->children[i] = branch->children[i];
+      detail::retainNode(copy->children[i]);
+    }
+    return copy;
+  }
+
+  /// @brief The node in `slot`, first replaced by a private copy unless it
+  /// already belongs to transient `edit`
+  template <typename N> static auto editable(N *&slot, u64 edit) -> N * {
+    if (edit != 0 && slot->edit == edit)
+      return slot;
+    N *copy = clone(slot, edit);
+    release(slot);
+    slot = copy;
+    return copy;
+  }
+
+  static auto editable(Node *&slot, u64 edit) -> Node * {
+    if (slot->leaf) {
+      auto *leaf = static_cast<Leaf *>(slot);
+      editable(leaf, edit);
+      slot = leaf;
+    } else {
+      auto *branch = static_cast<Branch *>(slot);
+      editable(branch, edit);
+      slot = branch;
+    }
+    return slot;
+  }
+
+  auto tailOffset() const -> usize {
+    return _size < kWidth ? 0 : ((_size - 1) >> kBits) << kBits;
+  }
+
+  /// @brief The leaf holding index `index`
+  auto leafFor(usize index) const -> Leaf * {
+    if (index >= tailOffset())
+      return _tail;
+    Node *node = _root;
+    for (u32 level = _shift; level > 0; level -= kBits)
+      node = static_cast<Branch *>(node)->children[(index >> level) & kMask];
+    return static_cast<Leaf *>(node);
+  }
+
+  static auto newPath(u32 level, Node *node, u64 edit) -> Node * {
+    if (level == 0)
+      return node;
+    auto *branch = new Branch(edit);
+    branch->children[0] = newPath(level - kBits, node, edit);
+    return branch;
+  }
+
+  auto pushTail(Branch *&slot, u32 level, Leaf *tail, u64 edit) -> void {
+    Branch *branch = slot ? editable(slot, edit) : (slot = new Branch(edit));
+    usize sub = ((_size - 1) >> level) & kMask;
+    Node *&child = branch->children[sub];
+    if (level == kBits) {
+      child = tail;
+    } else if (child != nullptr) {
+      auto *childBranch = static_cast<Branch *>(child);
+      pushTail(childBranch, level - kBits, tail, edit);
+      child = childBranch;
+    } else {
+      child = newPath(level - kBits, tail, edit);
+    }
+  }
+
+  /// @brief Unlinks the leaf holding index _size - 2, dropping branches that
+  /// become empty
+  auto popTail(Branch *&slot, u32 level, u64 edit) -> void {
+    Branch *branch = editable(slot, edit);
+    usize sub = ((_size - 2) >> level) & kMask;
+    Node *&child = branch->children[sub];
+    if (level > kBits) {
+      auto *childBranch = static_cast<Branch *>(child);
+      popTail(childBranch, level - kBits, edit);
+      child = childBranch;
+    } else {
+      release(child);
+      child = nullptr;
+    }
+    if (child == nullptr && sub == 0) {
+      release(slot);
+      slot = nullptr;
+    }
+  }
+
+  template <typename U> auto pushImpl(U &&value, u64 edit) -> void {
+    if (_size == 0) {
+      _tail = new Leaf(edit);
+    } else if (_size - tailOffset() == kWidth) {
+      // The tail is full: move it into the trie, growing a level if needed
+      if ((_size >> kBits) > (usize(1) << _shift)) {
+        auto *root = new Branch(edit);
+        root->children[0] = _root;
+        root->children[1] = newPath(_shift, _tail, edit);
+        _root = root;
+        _shift += kBits;
+      } else {
+        pushTail(_root, _shift, _tail, edit);
+      }
+      _tail = new Leaf(edit);
+    } else {
+      editable(_tail, edit);
+    }
+    std::construct_at(_tail->values() + _tail->count, std::forward<U>(value));
+    ++_tail->count;
+    ++_size;
+  }
+
+  template <typename U> auto setImpl(usize index, U &&value, u64 edit) -> void {
+    if (index >= _size)
+      throw std::out_of_range("PersistentVector index out of range");
+    if (index >= tailOffset()) {
+      editable(_tail, edit)->values()[index & kMask] = std::forward<U>(value);
+      return;
+    }
+    Node *node = editable(_root, edit);
+    for (u32 level = _shift; level > 0; level -= kBits) {
+      Node *&child =
+          static_cast<Branch *>(node)->children[(index >> level) & kMask];
+      node = editable(child, edit);
+    }
+    static_cast<Leaf *>(node)->values()[index & kMask] =
+        std::forward<U>(value);
+  }
+
+  auto popImpl(u64 edit) -> void {
+    if (_size == 0)
+      throw std::out_of_range("PersistentVector is empty");
+    if (_size == 1) {
+      release(_tail);
+      _tail = nullptr;
+    } else if (_size - tailOffset() > 1) {
+      Leaf *tail = editable(_tail, edit);
+      std::destroy_at(tail->values() + --tail->count);
+    } else {
+      // The tail empties: the last leaf in the trie becomes the new tail
+      Leaf *tail = leafFor(_size - 2);
+      detail::retainNode(tail);
+      release(_tail);
+      _tail = tail;
+      popTail(_root, _shift, edit);
+      if (_root == nullptr) {
+        _shift = kBits;
+      } else if (_shift > kBits && _root->children[1] == nullptr) {
+        auto *child = static_cast<Branch *>(_root->children[0]);
+        detail::retainNode(child);
+        release(_root);
+        _root = child;
+        _shift -= kBits;
+      }
+    }
+    --_size;
+  }
+
+public:
+  using value_type = T;
+
+  /// @brief Iterates the elements in order, one leaf at a time
+  class Iterator {
+    const PersistentVector *_vector = nullptr;
+    usize _index = 0;
+    const T *_leaf = nullptr;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = isize;
+    using reference = const T &;
+    using pointer = const T *;
+
+    Iterator() = default;
+    Iterator(const PersistentVector *vector, usize index)
+        : _vector(vector), _index(index) {
+      if (_index < _vector->_size)
+        _leaf = _vector->leafFor(_index)->values();
+    }
+
+    auto operator*() const -> const T & { return _leaf[_index & kMask]; }
+    auto operator->() const -> const T * { return &_leaf[_index & kMask]; }
+
+    auto operator++() -> Iterator & {
+      ++_index;
+      if ((_index & kMask) == 0 && _index < _vector->_size)
+        _leaf = _vector->leafFor(_index)->values();
+      return *this;
+    }
+
+    auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    auto operator==(const Iterator &other) const -> bool {
+      return _index == other._index;
+    }
+  };
+
+  /// @brief A mutable view of a PersistentVector for batches of updates.
+  /// Nodes it creates are tagged with its edit id and modified in place
+  /// afterwards, so a run of pushes costs about as much as on a std::vector.
+  /// persistent() hands out an immutable snapshot and retags the transient,
+  /// so the snapshot's nodes are never touched again
+  class Transient {
+    PersistentVector _vector;
+    u64 _edit;
+
+  public:
+    explicit Transient(const PersistentVector &vector)
+        : _vector(vector), _edit(detail::newEditId()) {}
+
+    Transient(const Transient &) = delete;
+    auto operator=(const Transient &) -> Transient & = delete;
+
+    auto pushBack(const T &value) -> Transient & {
+      _vector.pushImpl(value, _edit);
+      return *this;
+    }
+
+    auto pushBack(T &&value) -> Transient & {
+      _vector.pushImpl(std::move(value), _edit);
+      return *this;
+    }
+
+    auto set(usize index, const T &value) -> Transient & {
+      _vector.setImpl(index, value, _edit);
+      return *this;
+    }
+
+    auto set(usize index, T &&value) -> Transient & {
+      _vector.setImpl(index, std::move(value), _edit);
+      return *this;
+    }
+
+    auto popBack() -> Transient & {
+      _vector.popImpl(_edit);
+      return *this;
+    }
+
+    auto operator[](usize index) const -> const T & { return _vector[index]; }
+    auto size() const -> usize { return _vector.size(); }
+    auto empty() const -> bool { return _vector.empty(); }
+
+    auto persistent() -> PersistentVector {
+      _edit = detail::newEditId();
+      return _vector;
+    }
+  };
+
+  PersistentVector() = default;
+
+  PersistentVector(std::initializer_list<T> init)
+      : PersistentVector(init.begin(), init.end()) {}
+
+  template <std::input_iterator It> PersistentVector(It first, It last) {
+    Transient transient(*this);
+    for (; first != last; ++first)
+      transient.pushBack(*first);
+    *this = transient.persistent();
+  }
+
+  PersistentVector(const PersistentVector &other)
+      : _root(other._root), _tail(other._tail), _size(other._size),
+        _shift(other._shift) {
+    detail::retainNode(_root);
+    detail::retainNode(_tail);
+  }
+
+  PersistentVector(PersistentVector &&other) noexcept
+      : _root(std::exchange(other._root, nullptr)),
+        _tail(std::exchange(other._tail, nullptr)),
+        _size(std::exchange(other._size, 0)),
+        _shift(std::exchange(other._shift, kBits)) {}
+
+  ~PersistentVector() {
+    release(_root);
+    release(_tail);
+  }
+
+  auto operator=(const PersistentVector &other) -> PersistentVector & {
+    PersistentVector copy(other);
+    swap(copy);
+    return *this;
+  }
+
+  auto operator=(PersistentVector &&other) noexcept -> PersistentVector & {
+    PersistentVector moved(std::move(other));
+    swap(moved);
+    return *this;
+  }
+
+  auto swap(PersistentVector &other) noexcept -> void {
+    std::swap(_root, other._root);
+    std::swap(_tail, other._tail);
+    std::swap(_size, other._size);
+    std::swap(_shift, other._shift);
+  }
+
+  auto size() const -> usize { return _size; }
+  auto empty() const -> bool { return _size == 0; }
+
+  auto operator[](usize index) const -> const T & {
+    return leafFor(index)->values()[index & kMask];
+  }
+
+  auto at(usize index) const -> const T & {
+    if (index >= _size)
+      throw std::out_of_range("PersistentVector index out of range");
+    return (*this)[index];
+  }
+
+  auto front() const -> const T & { return (*this)[0]; }
+  auto back() const -> const T & { return (*this)[_size - 1]; }
+
+  /// @brief A copy with `value` appended
+  auto pushBack(T value) const -> PersistentVector {
+    PersistentVector result(*this);
+    result.pushImpl(std::move(value), 0);
+    return result;
+  }
+
+  /// @brief A copy with element `index` replaced
+  auto set(usize index, T value) const -> PersistentVector {
+    PersistentVector result(*this);
+    result.setImpl(index, std::move(value), 0);
+    return result;
+  }
+
+  /// @brief A copy without the last element
+  auto popBack() const -> PersistentVector {
+    PersistentVector result(*this);
+    result.popImpl(0);
+    return result;
+  }
+
+  auto transient() const -> Transient { return Transient(*this); }
+
+  auto begin() const -> Iterator { return Iterator(this, 0); }
+  auto end() const -> Iterator { return Iterator(this, _size); }
+
+  /// @brief Calls fn(const T &) for every element in order
+  template <typename F> auto forEach(F &&fn) const -> void {
+    for (usize i = 0; i < _size; i += kWidth) {
+      const Leaf *leaf = leafFor(i);
+      for (u32 j = 0; j < leaf->count; ++j)
+        fn(leaf->values()[j]);
+    }
+  }
+
+  auto operator==(const PersistentVector &other) const -> bool {
+    if (_size != other._size)
+      return false;
+    if (_root == other._root && _tail == other._tail)
+      return true;
+    return std::equal(begin(), end(), other.begin());
+  }
+};
+
+/// @brief An immutable hash map with structural sharing, stored as a
+/// compressed hash-array mapped trie (CHAMP): each node consumes 5 bits of
+/// the key's hash and keeps two bitmaps, one for entries stored inline and
+/// one for child nodes, so lookups touch at most ~13 nodes and typically 3-4.
+/// Copying is O(1); set and erase return a new map in O(log32 n), sharing
+/// every untouched node. Keys whose full 64-bit hashes collide end up in a
+/// collision node that is searched linearly. Like PersistentVector, nodes
+/// are reference counted atomically and transient() batches updates in place
+template <typename K, typename V, typename H = Hash<K>,
+          typename E = std::equal_to<>>
+class PersistentMap {
+  static constexpr u32 kBits = 5;
+  static constexpr u32 kMaxShift = 64;
+
+  struct Entry {
+    K key;
+    V value;
+    u64 hash;
+  };
+
+  // A node is one allocation: this header, then its child pointers, then its
+  // entries, so a lookup touches a single cache line or two per level
+  struct Node : detail::PersistentNode {
+    u32 dataMap = 0;
+    u32 nodeMap = 0;
+    u32 entryCount = 0;
+    u32 childCount = 0;
+    u32 entryCapacity;
+    u32 childCapacity;
+    bool collision = false;
+
+    Node(u64 edit, u32 entryCapacity, u32 childCapacity)
+        : detail::PersistentNode(edit), entryCapacity(entryCapacity),
+          childCapacity(childCapacity) {}
+
+    auto children() const -> Node ** {
+      return reinterpret_cast<Node **>(
+          reinterpret_cast<u8 *>(const_cast<Node *>(this)) + kHeaderSize);
+    }
+
+    auto entries() const -> Entry * {
+      return reinterpret_cast<Entry *>(
+          reinterpret_cast<u8 *>(children()) +
+          alignUp(childCapacity * sizeof(Node *)));
+    }
+  };
+
+  static constexpr usize kNodeAlignment =
+      std::max({alignof(Node), alignof(Entry), alignof(Node *)});
+
+  static constexpr auto alignUp(usize bytes) -> usize {
+    return (bytes + kNodeAlignment - 1) & ~(kNodeAlignment - 1);
+  }
+
+  static constexpr usize kHeaderSize = alignUp(sizeof(Node));
+
+  Node *_root = nullptr;
+  usize _size = 0;
+  [[no_unique_address]] H _hasher;
+  [[no_unique_address]] E _equal;
+
+  static auto fragment(u64 hash, u32 shift) -> u32 {
+    return static_cast<u32>(hash >> shift) & ((1u << kBits) - 1);
+  }
+
+  static auto indexBelow(u32 map, u32 bit) -> u32 {
+    return static_cast<u32>(std::popcount(map & (bit - 1)));
+  }
+
+  static auto createNode(u64 edit, u32 entryCapacity, u32 childCapacity)
+      -> Node * {
+    usize bytes = kHeaderSize + alignUp(childCapacity * sizeof(Node *)) +
+                  entryCapacity * sizeof(Entry);
+    void *memory = ::operator new(bytes, std::align_val_t(kNodeAlignment));
+    return new (memory) Node(edit, entryCapacity, childCapacity);
+  }
+
+  /// @brief Frees a node's memory and entries, but not its children
+  static auto destroyNode(Node *node) -> void {
+    std::destroy_n(node->entries(), node->entryCount);
+    node->~Node();
+    ::operator delete(node, std::align_val_t(kNodeAlignment));
+  }
+
+  static auto release(Node *node) -> void {
+    if (!detail::releaseNode(node))
+      return;
+    for (u32 i = 0; i < node->childCount; ++i)
+      release(node->children()[i]);
+    destroyNode(node);
+  }
+
+  /// @brief The node in `slot`, made private to `edit` and given room for
+  /// the given number of additional entries and children. Shared nodes are
+  /// copied (exactly sized for persistent updates, with slack for
+  /// transients); a transient's own node is only moved when it is full
+  static auto editable(Node *&slot, u64 edit, u32 extraEntries = 0,
+                       u32 extraChildren = 0) -> Node * {
+    Node *node = slot;
+    u32 entries = node->entryCount + extraEntries;
+    u32 children = node->childCount + extraChildren;
+    bool owned = edit != 0 && node->edit == edit;
+    if (owned && entries <= node->entryCapacity &&
+        children <= node->childCapacity)
+      return node;
+
+    auto slack = [edit](u32 count) {
+      return edit == 0 ? count : std::max<u32>(std::bit_ceil(count), 2);
+    };
+    Node *copy = createNode(edit, slack(entries), slack(children));
+    copy->dataMap = node->dataMap;
+    copy->nodeMap = node->nodeMap;
+    copy->collision = node->collision;
+    copy->entryCount = node->entryCount;
+    copy->childCount = node->childCount;
+    std::copy_n(node->children(), node->childCount, copy->children());
+    if (owned) {
+      // Only this transient can see the node: steal its contents
+      std::uninitialized_move_n(node->entries(), node->entryCount,
+                                copy->entries());
+      destroyNode(node);
+    } else {
+      std::uninitialized_copy_n(node->entries(), node->entryCount,
+                                copy->entries());
+      for (u32 i = 0; i < copy->childCount; ++i)
+        detail::retainNode(copy->children()[i]);
+      release(node);
+    }
+    slot = copy;
+    return copy;
+  }
+
+  /// @brief Inserts at `index`; the node must have room
+  static auto insertEntry(Node *node, u32 index, Entry &&entry) -> void {
+    Entry *entries = node->entries();
+    std::construct_at(entries + node->entryCount, std::move(entry));
+    std::rotate(entries + index, entries + node->entryCount,
+                entries + node->entryCount + 1);
+    ++node->entryCount;
+  }
+
+  static auto eraseEntry(Node *node, u32 index) -> void {
+    Entry *entries = node->entries();
+    std::move(entries + index + 1, entries + node->entryCount,
+              entries + index);
+    std::destroy_at(entries + --node->entryCount);
+  }
+
+  static auto insertChild(Node *node, u32 index, Node *child) -> void {
+    Node **children = node->children();
+    for (u32 i = node->childCount; i > index; --i)
+      children[i] = children[i - 1];
+    children[index] = child;
+    ++node->childCount;
+  }
+
+  static auto eraseChild(Node *node, u32 index) -> void {
+    Node **children = node->children();
+    for (u32 i = index + 1; i < node->childCount; ++i)
+      children[i - 1] = children[i];
+    --node->childCount;
+  }
+
+  /// @brief A node holding two entries whose hashes agree below `shift`
+  static auto mergeEntries(Entry &&a, Entry &&b, u32 shift, u64 edit)
+      -> Node * {
+    if (shift >= kMaxShift) {
+      Node *node = createNode(edit, 2, 0);
+      node->collision = true;
+      insertEntry(node, 0, std::move(a));
+      insertEntry(node, 1, std::move(b));
+      return node;
+    }
+    u32 fa = fragment(a.hash, shift);
+    u32 fb = fragment(b.hash, shift);
+    if (fa == fb) {
+      Node *node = createNode(edit, 0, 1);
+      node->nodeMap = 1u << fa;
+      node->children()[0] =
+          mergeEntries(std::move(a), std::move(b), shift + kBits, edit);
+      node->childCount = 1;
+      return node;
+    }
+    Node *node = createNode(edit, 2, 0);
+    node->dataMap = (1u << fa) | (1u << fb);
+    insertEntry(node, 0, fa < fb ? std::move(a) : std::move(b));
+    insertEntry(node, 1, fa < fb ? std::move(b) : std::move(a));
+    return node;
+  }
+
+  template <typename Q>
+  auto findEntry(const Q &key, u64 hash) const -> const Entry * {
+    const Node *node = _root;
+    for (u32 shift = 0; node != nullptr; shift += kBits) {
+      const Entry *entries = node->entries();
+      if (node->collision) {
+        for (u32 i = 0; i < node->entryCount; ++i)
+          if (_equal(entries[i].key, key))
+            return &entries[i];
+        return nullptr;
+      }
+      u32 bit = 1u << fragment(hash, shift);
+      if (node->dataMap & bit) {
+        const Entry &entry = entries[indexBelow(node->dataMap, bit)];
+        return entry.hash == hash && _equal(entry.key, key) ? &entry
+                                                            : nullptr;
+      }
+      if (!(node->nodeMap & bit))
+        return nullptr;
+      node = node->children()[indexBelow(node->nodeMap, bit)];
+    }
+    return nullptr;
+  }
+
+  /// @brief Inserts or assigns below `slot`, returns true if the key is new
+  auto setAt(Node *&slot, Entry &&entry, u32 shift, u64 edit) -> bool {
+    Node *node = slot;
+    if (node->collision) {
+      for (u32 i = 0; i < node->entryCount; ++i) {
+        if (_equal(node->entries()[i].key, entry.key)) {
+          editable(slot, edit)->entries()[i].value = std::move(entry.value);
+          return false;
+        }
+      }
+      node = editable(slot, edit, 1, 0);
+      insertEntry(node, node->entryCount, std::move(entry));
+      return true;
+    }
+
+    u32 bit = 1u << fragment(entry.hash, shift);
+    if (node->dataMap & bit) {
+      u32 index = indexBelow(node->dataMap, bit);
+      const Entry &existing = node->entries()[index];
+      if (existing.hash == entry.hash && _equal(existing.key, entry.key)) {
+        editable(slot, edit)->entries()[index].value = std::move(entry.value);
+        return false;
+      }
+      // Two keys share this fragment: push both down into a new child
+      node = editable(slot, edit, 0, 1);
+      Entry moved = std::move(node->entries()[index]);
+      eraseEntry(node, index);
+      node->dataMap ^= bit;
+      insertChild(node, indexBelow(node->nodeMap, bit),
+                  mergeEntries(std::move(moved), std::move(entry),
+                               shift + kBits, edit));
+      node->nodeMap |= bit;
+      return true;
+    }
+    if (node->nodeMap & bit) {
+      node = editable(slot, edit);
+      return setAt(node->children()[indexBelow(node->nodeMap, bit)],
+                   std::move(entry), shift + kBits, edit);
+    }
+
+    node = editable(slot, edit, 1, 0);
+    insertEntry(node, indexBelow(node->dataMap, bit), std::move(entry));
+    node->dataMap |= bit;
+    return true;
+  }
+
+  /// @brief Removes a key known to be present below `slot`. A child left
+  /// with a single entry is folded back into its parent so that the trie
+  /// stays canonical (equal maps have equal shapes)
+  template <typename Q>
+  auto eraseAt(Node *&slot, const Q &key, u64 hash, u32 shift, u64 edit)
+      -> void {
+    if (slot->collision) {
+      Node *node = editable(slot, edit);
+      for (u32 i = 0; i < node->entryCount; ++i) {
+        if (_equal(node->entries()[i].key, key)) {
+          eraseEntry(node, i);
+          return;
+        }
+      }
+      return;
+    }
+
+    u32 bit = 1u << fragment(hash, shift);
+    if (slot->dataMap & bit) {
+      Node *node = editable(slot, edit);
+      eraseEntry(node, indexBelow(node->dataMap, bit));
+      node->dataMap ^= bit;
+      return;
+    }
+
+    Node *node = editable(slot, edit, 1, 0);
+    u32 childIndex = indexBelow(node->nodeMap, bit);
+    Node *&child = node->children()[childIndex];
+    eraseAt(child, key, hash, shift + kBits, edit);
+    if (child->childCount == 0 && child->entryCount == 1) {
+      // The child is now private to this path, so its entry can be moved
+      Entry entry = std::move(child->entries()[0]);
+      release(child);
+      eraseChild(node, childIndex);
+      node->nodeMap ^= bit;
+      insertEntry(node, indexBelow(node->dataMap, bit), std::move(entry));
+      node->dataMap |= bit;
+    }
+  }
+
+  auto setImpl(K key, V value, u64 edit) -> bool {
+    u64 hash = hashOf(_hasher, key);
+    if (_root == nullptr)
+      _root = createNode(edit, 1, 0);
+    bool inserted =
+        setAt(_root, Entry{std::move(key), std::move(value), hash}, 0, edit);
+    _size += inserted;
+    return inserted;
+  }
+
+  template <typename Q> auto eraseImpl(const Q &key, u64 edit) -> bool {
+    u64 hash = hashOf(_hasher, key);
+    if (findEntry(key, hash) == nullptr)
+      return false;
+    eraseAt(_root, key, hash, 0, edit);
+    if (--_size == 0) {
+      release(_root);
+      _root = nullptr;
+    }
+    return true;
+  }
+
+  template <typename F> static auto visit(const Node *node, F &fn) -> void {
+    for (u32 i = 0; i < node->entryCount; ++i)
+      fn(node->entries()[i].key, node->entries()[i].value);
+    for (u32 i = 0; i < node->childCount; ++i)
+      visit(node->children()[i], fn);
+  }
+
+public:
+  using key_type = K;
+  using mapped_type = V;
+
+  /// @brief Batches updates to a PersistentMap in place; see
+  /// PersistentVector::Transient
+  class Transient {
+    PersistentMap _map;
+    u64 _edit;
+
+  public:
+    explicit Transient(const PersistentMap &map)
+        : _map(map), _edit(detail::newEditId()) {}
+
+    Transient(const Transient &) = delete;
+    auto operator=(const Transient &) -> Transient & = delete;
+
+    /// @brief Inserts or assigns, returns true if the key was new
+    auto set(K key, V value) -> bool {
+      return _map.setImpl(std::move(key), std::move(value), _edit);
+    }
+
+    /// @brief Removes a key, returns whether it was present
+    template <typename Q> auto erase(const Q &key) -> bool {
+      return _map.eraseImpl(key, _edit);
+    }
+
+    template <typename Q> auto find(const Q &key) const -> const V * {
+      return _map.find(key);
+    }
+
+    template <typename Q> auto contains(const Q &key) const -> bool {
+      return _map.contains(key);
+    }
+
+    auto size() const -> usize { return _map.size(); }
+
+    auto persistent() -> PersistentMap {
+      _edit = detail::newEditId();
+      return _map;
+    }
+  };
+
+  PersistentMap() = default;
+
+  PersistentMap(std::initializer_list<std::pair<K, V>> init) {
+    Transient transient(*this);
+    for (const auto &[key, value] : init)
+      transient.set(key, value);
+    *this = transient.persistent();
+  }
+
+  PersistentMap(const PersistentMap &other)
+      : _root(other._root), _size(other._size), _hasher(other._hasher),
+        _equal(other._equal) {
+    detail::retainNode(_root);
+  }
+
+  PersistentMap(PersistentMap &&other) noexcept
+      : _root(std::exchange(other._root, nullptr)),
+        _size(std::exchange(other._size, 0)), _hasher(other._hasher),
+        _equal(other._equal) {}
+
+  ~PersistentMap() { release(_root); }
+
+  auto operator=(const PersistentMap &other) -> PersistentMap & {
+    PersistentMap copy(other);
+    swap(copy);
+    return *this;
+  }
+
+  auto operator=(PersistentMap &&other) noexcept -> PersistentMap & {
+    PersistentMap moved(std::move(other));
+    swap(moved);
+    return *this;
+  }
+
+  auto swap(PersistentMap &other) noexcept -> void {
+    std::swap(_root, other._root);
+    std::swap(_size, other._size);
+    std::swap(_hasher, other._hasher);
+    std::swap(_equal, other._equal);
+  }
+
+  auto size() const -> usize { return _size; }
+  auto empty() const -> bool { return _size == 0; }
+
+  template <typename Q> auto find(const Q &key) const -> const V * {
+    const Entry *entry = findEntry(key, hashOf(_hasher, key));
+    return entry ? &entry->value : nullptr;
+  }
+
+  template <typename Q> auto contains(const Q &key) const -> bool {
+    return find(key) != nullptr;
+  }
+
+  template <typename Q> auto at(const Q &key) const -> const V & {
+    if (const V *value = find(key))
+      return *value;
+    throw std::out_of_range("PersistentMap key not found");
+  }
+
+  /// @brief A copy with `key` set to `value`
+  auto set(K key, V value) const -> PersistentMap {
+    PersistentMap result(*this);
+    result.setImpl(std::move(key), std::move(value), 0);
+    return result;
+  }
+
+  /// @brief A copy without `key` (sharing all nodes if it was absent)
+  template <typename Q> auto erase(const Q &key) const -> PersistentMap {
+    PersistentMap result(*this);
+    result.eraseImpl(key, 0);
+    return result;
+  }
+
+  auto transient() const -> Transient { return Transient(*this); }
+
+  /// @brief Calls fn(const K &, const V &) for every entry, in hash order
+  template <typename F> auto forEach(F &&fn) const -> void {
+    if (_root != nullptr)
+      visit(_root, fn);
+  }
+
+  auto operator==(const PersistentMap &other) const -> bool {
+    if (_size != other._size)
+      return false;
+    if (_root == other._root)
+      return true;
+    bool equal = true;
+    forEach([&](const K &key, const V &value) {
+      if (equal) {
+        const V *found = other.find(key);
+        equal = found != nullptr && *found == value;
+      }
+    });
+    return equal;
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,760 @@
+#ifndef Roots_Structures_RadixTree_hpp
+#define Roots_Structures_RadixTree_hpp
+
+#include "../_defines.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace roots::structures {
+
+/// @brief A map from string keys to V stored as an adaptive radix tree. Each
+/// inner node branches on one key byte and uses the smallest of four layouts
+/// that fits its fanout (4, 16, 48 or 256 children), and runs of bytes shared
+/// by every key below a node are collapsed into that node's prefix, so the
+/// tree stays shallow and small for path-like keys. Lookups cost O(key length)
+/// regardless of the number of keys, and prefix queries only visit the
+/// matching subtree
+template <typename V> class RadixTree {
+public:
+  /// @brief A stored key and its value
+  struct Entry {
+    std::string key;
+    V value;
+  };
+
+private:
+  static constexpr u32 kMaxPrefix = 10;
+
+  enum class NodeType : u8 { N4, N16, N48, N256 };
+
+  struct Inner;
+
+  // A child slot: null, an Entry (low bit set) or an inner node
+  class Child {
+    std::uintptr_t _bits = 0;
+
+  public:
+    Child() = default;
+    Child(Entry *entry)
+        : _bits(reinterpret_cast<std::uintptr_t>(entry) | 1) {}
+    Child(Inner *inner) : _bits(reinterpret_cast<std::uintptr_t>(inner)) {}
+
+    explicit operator bool() const { return _bits != 0; }
+    auto isLeaf() const -> bool { return (_bits & 1) != 0; }
+    auto leaf() const -> Entry * {
+      return reinterpret_cast<Entry *>(_bits & ~std::uintptr_t(1));
+    }
+    auto inner() const -> Inner * { return reinterpret_cast<Inner *>(_bits); }
+  };
+
+  struct Inner {
+    NodeType type;
+    u16 count = 0;
+    u32 prefixLen = 0;
+    u8 prefix[kMaxPrefix];
+    Entry *terminal = nullptr; // the key that ends exactly at this node
+
+    explicit Inner(NodeType t) : type(t) {}
+  };
+
+  struct Node4 : Inner {
+    u8 keys[4];
+    Child children[4];
+    Node4() : Inner(NodeType::N4) {}
+  };
+
+  struct Node16 : Inner {
+    u8 keys[16];
+    Child children[16];
+    Node16() : Inner(NodeType::N16) {}
+  };
+
+  struct Node48 : Inner {
+    u8 index[256] = {}; // slot + 1, or 0 if absent
+    Child children[48];
+    Node48() : Inner(NodeType::N48) {}
+  };
+
+  struct Node256 : Inner {
+    Child children[256];
+    Node256() : Inner(NodeType::N256) {}
+  };
+
+  Child _root;
+  usize _size = 0;
+
+  static auto copyHeader(Inner *dst, const Inner *src) -> void {
+    dst->count = src->count;
+    dst->prefixLen = src->prefixLen;
+    std::memcpy(dst->prefix, src->prefix, kMaxPrefix);
+    dst->terminal = src->terminal;
+  }
+
+  static auto destroy(Child child) -> void {
+    if (!child)
+      return;
+    if (child.isLeaf()) {
+      delete child.leaf();
+      return;
+    }
+    Inner *node = child.inner();
+    delete node->terminal;
+    forEachChild(node, [](u8, Child c) { destroy(c); });
+    switch (node->type) {
+    case NodeType::N4:
+      delete static_cast<Node4 *>(node);
+      break;
+    case NodeType::N16:
+      delete static_cast<Node16 *>(node);
+      break;
+    case NodeType::N48:
+      delete static_cast<Node48 *>(node);
+      break;
+    case NodeType::N256:
+      delete static_cast<Node256 *>(node);
+      break;
+    }
+  }
+
+  /// @brief Calls fn(byte, child) for every child in byte order
+  template <typename F> static auto forEachChild(Inner *node, F &&fn) -> void {
+    switch (node->type) {
+    case NodeType::N4: {
+      auto *n = static_cast<Node4 *>(node);
+      for (u16 i = 0; i < n->count; ++i)
+        fn(n->keys[i], n->children[i]);
+      break;
+    }
+    case NodeType::N16: {
+      auto *n = static_cast<Node16 *>(node);
+      for (u16 i = 0; i < n->count; ++i)
+        fn(n->keys[i], n->children[i]);
+      break;
+    }
+    case NodeType::N48: {
+      auto *n = static_cast<Node48 *>(node);
+      for (u32 b = 0; b < 256; ++b)
+        if (n->index[b] != 0)
+          fn(static_cast<u8>(b), n->children[n->index[b] - 1]);
+      break;
+    }
+    case NodeType::N256: {
+      auto *n = static_cast<Node256 *>(node);
+      for (u32 b = 0; b < 256; ++b)
+        if (n->children[b])
+          fn(static_cast<u8>(b), n->children[b]);
+      break;
+    }
+    }
+  }
+
+  static auto findChild(Inner *node, u8 byte) -> Child * {
+    switch (node->type) {
+    case NodeType::N4: {
+      auto *n = static_cast<Node4 *>(node);
+      for (u16 i = 0; i < n->count; ++i)
+        if (n->keys[i] == byte)
+          return &n->children[i];
+      return nullptr;
+    }
+    case NodeType::N16: {
+      auto *n = static_cast<Node16 *>(node);
+#if defined(__SSE2__) || defined(_M_X64)
+      __m128i cmp = _mm_cmpeq_epi8(
+          _mm_set1_epi8(static_cast<char>(byte)),
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(n->keys)));
+      u32 mask = static_cast<u32>(_mm_movemask_epi8(cmp)) &
+                 ((1u << n->count) - 1);
+      return mask != 0 ? &n->children[std::countr_zero(mask)] : nullptr;
+#else
+      for (u16 i = 0; i < n->count; ++i)
+        if (n->keys[i] == byte)
+          return &n->children[i];
+      return nullptr;
+#endif
+    }
+    case NodeType::N48: {
+      auto *n = static_cast<Node48 *>(node);
+      return n->index[byte] != 0 ? &n->children[n->index[byte] - 1] : nullptr;
+    }
+    case NodeType::N256: {
+      auto *n = static_cast<Node256 *>(node);
+      return n->children[byte] ? &n->children[byte] : nullptr;
+    }
+    }
+    ROOTS_UNREACHABLE;
+  }
+
+  /// @brief Inserts into a sorted Node4/Node16 that has room
+  template <typename N>
+  static auto addSorted(N *n, u8 byte, Child child) -> void {
+    u16 pos = 0;
+    while (pos < n->count && n->keys[pos] < byte)
+      ++pos;
+    std::memmove(n->keys + pos + 1, n->keys + pos, n->count - pos);
+    std::move_backward(n->children + pos, n->children + n->count,
+                       n->children + n->count + 1);
+    n->keys[pos] = byte;
+    n->children[pos] = child;
+    ++n->count;
+  }
+
+  /// @brief Adds a child, growing the node (and updating `slot`) when full
+  static auto addChild(Child &slot, Inner *node, u8 byte, Child child)
+      -> void {
+    switch (node->type) {
+    case NodeType::N4: {
+      auto *n = static_cast<Node4 *>(node);
+      if (n->count < 4)
+        return addSorted(n, byte, child);
+      auto *grown = new Node16();
+      copyHeader(grown, n);
+      std::memcpy(grown->keys, n->keys, 4);
+      std::copy(n->children, n->children + 4, grown->children);
+      delete n;
+      slot = Child(static_cast<Inner *>(grown));
+      return addSorted(grown, byte, child);
+    }
+    case NodeType::N16: {
+      auto *n = static_cast<Node16 *>(node);
+      if (n->count < 16)
+        return addSorted(n, byte, child);
+      auto *grown = new Node48();
+      copyHeader(grown, n);
+      for (u8 i = 0; i < 16; ++i) {
+        grown->index[n->keys[i]] = static_cast<u8>(i + 1);
+        grown->children[i] = n->children[i];
+      }
+      delete n;
+      slot = Child(static_cast<Inner *>(grown));
+      return addChild(slot, grown, byte, child);
+    }
+    case NodeType::N48: {
+      auto *n = static_cast<Node48 *>(node);
+      if (n->count < 48) {
+        u8 free = 0;
+        while (n->children[free])
+          ++free;
+        n->children[free] = child;
+        n->index[byte] = static_cast<u8>(free + 1);
+        ++n->count;
+        return;
+      }
+      auto *grown = new Node256();
+      copyHeader(grown, n);
+      for (u32 b = 0; b < 256; ++b)
+        if (n->index[b] != 0)
+          grown->children[b] = n->children[n->index[b] - 1];
+      delete n;
+      slot = Child(static_cast<Inner *>(grown));
+      return addChild(slot, grown, byte, child);
+    }
+    case NodeType::N256: {
+      auto *n = static_cast<Node256 *>(node);
+      n->children[byte] = child;
+      ++n->count;
+      return;
+    }
+    }
+  }
+
+  static auto removeChild(Inner *node, u8 byte) -> void {
+    switch (node->type) {
+    case NodeType::N4:
+    case NodeType::N16: {
+      u8 *keys = node->type == NodeType::N4 ? static_cast<Node4 *>(node)->keys
+                                            : static_cast<Node16 *>(node)->keys;
+      Child *children = node->type == NodeType::N4
+                            ? static_cast<Node4 *>(node)->children
+                            : static_cast<Node16 *>(node)->children;
+      u16 pos = 0;
+      while (keys[pos] != byte)
+        ++pos;
+      std::memmove(keys + pos, keys + pos + 1, node->count - pos - 1);
+      std::move(children + pos + 1, children + node->count, children + pos);
+      break;
+    }
+    case NodeType::N48: {
+      auto *n = static_cast<Node48 *>(node);
+      n->children[n->index[byte] - 1] = Child();
+      n->index[byte] = 0;
+      break;
+    }
+    case NodeType::N256:
+      static_cast<Node256 *>(node)->children[byte] = Child();
+      break;
+    }
+    --node->count;
+  }
+
+  /// @brief Moves a node's children into the next smaller layout once it has
+  /// shrunk well below capacity (with slack, so it doesn't flip-flop)
+  static auto shrink(Child &slot, Inner *node) -> void {
+    if (node->type == NodeType::N256 && node->count <= 36) {
+      auto *n = static_cast<Node256 *>(node);
+      auto *small = new Node48();
+      copyHeader(small, n);
+      u8 next = 0;
+      for (u32 b = 0; b < 256; ++b) {
+        if (n->children[b]) {
+          small->children[next] = n->children[b];
+          small->index[b] = ++next;
+        }
+      }
+      delete n;
+      slot = Child(static_cast<Inner *>(small));
+    } else if (node->type == NodeType::N48 && node->count <= 12) {
+      auto *n = static_cast<Node48 *>(node);
+      auto *small = new Node16();
+      copyHeader(small, n);
+      u16 next = 0;
+      for (u32 b = 0; b < 256; ++b) {
+        if (n->index[b] != 0) {
+          small->keys[next] = static_cast<u8>(b);
+          small->children[next++] = n->children[n->index[b] - 1];
+        }
+      }
+      delete n;
+      slot = Child(static_cast<Inner *>(small));
+    } else if (node->type == NodeType::N16 && node->count <= 3) {
+      auto *n = static_cast<Node16 *>(node);
+      auto *small = new Node4();
+      copyHeader(small, n);
+      std::memcpy(small->keys, n->keys, n->count);
+      std::copy(n->children, n->children + n->count, small->children);
+      delete n;
+      slot = Child(static_cast<Inner *>(small));
+    }
+  }
+
+  /// @brief Any entry below the node; all of them share the node's prefix,
+  /// so this recovers prefix bytes past the kMaxPrefix stored ones
+  static auto anyLeaf(Inner *node) -> Entry * {
+    while (true) {
+      if (node->terminal)
+        return node->terminal;
+      Child first;
+      forEachChild(node, [&first](u8, Child c) {
+        if (!first)
+          first = c;
+      });
+      if (first.isLeaf())
+        return first.leaf();
+      node = first.inner();
+    }
+  }
+
+  /// @brief How many bytes of the node's prefix match key[depth...]
+  static auto prefixMismatch(Inner *node, std::string_view key, usize depth)
+      -> u32 {
+    u32 limit = static_cast<u32>(
+        std::min<usize>(node->prefixLen, key.size() - depth));
+    u32 stored = std::min(limit, kMaxPrefix);
+    u32 i = 0;
+    for (; i < stored; ++i)
+      if (node->prefix[i] != static_cast<u8>(key[depth + i]))
+        return i;
+    if (i < limit) {
+      const std::string &full = anyLeaf(node)->key;
+      for (; i < limit; ++i)
+        if (full[depth + i] != key[depth + i])
+          return i;
+    }
+    return i;
+  }
+
+  static auto setPrefix(Inner *node, const char *bytes, u32 length) -> void {
+    node->prefixLen = length;
+    std::memcpy(node->prefix, bytes, std::min(length, kMaxPrefix));
+  }
+
+  /// @brief Places an entry in a node: as its terminal if the key ends at
+  /// `depth`, otherwise under the key's next byte
+  static auto attach(Child &slot, Inner *node, Entry *entry, usize depth)
+      -> void {
+    if (entry->key.size() == depth)
+      node->terminal = entry;
+    else
+      addChild(slot, node, static_cast<u8>(entry->key[depth]), Child(entry));
+  }
+
+  /// @brief Finds or inserts `key`; returns the entry and whether it is new
+  template <typename F>
+  auto insertAt(Child &slot, std::string_view key, usize depth, F &&make)
+      -> std::pair<Entry *, bool> {
+    if (!slot) {
+      Entry *entry = make();
+      slot = Child(entry);
+      return {entry, true};
+    }
+
+    if (slot.isLeaf()) {
+      Entry *existing = slot.leaf();
+      if (existing->key == key)
+        return {existing, false};
+      // Two keys now share this slot: branch at their first difference
+      usize common = 0;
+      usize limit = std::min(existing->key.size(), key.size()) - depth;
+      while (common < limit && existing->key[depth + common] == key[depth + common])
+        ++common;
+      auto *node = new Node4();
+      setPrefix(node, key.data() + depth, static_cast<u32>(common));
+      Child nodeSlot(static_cast<Inner *>(node));
+      Entry *entry = make();
+      attach(nodeSlot, node, existing, depth + common);
+      attach(nodeSlot, node, entry, depth + common);
+      slot = nodeSlot;
+      return {entry, true};
+    }
+
+    Inner *node = slot.inner();
+    if (node->prefixLen != 0) {
+      u32 match = prefixMismatch(node, key, depth);
+      if (match < node->prefixLen) {
+        // The key leaves the prefix early: split it at the mismatch
+        auto *parent = new Node4();
+        setPrefix(parent, key.data() + depth, match);
+        Child parentSlot(static_cast<Inner *>(parent));
+        u8 edge;
+        u32 rest = node->prefixLen - match - 1;
+        if (node->prefixLen <= kMaxPrefix) {
+          edge = node->prefix[match];
+          std::memmove(node->prefix, node->prefix + match + 1, rest);
+          node->prefixLen = rest;
+        } else {
+          const std::string &full = anyLeaf(node)->key;
+          edge = static_cast<u8>(full[depth + match]);
+          setPrefix(node, full.data() + depth + match + 1, rest);
+        }
+        addChild(parentSlot, parent, edge, slot);
+        Entry *entry = make();
+        attach(parentSlot, parent, entry, depth + match);
+        slot = parentSlot;
+        return {entry, true};
+      }
+      depth += node->prefixLen;
+    }
+
+    if (depth == key.size()) {
+      if (node->terminal)
+        return {node->terminal, false};
+      node->terminal = make();
+      return {node->terminal, true};
+    }
+
+    u8 byte = static_cast<u8>(key[depth]);
+    if (Child *child = findChild(node, byte))
+      return insertAt(*child, key, depth + 1, make);
+    Entry *entry = make();
+    addChild(slot, node, byte, Child(entry));
+    return {entry, true};
+  }
+
+  /// @brief Folds a node that lost an entry into something smaller: nothing,
+  /// its only remaining entry, or its only child (merging the prefixes)
+  static auto compact(Child &slot) -> void {
+    Inner *node = slot.inner();
+    if (node->count == 0) {
+      slot = node->terminal ? Child(node->terminal) : Child();
+      node->terminal = nullptr;
+      destroy(Child(node));
+      return;
+    }
+    if (node->count == 1 && node->terminal == nullptr) {
+      u8 edge = 0;
+      Child only;
+      forEachChild(node, [&](u8 b, Child c) {
+        edge = b;
+        only = c;
+      });
+      if (!only.isLeaf()) {
+        Inner *child = only.inner();
+        u8 merged[kMaxPrefix];
+        u32 length = std::min(node->prefixLen, kMaxPrefix);
+        std::memcpy(merged, node->prefix, length);
+        if (length < kMaxPrefix)
+          merged[length++] = edge;
+        u32 take = std::min(child->prefixLen, kMaxPrefix - length);
+        std::memcpy(merged + length, child->prefix, take);
+        child->prefixLen += node->prefixLen + 1;
+        std::memcpy(child->prefix, merged, kMaxPrefix);
+      }
+      removeChild(node, edge);
+      destroy(Child(node));
+      slot = only;
+      return;
+    }
+    shrink(slot, node);
+  }
+
+  auto eraseAt(Child &slot, std::string_view key, usize depth) -> bool {
+    if (!slot)
+      return false;
+    if (slot.isLeaf()) {
+      if (slot.leaf()->key != key)
+        return false;
+      delete slot.leaf();
+      slot = Child();
+      return true;
+    }
+
+    Inner *node = slot.inner();
+    if (prefixMismatch(node, key, depth) != node->prefixLen)
+      return false;
+    depth += node->prefixLen;
+
+    if (depth == key.size()) {
+      if (node->terminal == nullptr)
+        return false;
+      delete node->terminal;
+      node->terminal = nullptr;
+      compact(slot);
+      return true;
+    }
+
+    u8 byte = static_cast<u8>(key[depth]);
+    Child *child = findChild(node, byte);
+    if (child == nullptr || !eraseAt(*child, key, depth + 1))
+      return false;
+    if (!*child) {
+      removeChild(node, byte);
+      compact(slot);
+    }
+    return true;
+  }
+
+  auto findEntry(std::string_view key) const -> Entry * {
+    Child child = _root;
+    usize depth = 0;
+    while (child) {
+      if (child.isLeaf())
+        return child.leaf()->key == key ? child.leaf() : nullptr;
+      Inner *node = child.inner();
+      // Only the stored prefix bytes are checked here; the entry found at
+      // the end is compared in full
+      if (node->prefixLen != 0) {
+        if (key.size() - depth < node->prefixLen)
+          return nullptr;
+        u32 stored = std::min(node->prefixLen, kMaxPrefix);
+        if (std::memcmp(node->prefix, key.data() + depth, stored) != 0)
+          return nullptr;
+        depth += node->prefixLen;
+      }
+      if (depth == key.size())
+        return node->terminal && node->terminal->key == key ? node->terminal
+                                                            : nullptr;
+      Child *next = findChild(node, static_cast<u8>(key[depth++]));
+      if (next == nullptr)
+        return nullptr;
+      child = *next;
+    }
+    return nullptr;
+  }
+
+  template <typename F> static auto visit(Child child, F &fn) -> void {
+    if (child.isLeaf()) {
+      fn(std::as_const(child.leaf()->key), child.leaf()->value);
+      return;
+    }
+    Inner *node = child.inner();
+    if (node->terminal)
+      fn(std::as_const(node->terminal->key), node->terminal->value);
+    forEachChild(node, [&fn](u8, Child c) { visit(c, fn); });
+  }
+
+  static auto startsWith(std::string_view str, std::string_view prefix)
+      -> bool {
+    return str.size() >= prefix.size() &&
+           std::memcmp(str.data(), prefix.data(), prefix.size()) == 0;
+  }
+
+public:
+  RadixTree() = default;
+
+  RadixTree(const RadixTree &other) {
+    other.forEach([this](const std::string &key, const V &value) {
+      insert(key, value);
+    });
+  }
+
+  RadixTree(RadixTree &&other) noexcept
+      : _root(std::exchange(other._root, Child())),
+        _size(std::exchange(other._size, 0)) {}
+
+  ~RadixTree() { destroy(_root); }
+
+  auto operator=(const RadixTree &other) -> RadixTree & {
+    if (this != &other) {
+      RadixTree copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  auto operator=(RadixTree &&other) noexcept -> RadixTree & {
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+
+  auto swap(RadixTree &other) noexcept -> void {
+    std::swap(_root, other._root);
+    std::swap(_size, other._size);
+  }
+
+  auto size() const -> usize { return _size; }
+  auto empty() const -> bool { return _size == 0; }
+
+  auto clear() -> void {
+    destroy(_root);
+    _root = Child();
+    _size = 0;
+  }
+
+  /// @brief Inserts if `key` is absent, returns whether it was inserted
+  auto insert(std::string_view key, V value) -> bool {
+    auto [entry, inserted] = insertAt(_root, key, 0, [&] {
+      return new Entry{std::string(key), std::move(value)};
+    });
+    _size += inserted;
+    return inserted;
+  }
+
+  /// @brief Inserts or overwrites, returns true if `key` was new
+  auto insertOrAssign(std::string_view key, V value) -> bool {
+    auto [entry, inserted] = insertAt(_root, key, 0, [&] {
+      return new Entry{std::string(key), V()};
+    });
+    entry->value = std::move(value);
+    _size += inserted;
+    return inserted;
+  }
+
+  auto operator[](std::string_view key) -> V & {
+    auto [entry, inserted] = insertAt(_root, key, 0, [&] {
+      return new Entry{std::string(key), V()};
+    });
+    _size += inserted;
+    return entry->value;
+  }
+
+  auto find(std::string_view key) -> V * {
+    Entry *entry = findEntry(key);
+    return entry ? &entry->value : nullptr;
+  }
+
+  auto find(std::string_view key) const -> const V * {
+    Entry *entry = findEntry(key);
+    return entry ? &entry->value : nullptr;
+  }
+
+  auto contains(std::string_view key) const -> bool {
+    return findEntry(key) != nullptr;
+  }
+
+  /// @brief Removes `key`, returns whether it was present
+  auto erase(std::string_view key) -> bool {
+    bool erased = eraseAt(_root, key, 0);
+    _size -= erased;
+    return erased;
+  }
+
+  /// @brief The entry with the longest key that is a prefix of `query`
+  /// (e.g. the most specific route for a path), or nullptr
+  auto longestPrefixMatch(std::string_view query) const -> const Entry * {
+    const Entry *best = nullptr;
+    Child child = _root;
+    usize depth = 0;
+    while (child) {
+      if (child.isLeaf()) {
+        if (startsWith(query, child.leaf()->key))
+          best = child.leaf();
+        break;
+      }
+      Inner *node = child.inner();
+      if (node->prefixLen != 0) {
+        if (query.size() - depth < node->prefixLen)
+          break;
+        u32 stored = std::min(node->prefixLen, kMaxPrefix);
+        if (std::memcmp(node->prefix, query.data() + depth, stored) != 0)
+          break;
+        depth += node->prefixLen;
+      }
+      if (node->terminal && startsWith(query, node->terminal->key))
+        best = node->terminal;
+      if (depth == query.size())
+        break;
+      Child *next = findChild(node, static_cast<u8>(query[depth++]));
+      if (next == nullptr)
+        break;
+      child = *next;
+    }
+    return best;
+  }
+
+  /// @brief Calls fn(const std::string &key, V &value) for every entry in
+  /// lexicographic (byte) order
+  template <typename F> auto forEach(F &&fn) -> void {
+    if (_root)
+      visit(_root, fn);
+  }
+
+  template <typename F> auto forEach(F &&fn) const -> void {
+    auto constFn = [&fn](const std::string &key, const V &value) {
+      fn(key, value);
+    };
+    if (_root)
+      visit(_root, constFn);
+  }
+
+  /// @brief Calls fn(key, value) in order for every entry whose key starts
+  /// with `prefix`, visiting only that subtree
+  template <typename F>
+  auto forEachWithPrefix(std::string_view prefix, F &&fn) -> void {
+    Child child = _root;
+    usize depth = 0;
+    while (child) {
+      if (child.isLeaf()) {
+        if (startsWith(child.leaf()->key, prefix))
+          visit(child, fn);
+        return;
+      }
+      Inner *node = child.inner();
+      if (prefixMismatch(node, prefix, depth) !=
+          std::min<usize>(node->prefixLen, prefix.size() - depth))
+        return;
+      if (depth + node->prefixLen >= prefix.size()) {
+        visit(child, fn);
+        return;
+      }
+      depth += node->prefixLen;
+      Child *next = findChild(node, static_cast<u8>(prefix[depth++]));
+      if (next == nullptr)
+        return;
+      child = *next;
+    }
+  }
+
+  template <typename F>
+  auto forEachWithPrefix(std::string_view prefix, F &&fn) const -> void {
+    auto constFn = [&fn](const std::string &key, const V &value) {
+      fn(key, value);
+    };
+    const_cast<RadixTree *>(this)->forEachWithPrefix(prefix, constFn);
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef Roots_Structures_RoaringBitmap_hpp
+#define Roots_Structures_RoaringBitmap_hpp
+
+#include "../_defines.hpp"
+#include "../Error.hpp"
+#include "../bws_result.hpp"
+#include <bit>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <vector>
+
+namespace roots::structures {
+
+using namespace roots::err;
+
+/// @brief A compressed bitmap of u32 values (roaring bitmap). Values are
+/// grouped by their high 16 bits into containers, each stored in whichever of
+/// three forms is smallest:
+///  - Array:  sorted u16 values (up to 4096 of them)
+///  - Bitmap: 65536 bits (8 KiB), for dense containers
+///  - Run:    sorted (start, length - 1) pairs, after runOptimize()
+/// This is the scalable counterpart to BitFlags for large, sparse or dense ID
+/// sets; intersections and unions work container by container
+class RoaringBitmap {
+public:
+  enum class ContainerType : u8 { Array = 0, Bitmap = 1, Run = 2 };
+
+  static constexpr u32 kMaxArraySize = 4096;
+  static constexpr u32 kBitmapWords = 65536 / 64;
+
+  struct Container {
+    ContainerType type = ContainerType::Array;
+    u32 cardinality = 0;
+    // Array: the values; Run: interleaved (start, length - 1) pairs
+    std::vector<u16> values;
+    // Bitmap: kBitmapWords words
+    std::vector<u64> bits;
+  };
+
+private:
+  friend class RoaringBitmapView;
+
+  std::vector<u16> _keys;
+  std::vector<Container> _containers;
+
+  auto findContainer(u16 key) const -> isize;
+  auto containerFor(u16 key) -> Container &;
+  auto eraseContainer(usize index) -> void;
+
+public:
+  /// @brief Iterates the values in increasing order
+  class Iterator {
+    const RoaringBitmap *_bitmap = nullptr;
+    usize _container = 0;
+    usize _pos = 0;  // array index, bitmap word or run index
+    u64 _bits = 0;   // bitmap: unvisited bits of the current word
+    u32 _offset = 0; // run: offset within the current run
+    u32 _value = 0;
+
+    auto load() -> void;
+    auto advance() -> void;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = u32;
+    using difference_type = isize;
+    using reference = u32;
+    using pointer = void;
+
+    Iterator() = default;
+    Iterator(const RoaringBitmap *bitmap, usize container);
+
+    auto operator*() const -> u32 { return _value; }
+
+    auto operator++() -> Iterator & {
+      advance();
+      return *this;
+    }
+
+    auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      advance();
+      return tmp;
+    }
+
+    auto operator==(const Iterator &other) const -> bool {
+      return _container == other._container && _pos == other._pos &&
+             _bits == other._bits && _offset == other._offset;
+    }
+  };
+
+  RoaringBitmap() = default;
+  RoaringBitmap(std::initializer_list<u32> values);
+
+  /// @brief Builds a bitmap from values in any order
+  static auto fromValues(std::span<const u32> values) -> RoaringBitmap;
+
+  /// @brief Adds a value, returns true if it wasn't present
+  auto add(u32 value) -> bool;
+
+  /// @brief Adds every value in [first, last)
+  auto addRange(u64 first, u64 last) -> void;
+
+  /// @brief Removes a value, returns true if it was present
+  auto remove(u32 value) -> bool;
+
+  auto contains(u32 value) const -> bool;
+
+  /// @brief The number of values in the bitmap
+  auto cardinality() const -> u64;
+
+  auto empty() const -> bool { return _containers.empty(); }
+
+  auto clear() -> void;
+
+  /// @brief The smallest value (undefined if empty)
+  auto minimum() const -> u32;
+
+  /// @brief The largest value (undefined if empty)
+  auto maximum() const -> u32;
+
+  /// @brief Converts containers to run form wherever that is smaller. Best
+  /// called once a bitmap has been built; modifying a run container converts
+  /// it back to array/bitmap form
+  auto runOptimize() -> void;
+
+  /// @brief Bytes used by the container payloads (not counting overhead)
+  auto sizeInBytes() const -> usize;
+
+  auto containerCount() const -> usize { return _containers.size(); }
+
+  auto operator&=(const RoaringBitmap &other) -> RoaringBitmap &;
+  auto operator|=(const RoaringBitmap &other) -> RoaringBitmap &;
+
+  /// @brief Removes every value that is also in `other`
+  auto andNot(const RoaringBitmap &other) -> RoaringBitmap &;
+
+  friend auto operator&(const RoaringBitmap &a, const RoaringBitmap &b)
+      -> RoaringBitmap;
+  friend auto operator|(const RoaringBitmap &a, const RoaringBitmap &b)
+      -> RoaringBitmap;
+
+  /// @brief The size of the intersection, without building it
+  auto andCardinality(const RoaringBitmap &other) const -> u64;
+
+  auto intersects(const RoaringBitmap &other) const -> bool;
+
+  auto operator==(const RoaringBitmap &other) const -> bool;
+
+  auto begin() const -> Iterator { return Iterator(this, 0); }
+  auto end() const -> Iterator { return Iterator(this, _containers.size()); }
+
+  /// @brief Calls fn(u32) for every value in increasing order (faster than
+  /// iterators for bitmap containers)
+  template <typename F> auto forEach(F &&fn) const -> void {
+    for (usize i = 0; i < _containers.size(); ++i) {
+      u32 high = static_cast<u32>(_keys[i]) << 16;
+      const Container &c = _containers[i];
+      switch (c.type) {
+      case ContainerType::Array:
+        for (u16 v : c.values)
+          fn(high | v);
+        break;
+      case ContainerType::Bitmap:
+        for (u32 w = 0; w < kBitmapWords; ++w) {
+          for (u64 bits = c.bits[w]; bits != 0; bits &= bits - 1)
+            fn(high | (w * 64 + static_cast<u32>(std::countr_zero(bits))));
+        }
+        break;
+      case ContainerType::Run:
+        for (usize r = 0; r < c.values.size(); r += 2) {
+          u32 start = c.values[r];
+          u32 end = start + c.values[r + 1];
+          for (u32 v = start; v <= end; ++v)
+            fn(high | v);
+        }
+        break;
+      }
+    }
+  }
+
+  auto toVector() const -> std::vector<u32>;
+
+  /// @brief Serializes to the portable format read by deserialize() and
+  /// RoaringBitmapView: little-endian, with every container at an 8-byte
+  /// aligned offset so the buffer can be used in place (e.g. memory mapped)
+  auto serialize() const -> std::vector<u8>;
+
+  static auto deserialize(std::span<const u8> bytes)
+      -> roots::result<RoaringBitmap, Error>;
+};
+
+/// @brief Read-only access to a serialized RoaringBitmap without copying it
+/// into memory first, e.g. over a memory-mapped file. The buffer must outlive
+/// the view
+class RoaringBitmapView {
+  friend class RoaringBitmap;
+
+  std::span<const u8> _bytes;
+  u32 _count = 0;
+
+  auto descriptor(u32 index) const -> const u8 *;
+  auto findContainer(u16 key) const -> isize;
+
+public:
+  RoaringBitmapView() = default;
+
+  /// @brief Validates the header, the container table and every container
+  /// payload of a serialized bitmap, so untrusted input is rejected here
+  /// rather than misread later. Opening scans the whole buffer once
+  static auto open(std::span<const u8> bytes)
+      -> roots::result<RoaringBitmapView, Error>;
+
+  auto contains(u32 value) const -> bool;
+  auto cardinality() const -> u64;
+  auto containerCount() const -> usize { return _count; }
+
+  /// @brief Copies the view into a regular, mutable bitmap
+  auto materialize() const -> RoaringBitmap;
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef Roots_Structures_Rope_hpp
+#define Roots_Structures_Rope_hpp
+
+#include "../_defines.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace roots::structures {
+
+namespace detail {
+struct RopeNode;
+} // namespace detail
+
+/// @brief A line and column (both zero-based, the column in bytes)
+struct TextPosition {
+  usize line = 0;
+  usize column = 0;
+
+  auto operator==(const TextPosition &other) const -> bool = default;
+};
+
+/// @brief Text stored as a balanced B-tree of chunks (up to 1 KiB each,
+/// 16 children per node), for large buffers that see many small edits.
+/// insert, erase and slice touch only the O(log n) nodes on the paths to
+/// the edit, instead of moving the whole tail of a std::string. Every node
+/// caches its byte and newline counts, so line/column conversions are
+/// O(log n) too and stay current as the text changes. Nodes are shared
+/// between copies and copied on write, so copying a Rope is an O(1)
+/// snapshot; an unshared rope is edited in place
+class Rope {
+  std::shared_ptr<detail::RopeNode> _root;
+
+public:
+  /// @brief Creates an empty rope
+  Rope();
+
+  Rope(std::string_view text);
+
+  /// @brief The length in bytes
+  auto size() const -> usize;
+  auto empty() const -> bool { return size() == 0; }
+
+  /// @brief The number of lines (newlines + 1, so "" has one line)
+  auto lineCount() const -> usize;
+
+  /// @brief The byte at `pos`
+  auto at(usize pos) const -> i8;
+
+  /// @brief Inserts `text` before byte `pos`
+  auto insert(usize pos, std::string_view text) -> void;
+
+  auto append(std::string_view text) -> void { insert(size(), text); }
+
+  /// @brief Removes up to `count` bytes starting at `pos`
+  auto erase(usize pos, usize count) -> void;
+
+  /// @brief A rope of up to `count` bytes starting at `pos`, sharing every
+  /// chunk that lies wholly inside the range
+  auto slice(usize pos, usize count) const -> Rope;
+
+  /// @brief A copy of up to `count` bytes starting at `pos`
+  auto substr(usize pos, usize count) const -> std::string;
+
+  /// @brief The whole text as one string
+  auto str() const -> std::string;
+
+  /// @brief The byte offset where line `line` starts
+  auto lineStart(usize line) const -> usize;
+
+  /// @brief The text of line `line`, without its newline
+  auto line(usize line) const -> std::string;
+
+  /// @brief The line and column of byte offset `pos`
+  auto positionOf(usize pos) const -> TextPosition;
+
+  /// @brief The byte offset of a line and column
+  auto offsetOf(TextPosition position) const -> usize;
+
+  /// @brief Calls fn(std::string_view) for each chunk in order
+  auto forEachChunk(const std::function<void(std::string_view)> &fn) const
+      -> void;
+
+  /// @brief Calls fn(std::string_view) for the parts of chunks that overlap
+  /// [pos, pos + count), in order
+  auto forEachChunk(usize pos, usize count,
+                    const std::function<void(std::string_view)> &fn) const
+      -> void;
+
+  /// @brief The tree height (1 for a single chunk), mostly for diagnostics
+  auto height() const -> usize;
+
+  auto operator==(const Rope &other) const -> bool;
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,407 @@
+#ifndef Roots_Structures_SmallVector_hpp
+#define Roots_Structures_SmallVector_hpp
+
+#include "../_defines.hpp"
+#include "../Memory.hpp"
+#include <algorithm>
+#include <compare>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace roots::structures {
+
+/// @brief Whether a T can be moved to a new address with a plain memcpy (the
+/// source is then treated as dead without running its destructor). Specialize
+/// this for types that are not trivially copyable but are still safe to
+/// relocate bitwise (most types that don't hold pointers into themselves)
+template <typename T>
+struct IsTriviallyRelocatable
+    : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template <typename T>
+inline constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<T>::value;
+
+/// @brief Moves `count` objects from `src` into the uninitialized memory at
+/// `dst`, leaving `src` as raw memory
+template <typename T>
+auto relocate(T *src, usize count, T *dst) -> void {
+  if constexpr (kIsTriviallyRelocatable<T>) {
+    if (count != 0)
+      std::memmove(static_cast<void *>(dst), static_cast<const void *>(src),
+                   count * sizeof(T));
+  } else {
+    std::uninitialized_move_n(src, count, dst);
+    std::destroy_n(src, count);
+  }
+}
+
+/// @brief Picks an inline element count that keeps a SmallVector<T> around
+/// 64 bytes (always at least one element)
+template <typename T>
+inline constexpr usize kSmallVectorDefaultInline =
+    sizeof(T) * 4 <= 64 - 3 * sizeof(void *)
+        ? (64 - 3 * sizeof(void *)) / sizeof(T)
+        : 1;
+
+/// @brief A vector that stores up to N elements inline and only allocates
+/// (through roots::mem) once it grows past that. The API mirrors std::vector
+template <typename T, usize N = kSmallVectorDefaultInline<T>>
+class SmallVector {
+  static_assert(N > 0, "SmallVector needs at least one inline element");
+
+  T *_begin;
+  usize _size;
+  usize _capacity;
+  alignas(T) u8 _inline[N * sizeof(T)];
+
+  auto inlineData() -> T * { return reinterpret_cast<T *>(_inline); }
+  auto inlineData() const -> const T * {
+    return reinterpret_cast<const T *>(_inline);
+  }
+
+  static auto allocate(usize count) -> T * {
+    return static_cast<T *>(mem::allocAligned(count * sizeof(T), alignof(T)));
+  }
+
+  auto release() -> void {
+    if (!isInline())
+      mem::freeAligned(_begin, _capacity * sizeof(T), alignof(T));
+  }
+
+  auto growTo(usize capacity) -> void {
+    T *mem = allocate(capacity);
+    relocate(_begin, _size, mem);
+    release();
+    _begin = mem;
+    _capacity = capacity;
+  }
+
+  auto grownCapacity(usize minimum) const -> usize {
+    return std::max(minimum, _capacity * 2);
+  }
+
+  /// @brief Makes room for `extra` more elements, growing geometrically so
+  /// that repeated small growths stay amortized O(1)
+  auto reserveExtra(usize extra) -> void {
+    if (_size + extra > _capacity)
+      growTo(grownCapacity(_size + extra));
+  }
+
+  // Takes ownership of other's elements, other must be empty afterwards
+  auto stealFrom(SmallVector &other) -> void {
+    if (other.isInline()) {
+      relocate(other._begin, other._size, _begin);
+      _size = other._size;
+    } else {
+      _begin = other._begin;
+      _size = other._size;
+      _capacity = other._capacity;
+      other._begin = other.inlineData();
+      other._capacity = N;
+    }
+    other._size = 0;
+  }
+
+public:
+  using value_type = T;
+  using size_type = usize;
+  using difference_type = isize;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  static constexpr usize kInlineCapacity = N;
+
+  SmallVector() : _begin(inlineData()), _size(0), _capacity(N) {}
+
+  explicit SmallVector(usize count) : SmallVector() { resize(count); }
+
+  SmallVector(usize count, const T &value) : SmallVector() {
+    assign(count, value);
+  }
+
+  SmallVector(std::initializer_list<T> init) : SmallVector() {
+    assign(init.begin(), init.end());
+  }
+
+  template <std::input_iterator It>
+  SmallVector(It first, It last) : SmallVector() {
+    assign(first, last);
+  }
+
+  SmallVector(const SmallVector &other) : SmallVector() {
+    assign(other.begin(), other.end());
+  }
+
+  SmallVector(SmallVector &&other) noexcept(
+      kIsTriviallyRelocatable<T> || std::is_nothrow_move_constructible_v<T>)
+      : SmallVector() {
+    stealFrom(other);
+  }
+
+  ~SmallVector() {
+    std::destroy_n(_begin, _size);
+    release();
+  }
+
+  auto operator=(const SmallVector &other) -> SmallVector & {
+    if (this != &other)
+      assign(other.begin(), other.end());
+    return *this;
+  }
+
+  auto operator=(SmallVector &&other) noexcept(
+      kIsTriviallyRelocatable<T> || std::is_nothrow_move_constructible_v<T>)
+      -> SmallVector & {
+    if (this == &other)
+      return *this;
+    clear();
+    if (!other.isInline()) {
+      release();
+      _begin = inlineData();
+      _capacity = N;
+    }
+    stealFrom(other);
+    return *this;
+  }
+
+  auto operator=(std::initializer_list<T> init) -> SmallVector & {
+    assign(init.begin(), init.end());
+    return *this;
+  }
+
+  auto assign(usize count, const T &value) -> void {
+    // value may be one of our elements, which clearing would destroy
+    T copy(value);
+    clear();
+    reserve(count);
+    std::uninitialized_fill_n(_begin, count, copy);
+    _size = count;
+  }
+
+  template <std::input_iterator It> auto assign(It first, It last) -> void {
+    clear();
+    if constexpr (std::forward_iterator<It>)
+      reserve(static_cast<usize>(std::distance(first, last)));
+    for (; first != last; ++first)
+      emplace_back(*first);
+  }
+
+  auto assign(std::initializer_list<T> init) -> void {
+    assign(init.begin(), init.end());
+  }
+
+  /// @brief Returns true while the elements still live in the inline buffer
+  auto isInline() const -> bool { return _begin == inlineData(); }
+
+  auto at(usize index) -> T & {
+    if (index >= _size)
+      throw std::out_of_range("SmallVector index out of range");
+    return _begin[index];
+  }
+
+  auto at(usize index) const -> const T & {
+    if (index >= _size)
+      throw std::out_of_range("SmallVector index out of range");
+    return _begin[index];
+  }
+
+  auto operator[](usize index) -> T & { return _begin[index]; }
+  auto operator[](usize index) const -> const T & { return _begin[index]; }
+
+  auto front() -> T & { return _begin[0]; }
+  auto front() const -> const T & { return _begin[0]; }
+  auto back() -> T & { return _begin[_size - 1]; }
+  auto back() const -> const T & { return _begin[_size - 1]; }
+
+  auto data() -> T * { return _begin; }
+  auto data() const -> const T * { return _begin; }
+
+  auto begin() -> iterator { return _begin; }
+  auto begin() const -> const_iterator { return _begin; }
+  auto cbegin() const -> const_iterator { return _begin; }
+  auto end() -> iterator { return _begin + _size; }
+  auto end() const -> const_iterator { return _begin + _size; }
+  auto cend() const -> const_iterator { return _begin + _size; }
+  auto rbegin() -> reverse_iterator { return reverse_iterator(end()); }
+  auto rbegin() const -> const_reverse_iterator {
+    return const_reverse_iterator(end());
+  }
+  auto rend() -> reverse_iterator { return reverse_iterator(begin()); }
+  auto rend() const -> const_reverse_iterator {
+    return const_reverse_iterator(begin());
+  }
+
+  auto empty() const -> bool { return _size == 0; }
+  auto size() const -> usize { return _size; }
+  auto capacity() const -> usize { return _capacity; }
+  auto max_size() const -> usize { return static_cast<usize>(-1) / sizeof(T); }
+
+  auto reserve(usize capacity) -> void {
+    if (capacity > _capacity)
+      growTo(capacity);
+  }
+
+  /// @brief Moves the elements back inline if they fit, otherwise trims the
+  /// heap buffer down to size
+  auto shrink_to_fit() -> void {
+    if (isInline() || _size == _capacity)
+      return;
+
+    T *heap = _begin;
+    usize heapCapacity = _capacity;
+    if (_size <= N) {
+      _begin = inlineData();
+      _capacity = N;
+    } else {
+      _begin = allocate(_size);
+      _capacity = _size;
+    }
+    relocate(heap, _size, _begin);
+    mem::freeAligned(heap, heapCapacity * sizeof(T), alignof(T));
+  }
+
+  auto clear() -> void {
+    std::destroy_n(_begin, _size);
+    _size = 0;
+  }
+
+  template <typename... Args> auto emplace_back(Args &&...args) -> T & {
+    if (_size == _capacity) {
+      // Construct first, args may alias an element that is about to move
+      usize capacity = grownCapacity(_size + 1);
+      T *mem = allocate(capacity);
+      std::construct_at(mem + _size, std::forward<Args>(args)...);
+      relocate(_begin, _size, mem);
+      release();
+      _begin = mem;
+      _capacity = capacity;
+    } else {
+      std::construct_at(_begin + _size, std::forward<Args>(args)...);
+    }
+    return _begin[_size++];
+  }
+
+  auto push_back(const T &value) -> void { emplace_back(value); }
+  auto push_back(T &&value) -> void { emplace_back(std::move(value)); }
+
+  auto pop_back() -> void { std::destroy_at(_begin + --_size); }
+
+  template <typename... Args>
+  auto emplace(const_iterator pos, Args &&...args) -> iterator {
+    usize offset = static_cast<usize>(pos - begin());
+    if (offset == _size) {
+      emplace_back(std::forward<Args>(args)...);
+      return begin() + offset;
+    }
+
+    T value(std::forward<Args>(args)...);
+    emplace_back(std::move(back()));
+    std::move_backward(begin() + offset, end() - 2, end() - 1);
+    _begin[offset] = std::move(value);
+    return begin() + offset;
+  }
+
+  auto insert(const_iterator pos, const T &value) -> iterator {
+    return emplace(pos, value);
+  }
+
+  auto insert(const_iterator pos, T &&value) -> iterator {
+    return emplace(pos, std::move(value));
+  }
+
+  auto insert(const_iterator pos, usize count, const T &value) -> iterator {
+    usize offset = static_cast<usize>(pos - begin());
+    T copy(value);
+    reserveExtra(count);
+    std::uninitialized_fill_n(end(), count, copy);
+    _size += count;
+    std::rotate(begin() + offset, end() - count, end());
+    return begin() + offset;
+  }
+
+  template <std::input_iterator It>
+  auto insert(const_iterator pos, It first, It last) -> iterator {
+    usize offset = static_cast<usize>(pos - begin());
+    usize oldSize = _size;
+    if constexpr (std::forward_iterator<It>)
+      reserveExtra(static_cast<usize>(std::distance(first, last)));
+    for (; first != last; ++first)
+      emplace_back(*first);
+    std::rotate(begin() + offset, begin() + oldSize, end());
+    return begin() + offset;
+  }
+
+  auto insert(const_iterator pos, std::initializer_list<T> init) -> iterator {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  auto erase(const_iterator pos) -> iterator { return erase(pos, pos + 1); }
+
+  auto erase(const_iterator first, const_iterator last) -> iterator {
+    T *from = begin() + (first - begin());
+    T *to = begin() + (last - begin());
+    if (from == to)
+      return from;
+    T *newEnd = std::move(to, end(), from);
+    std::destroy(newEnd, end());
+    _size = static_cast<usize>(newEnd - _begin);
+    return from;
+  }
+
+  auto resize(usize count) -> void {
+    if (count < _size) {
+      std::destroy(begin() + count, end());
+    } else if (count > _size) {
+      reserveExtra(count - _size);
+      std::uninitialized_value_construct(end(), begin() + count);
+    }
+    _size = count;
+  }
+
+  auto resize(usize count, const T &value) -> void {
+    if (count < _size) {
+      std::destroy(begin() + count, end());
+      _size = count;
+    } else if (count > _size) {
+      insert(end(), count - _size, value);
+    }
+  }
+
+  auto swap(SmallVector &other) -> void {
+    if (!isInline() && !other.isInline()) {
+      std::swap(_begin, other._begin);
+      std::swap(_size, other._size);
+      std::swap(_capacity, other._capacity);
+      return;
+    }
+    SmallVector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  friend auto swap(SmallVector &a, SmallVector &b) -> void { a.swap(b); }
+
+  auto operator==(const SmallVector &other) const -> bool {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+
+  auto operator<=>(const SmallVector &other) const {
+    return std::lexicographical_compare_three_way(begin(), end(),
+                                                  other.begin(), other.end());
+  }
+};
+
+} // namespace roots::structures
+
+#endif
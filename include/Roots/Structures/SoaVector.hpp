@@ -0,0 +1,403 @@
+#ifndef Roots_Structures_SoaVector_hpp
+#define Roots_Structures_SoaVector_hpp
+
+#include "../_defines.hpp"
+#include "../Memory.hpp"
+#include "SmallVector.hpp"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace roots::structures {
+
+/// @brief A vector of records stored as a struct of arrays: each field lives
+/// in its own contiguous, cache-line aligned column (allocated through
+/// roots::mem), so a loop over one field streams only that field's bytes and
+/// vectorizes like a loop over a plain array. Elements are addressed by index;
+/// column<I>() exposes a field as a std::span and operator[] returns a tuple of
+/// references for code that wants the whole record
+template <typename... Fields> class SoaVector {
+  static_assert(sizeof...(Fields) > 0, "SoaVector needs at least one field");
+
+public:
+  template <usize I>
+  using FieldType = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+  using value_type = std::tuple<Fields...>;
+  using reference = std::tuple<Fields &...>;
+  using const_reference = std::tuple<const Fields &...>;
+
+  static constexpr usize kFieldCount = sizeof...(Fields);
+
+  /// @brief Alignment of every column, enough for aligned SIMD loads
+  static constexpr usize kAlignment =
+      std::max({usize(kRootsCacheLineSize), alignof(Fields)...});
+
+private:
+  using Indices = std::index_sequence_for<Fields...>;
+
+  std::tuple<Fields *...> _columns{};
+  usize _size = 0;
+  usize _capacity = 0;
+
+  template <typename T> static auto allocate(usize count) -> T * {
+    return static_cast<T *>(mem::allocAligned(count * sizeof(T), kAlignment));
+  }
+
+  template <typename T> static auto release(T *column, usize capacity) -> void {
+    if (column != nullptr)
+      mem::freeAligned(column, capacity * sizeof(T), kAlignment);
+  }
+
+  template <typename F> auto eachColumn(F &&fn) -> void {
+    std::apply([&fn](auto *...columns) { (fn(columns), ...); }, _columns);
+  }
+
+  template <usize... Is>
+  auto growTo(usize capacity, std::index_sequence<Is...>) -> void {
+    std::tuple<Fields *...> grown{allocate<Fields>(capacity)...};
+    (relocate(std::get<Is>(_columns), _size, std::get<Is>(grown)), ...);
+    (release(std::get<Is>(_columns), _capacity), ...);
+    _columns = grown;
+    _capacity = capacity;
+  }
+
+  auto growTo(usize capacity) -> void { growTo(capacity, Indices{}); }
+
+  template <usize... Is, typename... Args>
+  auto constructAt(usize index, std::index_sequence<Is...>, Args &&...args)
+      -> void {
+    (std::construct_at(std::get<Is>(_columns) + index,
+                       std::forward<Args>(args)),
+     ...);
+  }
+
+  template <usize... Is>
+  auto refAt(usize index, std::index_sequence<Is...>) -> reference {
+    return reference(std::get<Is>(_columns)[index]...);
+  }
+
+  template <usize... Is>
+  auto refAt(usize index, std::index_sequence<Is...>) const -> const_reference {
+    return const_reference(std::get<Is>(_columns)[index]...);
+  }
+
+  auto destroyFrom(usize first) -> void {
+    eachColumn([this, first](auto *column) {
+      std::destroy(column + first, column + _size);
+    });
+  }
+
+public:
+  /// @brief Iterates by index, dereferencing to a tuple of references (so
+  /// `for (auto [pos, vel] : soa)` binds references to the fields)
+  template <bool Const> class Iterator {
+    using Owner = std::conditional_t<Const, const SoaVector, SoaVector>;
+
+    Owner *_owner = nullptr;
+    usize _index = 0;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = SoaVector::value_type;
+    using difference_type = isize;
+    using reference = std::conditional_t<Const, SoaVector::const_reference,
+                                         SoaVector::reference>;
+    using pointer = void;
+
+    Iterator() = default;
+    Iterator(Owner *owner, usize index) : _owner(owner), _index(index) {}
+
+    auto operator*() const -> reference { return (*_owner)[_index]; }
+    auto operator[](difference_type n) const -> reference {
+      return (*_owner)[_index + n];
+    }
+
+    auto operator++() -> Iterator & {
+      ++_index;
+      return *this;
+    }
+    auto operator++(int) -> Iterator {
+      Iterator tmp = *this;
+      ++_index;
+      return tmp;
+    }
+    auto operator--() -> Iterator & {
+      --_index;
+      return *this;
+    }
+    auto operator--(int) -> Iterator {
+      Iterator tmp = *this;
+      --_index;
+      return tmp;
+    }
+    auto operator+=(difference_type n) -> Iterator & {
+      _index += n;
+      return *this;
+    }
+    auto operator-=(difference_type n) -> Iterator & {
+      _index -= n;
+      return *this;
+    }
+    friend auto operator+(Iterator it, difference_type n) -> Iterator {
+      return it += n;
+    }
+    friend auto operator+(difference_type n, Iterator it) -> Iterator {
+      return it += n;
+    }
+    friend auto operator-(Iterator it, difference_type n) -> Iterator {
+      return it -= n;
+    }
+    friend auto operator-(const Iterator &a, const Iterator &b)
+        -> difference_type {
+      return static_cast<difference_type>(a._index) -
+             static_cast<difference_type>(b._index);
+    }
+
+    auto index() const -> usize { return _index; }
+
+    auto operator==(const Iterator &other) const -> bool {
+      return _index == other._index;
+    }
+    auto operator<=>(const Iterator &other) const {
+      return _index <=> other._index;
+    }
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  SoaVector() = default;
+
+  explicit SoaVector(usize count) { resize(count); }
+
+  SoaVector(const SoaVector &other) {
+    reserve(other._size);
+    copyFrom(other, Indices{});
+  }
+
+  SoaVector(SoaVector &&other) noexcept
+      : _columns(std::exchange(other._columns, {})),
+        _size(std::exchange(other._size, 0)),
+        _capacity(std::exchange(other._capacity, 0)) {}
+
+  ~SoaVector() {
+    clear();
+    std::apply(
+        [this](auto *...columns) { (release(columns, _capacity), ...); },
+        _columns);
+  }
+
+  auto operator=(const SoaVector &other) -> SoaVector & {
+    if (this != &other) {
+      SoaVector copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  auto operator=(SoaVector &&other) noexcept -> SoaVector & {
+    if (this != &other) {
+      SoaVector moved(std::move(other));
+      swap(moved);
+    }
+    return *this;
+  }
+
+  auto swap(SoaVector &other) noexcept -> void {
+    std::swap(_columns, other._columns);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+  }
+
+  friend auto swap(SoaVector &a, SoaVector &b) -> void { a.swap(b); }
+
+  auto size() const -> usize { return _size; }
+  auto capacity() const -> usize { return _capacity; }
+  auto empty() const -> bool { return _size == 0; }
+
+  auto reserve(usize capacity) -> void {
+    if (capacity > _capacity)
+      growTo(capacity);
+  }
+
+  auto shrink_to_fit() -> void {
+    if (_size == _capacity)
+      return;
+    if (_size == 0) {
+      std::apply(
+          [this](auto *...columns) { (release(columns, _capacity), ...); },
+          _columns);
+      _columns = {};
+      _capacity = 0;
+      return;
+    }
+    growTo(_size);
+  }
+
+  auto clear() -> void {
+    destroyFrom(0);
+    _size = 0;
+  }
+
+  /// @brief Appends a record, constructing field I from args[I]
+  template <typename... Args>
+    requires(sizeof...(Args) == sizeof...(Fields) &&
+             (std::is_constructible_v<Fields, Args &&> && ...))
+  auto emplace_back(Args &&...args) -> reference {
+    if (_size == _capacity) {
+      // Construct into the new columns first, args may alias an element
+      usize capacity = std::max<usize>(_size * 2, 8);
+      std::tuple<Fields *...> grown{allocate<Fields>(capacity)...};
+      std::swap(grown, _columns);
+      constructAt(_size, Indices{}, std::forward<Args>(args)...);
+      std::swap(grown, _columns);
+      moveInto(grown, Indices{});
+      _columns = grown;
+      _capacity = capacity;
+    } else {
+      constructAt(_size, Indices{}, std::forward<Args>(args)...);
+    }
+    return refAt(_size++, Indices{});
+  }
+
+  auto push_back(const Fields &...values) -> void { emplace_back(values...); }
+
+  auto push_back(const value_type &record) -> void {
+    std::apply([this](const Fields &...values) { emplace_back(values...); },
+               record);
+  }
+
+  auto pop_back() -> void {
+    --_size;
+    eachColumn([this](auto *column) { std::destroy_at(column + _size); });
+  }
+
+  /// @brief Removes the element at `index`, shifting later elements down
+  auto erase(usize index) -> void { erase(index, index + 1); }
+
+  /// @brief Removes the elements in [first, last)
+  auto erase(usize first, usize last) -> void {
+    if (first == last)
+      return;
+    usize newSize = _size - (last - first);
+    eachColumn([this, first, last](auto *column) {
+      std::move(column + last, column + _size, column + first);
+    });
+    destroyFrom(newSize);
+    _size = newSize;
+  }
+
+  /// @brief Removes the element at `index` in O(1) by moving the last element
+  /// into its place (does not preserve order)
+  auto swapErase(usize index) -> void {
+    usize last = _size - 1;
+    if (index != last)
+      eachColumn([index, last](auto *column) {
+        column[index] = std::move(column[last]);
+      });
+    pop_back();
+  }
+
+  /// @brief Resizes to `count`, value-initializing new elements
+  auto resize(usize count) -> void {
+    if (count < _size) {
+      destroyFrom(count);
+    } else if (count > _size) {
+      reserve(count);
+      eachColumn([this, count](auto *column) {
+        std::uninitialized_value_construct(column + _size, column + count);
+      });
+    }
+    _size = count;
+  }
+
+  auto operator[](usize index) -> reference {
+    return refAt(index, Indices{});
+  }
+
+  auto operator[](usize index) const -> const_reference {
+    return refAt(index, Indices{});
+  }
+
+  auto at(usize index) -> reference {
+    if (index >= _size)
+      throw std::out_of_range("SoaVector index out of range");
+    return refAt(index, Indices{});
+  }
+
+  auto at(usize index) const -> const_reference {
+    if (index >= _size)
+      throw std::out_of_range("SoaVector index out of range");
+    return refAt(index, Indices{});
+  }
+
+  /// @brief Field I of the element at `index`
+  template <usize I> auto get(usize index) -> FieldType<I> & {
+    return std::get<I>(_columns)[index];
+  }
+
+  template <usize I> auto get(usize index) const -> const FieldType<I> & {
+    return std::get<I>(_columns)[index];
+  }
+
+  /// @brief The column holding field I (aligned to kAlignment)
+  template <usize I> auto data() -> FieldType<I> * {
+    return std::get<I>(_columns);
+  }
+
+  template <usize I> auto data() const -> const FieldType<I> * {
+    return std::get<I>(_columns);
+  }
+
+  /// @brief Field I of every element, as a contiguous span
+  template <usize I> auto column() -> std::span<FieldType<I>> {
+    return {std::get<I>(_columns), _size};
+  }
+
+  template <usize I> auto column() const -> std::span<const FieldType<I>> {
+    return {std::get<I>(_columns), _size};
+  }
+
+  auto begin() -> iterator { return iterator(this, 0); }
+  auto end() -> iterator { return iterator(this, _size); }
+  auto begin() const -> const_iterator { return const_iterator(this, 0); }
+  auto end() const -> const_iterator { return const_iterator(this, _size); }
+
+  auto operator==(const SoaVector &other) const -> bool {
+    return _size == other._size && equalColumns(other, Indices{});
+  }
+
+private:
+  template <usize... Is>
+  auto copyFrom(const SoaVector &other, std::index_sequence<Is...>) -> void {
+    (std::uninitialized_copy_n(std::get<Is>(other._columns), other._size,
+                               std::get<Is>(_columns)),
+     ...);
+    _size = other._size;
+  }
+
+  template <usize... Is>
+  auto moveInto(std::tuple<Fields *...> &grown, std::index_sequence<Is...>)
+      -> void {
+    (relocate(std::get<Is>(_columns), _size, std::get<Is>(grown)), ...);
+    (release(std::get<Is>(_columns), _capacity), ...);
+  }
+
+  template <usize... Is>
+  auto equalColumns(const SoaVector &other, std::index_sequence<Is...>) const
+      -> bool {
+    return (std::equal(std::get<Is>(_columns), std::get<Is>(_columns) + _size,
+                       std::get<Is>(other._columns)) &&
+            ...);
+  }
+};
+
+} // namespace roots::structures
+
+#endif
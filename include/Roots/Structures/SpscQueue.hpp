@@ -0,0 +1,164 @@
+#ifndef Roots_Structures_SpscQueue_hpp
+#define Roots_Structures_SpscQueue_hpp
+
+#include "../_defines.hpp"
+#include "../Memory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace roots::structures {
+
+/// @brief A bounded, lock-free queue for exactly one producer thread and one
+/// consumer thread. The capacity is rounded up to a power of two. Each side
+/// keeps a cached copy of the other side's index and only reloads it (pulling
+/// the cache line across cores) when the queue looks full or empty
+template <typename T> class SpscQueue {
+  // Written by the consumer
+  alignas(kRootsCacheLineSize) std::atomic<usize> _head = 0;
+  usize _cachedTail = 0;
+
+  // Written by the producer
+  alignas(kRootsCacheLineSize) std::atomic<usize> _tail = 0;
+  usize _cachedHead = 0;
+
+  // Read-only after construction
+  alignas(kRootsCacheLineSize) T *_slots = nullptr;
+  usize _mask = 0;
+
+  static constexpr usize kSlotAlignment =
+      std::max<usize>(alignof(T), kRootsCacheLineSize);
+
+  auto slot(usize index) -> T * { return _slots + (index & _mask); }
+
+  /// @brief Free slots as seen by the producer, reloading the head if needed
+  auto writable(usize tail, usize wanted) -> usize {
+    usize space = capacity() - (tail - _cachedHead);
+    if (space < wanted) {
+      _cachedHead = _head.load(std::memory_order_acquire);
+      space = capacity() - (tail - _cachedHead);
+    }
+    return space;
+  }
+
+  /// @brief Filled slots as seen by the consumer, reloading the tail if needed
+  auto readable(usize head, usize wanted) -> usize {
+    usize filled = _cachedTail - head;
+    if (filled < wanted) {
+      _cachedTail = _tail.load(std::memory_order_acquire);
+      filled = _cachedTail - head;
+    }
+    return filled;
+  }
+
+public:
+  explicit SpscQueue(usize capacity) {
+    capacity = std::bit_ceil(std::max<usize>(capacity, 2));
+    _slots = static_cast<T *>(
+        mem::allocAligned(capacity * sizeof(T), kSlotAlignment));
+    _mask = capacity - 1;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  auto operator=(const SpscQueue &) -> SpscQueue & = delete;
+
+  ~SpscQueue() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      usize tail = _tail.load(std::memory_order_relaxed);
+      for (usize i = _head.load(std::memory_order_relaxed); i != tail; ++i)
+        std::destroy_at(slot(i));
+    }
+    mem::freeAligned(_slots, capacity() * sizeof(T), kSlotAlignment);
+  }
+
+  auto capacity() const -> usize { return _mask + 1; }
+
+  /// @brief The number of queued elements. Only exact when called from the
+  /// producer or consumer while the other side is idle
+  auto size() const -> usize {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_acquire);
+  }
+
+  auto empty() const -> bool { return size() == 0; }
+
+  /// @brief Producer: constructs an element in place, false if full
+  template <typename... Args> auto tryEmplace(Args &&...args) -> bool {
+    usize tail = _tail.load(std::memory_order_relaxed);
+    if (writable(tail, 1) == 0)
+      return false;
+    std::construct_at(slot(tail), std::forward<Args>(args)...);
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Producer: false if the queue is full
+  auto tryPush(const T &value) -> bool { return tryEmplace(value); }
+  auto tryPush(T &&value) -> bool { return tryEmplace(std::move(value)); }
+
+  /// @brief Producer: copies as many of `values` as fit and publishes them
+  /// all at once, returns how many were pushed
+  auto pushBatch(std::span<const T> values) -> usize {
+    usize tail = _tail.load(std::memory_order_relaxed);
+    usize count = std::min(values.size(), writable(tail, values.size()));
+    for (usize i = 0; i < count; ++i)
+      std::construct_at(slot(tail + i), values[i]);
+    if (count != 0)
+      _tail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /// @brief Consumer: the oldest element, or nullptr if empty. It stays valid
+  /// until the next pop
+  auto front() -> T * {
+    usize head = _head.load(std::memory_order_relaxed);
+    return readable(head, 1) == 0 ? nullptr : slot(head);
+  }
+
+  /// @brief Consumer: removes the oldest element into `out`, false if empty
+  auto tryPop(T &out) -> bool {
+    usize head = _head.load(std::memory_order_relaxed);
+    if (readable(head, 1) == 0)
+      return false;
+    T *item = slot(head);
+    out = std::move(*item);
+    std::destroy_at(item);
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  auto tryPop() -> std::optional<T> {
+    usize head = _head.load(std::memory_order_relaxed);
+    if (readable(head, 1) == 0)
+      return std::nullopt;
+    T *item = slot(head);
+    std::optional<T> out(std::move(*item));
+    std::destroy_at(item);
+    _head.store(head + 1, std::memory_order_release);
+    return out;
+  }
+
+  /// @brief Consumer: moves up to out.size() elements into `out` and frees
+  /// their slots at once, returns how many were popped
+  auto popBatch(std::span<T> out) -> usize {
+    usize head = _head.load(std::memory_order_relaxed);
+    usize count = std::min(out.size(), readable(head, out.size()));
+    for (usize i = 0; i < count; ++i) {
+      T *item = slot(head + i);
+      out[i] = std::move(*item);
+      std::destroy_at(item);
+    }
+    if (count != 0)
+      _head.store(head + count, std::memory_order_release);
+    return count;
+  }
+};
+
+} // namespace roots::structures
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef Roots_Structures_TimerWheel_hpp
+#define Roots_Structures_TimerWheel_hpp
+
+#include "../_defines.hpp"
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace roots::structures {
+
+/// @brief Identifies a timer in a TimerWheel. Ids of fired or cancelled
+/// timers go stale (a generation counter tells them apart from reused slots)
+struct TimerId {
+  u32 index = static_cast<u32>(-1);
+  u32 generation = 0;
+
+  auto operator==(const TimerId &other) const -> bool = default;
+};
+
+/// @brief A hierarchical timing wheel for large numbers of timeouts. Time is
+/// measured in abstract ticks. Four levels of 256 slots each cover deadlines
+/// up to 2^32 ticks ahead (later ones wait in an overflow list); a timer sits
+/// in the level given by the highest byte in which its deadline differs from
+/// the current time and moves down a level each time that byte is reached.
+/// Scheduling and cancelling are O(1), and advancing jumps straight to the
+/// next occupied slot using per-level occupancy bitmaps, so idle stretches
+/// cost nothing. Timers live in a slab with intrusive, index-linked lists
+template <typename T> class TimerWheel {
+  static constexpr u32 kLevels = 4;
+  static constexpr u32 kSlotBits = 8;
+  static constexpr u32 kSlots = 1u << kSlotBits;
+  static constexpr u32 kNone = static_cast<u32>(-1);
+  static constexpr u32 kOverflow = kLevels * kSlots; // list index
+
+  struct Timer {
+    std::optional<T> payload;
+    u64 deadline = 0;
+    u32 prev = kNone;
+    u32 next = kNone;
+    u32 list = kNone; // slot list index, kNone when free
+    u32 generation = 0;
+  };
+
+  std::vector<Timer> _timers;
+  std::vector<u32> _free;
+  u32 _heads[kLevels * kSlots + 1];
+  u64 _occupied[kLevels][kSlots / 64] = {};
+  u64 _now = 0;
+  usize _size = 0;
+
+  static auto listIndex(u32 level, u32 slot) -> u32 {
+    return level * kSlots + slot;
+  }
+
+  static auto slotOf(u64 tick, u32 level) -> u32 {
+    return static_cast<u32>(tick >> (level * kSlotBits)) & (kSlots - 1);
+  }
+
+  auto link(u32 index) -> void {
+    Timer &timer = _timers[index];
+    // Cascading at tick t re-files timers due at t itself (diff 0) into the
+    // level 0 slot that is about to fire
+    u64 diff = timer.deadline ^ _now;
+    u32 level =
+        diff == 0 ? 0 : static_cast<u32>(std::bit_width(diff) - 1) / kSlotBits;
+    u32 list;
+    if (level >= kLevels) {
+      list = kOverflow;
+    } else {
+      u32 slot = slotOf(timer.deadline, level);
+      list = listIndex(level, slot);
+      _occupied[level][slot / 64] |= u64(1) << (slot % 64);
+    }
+    timer.list = list;
+    timer.prev = kNone;
+    timer.next = _heads[list];
+    if (timer.next != kNone)
+      _timers[timer.next].prev = index;
+    _heads[list] = index;
+  }
+
+  auto unlink(u32 index) -> void {
+    Timer &timer = _timers[index];
+    if (timer.prev != kNone)
+      _timers[timer.prev].next = timer.next;
+    else
+      _heads[timer.list] = timer.next;
+    if (timer.next != kNone)
+      _timers[timer.next].prev = timer.prev;
+    if (_heads[timer.list] == kNone && timer.list != kOverflow) {
+      u32 level = timer.list / kSlots;
+      u32 slot = timer.list % kSlots;
+      _occupied[level][slot / 64] &= ~(u64(1) << (slot % 64));
+    }
+    timer.list = kNone;
+  }
+
+  /// @brief The first occupied slot of `level` after `slot`, or kNone
+  auto nextOccupied(u32 level, u32 slot) const -> u32 {
+    for (u32 first = slot + 1; first < kSlots; first = (first | 63) + 1) {
+      u64 bits = _occupied[level][first / 64] >> (first % 64);
+      if (bits != 0)
+        return first + static_cast<u32>(std::countr_zero(bits));
+    }
+    return kNone;
+  }
+
+  /// @brief The earliest tick after now at which some slot becomes due
+  auto nextEvent() const -> std::optional<u64> {
+    std::optional<u64> best;
+    for (u32 level = 0; level < kLevels; ++level) {
+      u32 shift = level * kSlotBits;
+      u32 slot = nextOccupied(level, slotOf(_now, level));
+      if (slot == kNone)
+        continue;
+      u64 base = (_now >> (shift + kSlotBits)) << (shift + kSlotBits);
+      u64 start = base + (static_cast<u64>(slot) << shift);
+      if (!best || start < *best)
+        best = start;
+    }
+    if (_heads[kOverflow] != kNone) {
+      constexpr u32 kSpan = kLevels * kSlotBits;
+      u64 start = ((_now >> kSpan) + 1) << kSpan;
+      if (!best || start < *best)
+        best = start;
+    }
+    return best;
+  }
+
+  /// @brief Re-files the timers of a list now that `_now` reached its range
+  auto cascade(u32 list) -> void {
+    u32 index = _heads[list];
+    while (index != kNone) {
+      u32 next = _timers[index].next;
+      unlink(index);
+      link(index);
+      index = next;
+    }
+  }
+
+  auto release(u32 index) -> void {
+    Timer &timer = _timers[index];
+    timer.payload.reset();
+    ++timer.generation;
+    _free.push_back(index);
+    --_size;
+  }
+
+  auto find(TimerId id) const -> const Timer * {
+    if (id.index >= _timers.size())
+      return nullptr;
+    const Timer &timer = _timers[id.index];
+    if (timer.generation != id.generation || timer.list == kNone)
+      return nullptr;
+    return &timer;
+  }
+
+public:
+  explicit TimerWheel(u64 now = 0) : _now(now) {
+    std::fill(std::begin(_heads), std::end(_heads), kNone);
+  }
+
+  /// @brief The current tick
+  auto now() const -> u64 { return _now; }
+
+  auto size() const -> usize { return _size; }
+  auto empty() const -> bool { return _size == 0; }
+
+  /// @brief Schedules `payload` to fire at tick `deadline`. Deadlines that
+  /// are not in the future fire on the next tick
+  auto scheduleAt(u64 deadline, T payload) -> TimerId {
+    u32 index;
+    if (!_free.empty()) {
+      index = _free.back();
+      _free.pop_back();
+    } else {
+      index = static_cast<u32>(_timers.size());
+      _timers.emplace_back();
+    }
+    Timer &timer = _timers[index];
+    timer.payload.emplace(std::move(payload));
+    timer.deadline = std::max(deadline, _now + 1);
+    link(index);
+    ++_size;
+    return TimerId{index, timer.generation};
+  }
+
+  /// @brief Schedules `payload` to fire `delay` ticks from now
+  auto schedule(u64 delay, T payload) -> TimerId {
+    return scheduleAt(_now + std::max<u64>(delay, 1), std::move(payload));
+  }
+
+  /// @brief Cancels a pending timer, returns false if it already fired or
+  /// was cancelled
+  auto cancel(TimerId id) -> bool {
+    if (find(id) == nullptr)
+      return false;
+    unlink(id.index);
+    release(id.index);
+    return true;
+  }
+
+  /// @brief Moves a pending timer to fire `delay` ticks from now, keeping
+  /// its id
+  auto reschedule(TimerId id, u64 delay) -> bool {
+    if (find(id) == nullptr)
+      return false;
+    unlink(id.index);
+    _timers[id.index].deadline = _now + std::max<u64>(delay, 1);
+    link(id.index);
+    return true;
+  }
+
+  auto contains(TimerId id) const -> bool { return find(id) != nullptr; }
+
+  auto deadline(TimerId id) const -> std::optional<u64> {
+    const Timer *timer = find(id);
+    return timer ? std::optional<u64>(timer->deadline) : std::nullopt;
+  }
+
+  auto payload(TimerId id) -> T * {
+    const Timer *timer = find(id);
+    return timer ? &_timers[id.index].payload.value() : nullptr;
+  }
+
+  /// @brief The earliest pending deadline, if any
+  auto nextExpiry() const -> std::optional<u64> {
+    std::optional<u64> best;
+    auto scan = [&](u32 list) {
+      for (u32 i = _heads[list]; i != kNone; i = _timers[i].next)
+        if (!best || _timers[i].deadline < *best)
+          best = _timers[i].deadline;
+    };
+    // Within a level the next occupied slot holds that level's earliest
+    // deadlines; overflow timers are all later than any wheel timer
+    for (u32 level = 0; level < kLevels; ++level) {
+      u32 slot = nextOccupied(level, slotOf(_now, level));
+      if (slot != kNone)
+        scan(listIndex(level, slot));
+    }
+    if (!best)
+      scan(kOverflow);
+    return best;
+  }
+
+  /// @brief Advances time to `tick`, calling fn(TimerId, T &) for every
+  /// timer that comes due, in deadline order (timers sharing a deadline fire
+  /// in no particular order). fn may schedule and cancel timers. Returns the
+  /// number of timers fired
+  template <typename F> auto advanceTo(u64 tick, F &&fn) -> usize {
+    usize fired = 0;
+    while (_now < tick) {
+      std::optional<u64> event = nextEvent();
+      if (!event || *event > tick) {
+        _now = tick;
+        break;
+      }
+      _now = *event;
+
+      constexpr u32 kSpan = kLevels * kSlotBits;
+      if ((_now & ((u64(1) << kSpan) - 1)) == 0)
+        cascade(kOverflow);
+      for (u32 level = kLevels - 1; level > 0; --level) {
+        u32 shift = level * kSlotBits;
+        if ((_now & ((u64(1) << shift) - 1)) == 0)
+          cascade(listIndex(level, slotOf(_now, level)));
+      }
+
+      u32 list = listIndex(0, slotOf(_now, 0));
+      while (_heads[list] != kNone) {
+        u32 index = _heads[list];
+        unlink(index);
+        TimerId id{index, _timers[index].generation};
+        T payload = std::move(*_timers[index].payload);
+        release(index);
+        ++fired;
+        fn(id, payload);
+      }
+    }
+    return fired;
+  }
+
+  /// @brief Advances time by `ticks`; see advanceTo
+  template <typename F> auto advance(u64 ticks, F &&fn) -> usize {
+    return advanceTo(_now + ticks, std::forward<F>(fn));
+  }
+};
+
+} // namespace roots::structures
+
+#endif
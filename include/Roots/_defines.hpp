@@ -159,6 +159,9 @@
 
 #define kRootsFilesystemMaxPathLength 4096
 
+// Used to pad data touched by different threads onto separate cache lines
+#define kRootsCacheLineSize 64
+
 // Type aliases for common types
 using u8 = unsigned char;
 using u16 = unsigned short;
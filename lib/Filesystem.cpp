@@ -1,5 +1,6 @@
 #include "Roots/Filesystem.hpp"
 #include "Roots/Environment.hpp"
+#include "Roots/Structures/LruCache.hpp"
 
 namespace roots::fs {
 
@@ -36,6 +37,60 @@ auto readFileBytes(const path_type &path)
   return contents;
 }
 
+namespace {
+
+struct CachedFile {
+  std::shared_ptr<const std::string> contents;
+  std::filesystem::file_time_type modified;
+};
+
+constexpr usize kDefaultFileCacheCapacity = 64 * 1024 * 1024;
+// Each shard gets an equal slice of the capacity and a file only fits in its
+// own shard, so keep the slices large enough to hold multi-megabyte files.
+// Reads do I/O on a miss anyway, so lock contention matters little here
+constexpr usize kFileCacheShards = 4;
+
+auto fileCache() -> structures::ShardedLruCache<std::string, CachedFile> & {
+  static structures::ShardedLruCache<std::string, CachedFile> cache(
+      kDefaultFileCacheCapacity, kFileCacheShards,
+      [](const std::string &key, const CachedFile &file) {
+        return key.size() + file.contents->size();
+      });
+  return cache;
+}
+
+} // namespace
+
+auto readFileCached(const path_type &path)
+    -> roots::result<std::shared_ptr<const std::string>, Error> {
+  std::error_code ec;
+  auto modified = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return roots::fail(
+        Error("unable to read, file does not exist"));
+  }
+
+  std::string key = path.string();
+  auto &cache = fileCache();
+  if (auto hit = cache.get(key); hit && hit->modified == modified)
+    return hit->contents;
+
+  auto contents = readFile(path);
+  if (!contents.has_value())
+    return roots::fail(contents.error());
+
+  auto shared =
+      std::make_shared<const std::string>(std::move(contents.value()));
+  cache.put(std::move(key), CachedFile{shared, modified});
+  return shared;
+}
+
+auto setFileCacheCapacity(usize bytes) -> void {
+  fileCache().setCapacity(bytes);
+}
+
+auto clearFileCache() -> void { fileCache().clear(); }
+
 auto exists(const path_type &path) -> bool {
   return std::filesystem::exists(path);
 }
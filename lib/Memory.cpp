@@ -73,6 +73,9 @@ auto PoolAllocator::free(void *ptr, u64 size) -> void {
 
   std::lock_guard<std::mutex> lock(_memLock);
 
+  // Chunks are handed out by rounded size, so they must be filed under it
+  size = mem::mult8RoundUp(size);
+
   if (size > kPoolSize) {
 #ifdef RootsDebug
     RootsDebugLog << "Freeing manually ... " << size << " bytes" << std::endl;
@@ -1,99 +1,292 @@
 #include "Roots/String.hpp"
+#include "Roots/Structures/SmallVector.hpp"
+#include <array>
+#include <bit>
+#include <cctype>
 
 namespace roots::str {
 
-auto endsWith(const std::string &str, const std::string &suffix) -> bool {
-  if (str.length() >= suffix.length()) {
-    return (0 == str.compare(str.length() - suffix.length(), suffix.length(),
-                             suffix));
-  } else {
-    return false;
+namespace {
+
+auto isSpace(i8 ch) -> bool {
+  return std::isspace(static_cast<unsigned char>(ch)) != 0;
+}
+
+struct Replacement {
+  usize pos;
+  usize length;
+  std::string_view with;
+};
+
+/// @brief Builds `str` with `count` non-overlapping, ordered replacements
+/// (replacement(i) gives the i-th) into one allocation of `size` bytes
+template <typename F>
+auto buildReplaced(std::string_view str, usize count, usize size,
+                   F &&replacement) -> std::string {
+  if (count == 0)
+    return std::string(str);
+  std::string result(size, '\0');
+  i8 *out = result.data();
+  usize copied = 0;
+  for (usize i = 0; i < count; ++i) {
+    Replacement r = replacement(i);
+    std::memcpy(out, str.data() + copied, r.pos - copied);
+    out += r.pos - copied;
+    std::memcpy(out, r.with.data(), r.with.size());
+    out += r.with.size();
+    copied = r.pos + r.length;
   }
+  std::memcpy(out, str.data() + copied, str.size() - copied);
+  return result;
 }
 
-auto startsWith(const std::string &str, const std::string &prefix) -> bool {
-  if (str.length() >= prefix.length()) {
-    return (0 == str.compare(0, prefix.length(), prefix));
-  } else {
-    return false;
+/// @brief replaceMany for patterns that are all single bytes: every match
+/// is one byte long, so no overlap can arise and a byte table replaces the
+/// automaton. The bytes are found a 64-byte mask at a time, once to size
+/// the output and once to write it
+auto replaceBytes(std::string_view str,
+                  const std::vector<std::pair<std::string_view,
+                                              std::string_view>> &replacements)
+    -> std::string {
+  std::array<const std::string_view *, 256> with{};
+  std::string bytes;
+  for (const auto &[from, to] : replacements) {
+    if (from.empty())
+      continue;
+    auto &slot = with[static_cast<u8>(from.front())];
+    if (slot == nullptr) { // the earlier entry wins
+      slot = &to;
+      bytes.push_back(from.front());
+    }
+  }
+
+  MaskScanner<AnyOf> scanner(AnyOf{bytes});
+  usize size = str.size();
+  usize count = 0;
+  for (usize pos = scanner.find(str, 0); pos != std::string_view::npos;
+       pos = scanner.find(str, pos + 1)) {
+    size += with[static_cast<u8>(str[pos])]->size() - 1;
+    ++count;
+  }
+  if (count == 0)
+    return std::string(str);
+
+  std::string result(size, '\0');
+  i8 *out = result.data();
+  usize copied = 0;
+  for (usize pos = scanner.find(str, 0); pos != std::string_view::npos;
+       pos = scanner.find(str, pos + 1)) {
+    std::string_view to = *with[static_cast<u8>(str[pos])];
+    std::memcpy(out, str.data() + copied, pos - copied);
+    out += pos - copied;
+    std::memcpy(out, to.data(), to.size());
+    out += to.size();
+    copied = pos + 1;
   }
+  std::memcpy(out, str.data() + copied, str.size() - copied);
+  return result;
+}
+
+template <typename Strings>
+auto joinStrings(const Strings &strs, std::string_view delim) -> std::string {
+  if (strs.size() == 0)
+    return {};
+  usize length = delim.size() * (strs.size() - 1);
+  for (std::string_view str : strs)
+    length += str.size();
+
+  std::string result;
+  result.reserve(length);
+  bool first = true;
+  for (std::string_view str : strs) {
+    if (!first)
+      result += delim;
+    result += str;
+    first = false;
+  }
+  return result;
+}
+
+} // namespace
+
+auto endsWith(std::string_view str, std::string_view suffix) -> bool {
+  return str.ends_with(suffix);
+}
+
+auto startsWith(std::string_view str, std::string_view prefix) -> bool {
+  return str.starts_with(prefix);
 }
 
-auto split(const std::string &str, const std::string &delim)
+auto split(std::string_view str, std::string_view delim)
     -> std::vector<std::string> {
+  std::vector<std::string_view> views = splitView(str, delim);
+  return std::vector<std::string>(views.begin(), views.end());
+}
+
+auto splitView(std::string_view str, std::string_view delim)
+    -> std::vector<std::string_view> {
+  std::vector<std::string_view> result;
   if (delim.empty()) {
     // split into characters
-    std::vector<std::string> result;
-    for (size_t i = 0; i < str.length(); i++) {
+    result.reserve(str.size());
+    for (usize i = 0; i < str.size(); i++)
       result.push_back(str.substr(i, 1));
-    }
     return result;
   }
 
-  std::vector<std::string> result;
-  auto start = 0;
-  auto end = str.find(delim);
-  while (end != std::string::npos) {
-    result.push_back(str.substr(start, end - start));
-    start = end + delim.size();
-    end = str.find(delim, start);
+  if (delim.size() == 1) {
+    for (std::string_view token : splitRange(str, delim.front()))
+      result.push_back(token);
+  } else {
+    for (std::string_view token : splitRange(str, delim))
+      result.push_back(token);
   }
-  result.push_back(str.substr(start, end));
   return result;
 }
 
-auto replaceAll(const std::string &str, const std::string &from,
-                const std::string &to) -> std::string {
-  std::string result = str;
-  size_t start_pos = 0;
+auto replaceAll(std::string_view str, std::string_view from,
+                std::string_view to) -> std::string {
+  if (from.empty())
+    return std::string(str);
+
+  // Find every match first so the output is sized and written once, rather
+  // than shifting the tail of the string at each replacement
+  structures::SmallVector<usize> matches;
+  for (usize pos = str.find(from); pos != std::string_view::npos;
+       pos = str.find(from, pos + from.size()))
+    matches.push_back(pos);
+
+  return buildReplaced(
+      str, matches.size(),
+      str.size() - matches.size() * from.size() + matches.size() * to.size(),
+      [&](usize i) { return Replacement{matches[i], from.size(), to}; });
+}
 
-  while ((start_pos = result.find(from, start_pos)) != std::string::npos) {
-    result.replace(start_pos, from.length(), to);
-    start_pos += to.length();
+auto replaceMany(
+    std::string_view str,
+    const std::vector<std::pair<std::string_view, std::string_view>>
+        &replacements) -> std::string {
+  bool singleBytes = true;
+  bool anyPattern = false;
+  for (const auto &[from, to] : replacements) {
+    singleBytes = singleBytes && from.size() <= 1;
+    anyPattern = anyPattern || !from.empty();
   }
+  if (singleBytes && anyPattern)
+    return replaceBytes(str, replacements);
 
-  return result;
+  std::vector<std::string_view> patterns;
+  patterns.reserve(replacements.size());
+  for (const auto &[from, to] : replacements)
+    patterns.push_back(from);
+  AhoCorasick automaton(patterns);
+  usize maxLength = automaton.maxPatternLength();
+  if (maxLength == 0)
+    return std::string(str);
+
+  // All matches starting at p are known once the scan reaches
+  // p + maxLength - 1, so the longest one per start only has to be kept for
+  // a window of maxLength positions. Positions are then taken greedily from
+  // the left
+  constexpr u32 kNone = static_cast<u32>(-1);
+  usize window = std::bit_ceil(maxLength);
+  std::vector<u32> longest(window, kNone);
+  auto length = [&](u32 pattern) { return replacements[pattern].first.size(); };
+
+  struct Chosen {
+    usize pos;
+    u32 pattern;
+  };
+  structures::SmallVector<Chosen> chosen;
+  usize next = 0;
+  usize outputSize = str.size();
+  usize pending = 0;
+  auto decide = [&](usize pos) {
+    u32 &slot = longest[pos & (window - 1)];
+    if (slot == kNone)
+      return;
+    if (pos >= next) {
+      chosen.push_back(Chosen{pos, slot});
+      next = pos + length(slot);
+      outputSize += replacements[slot].second.size();
+      outputSize -= length(slot);
+    }
+    slot = kNone;
+    --pending;
+  };
+
+  // Matches arrive by end position, so one ending at `end` means every
+  // start before end - maxLength is settled
+  usize settled = 0;
+  automaton.forEachMatch(str, [&](const PatternMatch &match) {
+    for (; pending != 0 && settled + maxLength < match.end; ++settled)
+      decide(settled);
+    if (settled + maxLength < match.end)
+      settled = match.end - maxLength;
+    u32 &slot = longest[match.start & (window - 1)];
+    if (slot == kNone) {
+      slot = match.pattern;
+      ++pending;
+    } else if (length(match.pattern) > length(slot)) {
+      slot = match.pattern;
+    }
+  });
+  for (; pending != 0; ++settled)
+    decide(settled);
+
+  return buildReplaced(str, chosen.size(), outputSize, [&](usize i) {
+    const auto &[from, to] = replacements[chosen[i].pattern];
+    return Replacement{chosen[i].pos, from.size(), to};
+  });
 }
 
-auto join(const std::vector<std::string> &strs, const std::string &delim)
+auto join(const std::vector<std::string> &strs, std::string_view delim)
     -> std::string {
-  std::string result;
-  for (size_t i = 0; i < strs.size(); i++) {
-    result += strs[i];
-    if (i != strs.size() - 1)
-      result += delim;
-  }
+  return joinStrings(strs, delim);
+}
 
-  return result;
+auto join(const std::vector<std::string_view> &strs, std::string_view delim)
+    -> std::string {
+  return joinStrings(strs, delim);
 }
 
-auto toLower(const std::string &str) -> std::string {
-  std::string result = str;
-  std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-  return result;
+auto join(std::initializer_list<std::string_view> strs, std::string_view delim)
+    -> std::string {
+  return joinStrings(strs, delim);
 }
 
-auto toUpper(const std::string &str) -> std::string {
-  std::string result = str;
-  std::transform(result.begin(), result.end(), result.begin(), ::toupper);
+auto toLower(std::string_view str) -> std::string {
+  std::string result(str);
+  std::transform(result.begin(), result.end(), result.begin(), [](i8 ch) {
+    return static_cast<i8>(std::tolower(static_cast<unsigned char>(ch)));
+  });
   return result;
 }
 
-auto trim(const std::string &str) -> std::string {
-  std::string result = str;
-  result.erase(result.begin(),
-               std::find_if(result.begin(), result.end(),
-                            [](int ch) { return !std::isspace(ch); }));
-  result.erase(std::find_if(result.rbegin(), result.rend(),
-                            [](int ch) { return !std::isspace(ch); })
-                   .base(),
-               result.end());
+auto toUpper(std::string_view str) -> std::string {
+  std::string result(str);
+  std::transform(result.begin(), result.end(), result.begin(), [](i8 ch) {
+    return static_cast<i8>(std::toupper(static_cast<unsigned char>(ch)));
+  });
   return result;
 }
 
-auto duplicateAsCString(const std::string &str) -> const i8 * {
+auto trim(std::string_view str) -> std::string {
+  return std::string(trimView(str));
+}
+
+auto trimView(std::string_view str) -> std::string_view {
+  auto first = std::find_if_not(str.begin(), str.end(), isSpace);
+  auto last = std::find_if_not(str.rbegin(), str.rend(), isSpace).base();
+  if (first >= last)
+    return {};
+  return str.substr(first - str.begin(), last - first);
+}
+
+auto duplicateAsCString(std::string_view str) -> const i8 * {
   auto *cstr = new i8[str.length() + 1];
-  std::strcpy(cstr, str.c_str());
+  std::memcpy(cstr, str.data(), str.length());
+  cstr[str.length()] = '\0';
   return cstr;
 }
 
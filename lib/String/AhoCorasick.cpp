@@ -0,0 +1,199 @@
+#include "Roots/String/AhoCorasick.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace roots::str {
+
+namespace {
+
+auto fold(u8 byte, bool caseInsensitive) -> u8 {
+  return caseInsensitive && byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A')
+                                                       : byte;
+}
+
+template <typename T> auto bytesOf(const std::vector<T> &v) -> usize {
+  return v.capacity() * sizeof(T);
+}
+
+} // namespace
+
+AhoCorasick::AhoCorasick(const std::vector<std::string_view> &patterns,
+                         AhoCorasickOptions options)
+    : _options(options) {
+  build(patterns);
+}
+
+AhoCorasick::AhoCorasick(const std::vector<std::string> &patterns,
+                         AhoCorasickOptions options)
+    : _options(options) {
+  build(std::vector<std::string_view>(patterns.begin(), patterns.end()));
+}
+
+auto AhoCorasick::build(const std::vector<std::string_view> &patterns)
+    -> void {
+  bool caseInsensitive = _options.caseInsensitive;
+  _patterns.assign(patterns.begin(), patterns.end());
+
+  // Byte classes: one per (folded) byte used by some pattern, plus class 0
+  // for every byte no pattern uses
+  bool used[256] = {};
+  for (std::string_view pattern : patterns) {
+    _maxLength = std::max(_maxLength, pattern.size());
+    for (i8 ch : pattern)
+      used[fold(static_cast<u8>(ch), caseInsensitive)] = true;
+  }
+  bool anyUnused = false;
+  for (u32 byte = 0; byte < 256; ++byte)
+    anyUnused |= !used[fold(static_cast<u8>(byte), caseInsensitive)];
+  u32 classCount = anyUnused ? 1 : 0;
+  u8 canonicalClass[256] = {};
+  for (u32 byte = 0; byte < 256; ++byte)
+    if (used[byte])
+      canonicalClass[byte] = static_cast<u8>(classCount++);
+  for (u32 byte = 0; byte < 256; ++byte) {
+    u8 folded = fold(static_cast<u8>(byte), caseInsensitive);
+    _classes[byte] = used[folded] ? canonicalClass[folded] : 0;
+  }
+  _classCount = std::max<u32>(classCount, 1);
+
+  // The trie, with edges kept in per-state lists while it is built
+  std::vector<std::vector<std::pair<u8, u32>>> trie(1);
+  std::vector<std::vector<u32>> trieEnds(1);
+  for (u32 index = 0; index < patterns.size(); ++index) {
+    std::string_view pattern = patterns[index];
+    if (pattern.empty())
+      continue;
+    u32 state = 0;
+    for (i8 ch : pattern) {
+      u8 cls = _classes[static_cast<u8>(ch)];
+      auto it = std::find_if(
+          trie[state].begin(), trie[state].end(),
+          [cls](const auto &edge) { return edge.first == cls; });
+      if (it != trie[state].end()) {
+        state = it->second;
+        continue;
+      }
+      u32 next = static_cast<u32>(trie.size());
+      trie[state].emplace_back(cls, next);
+      trie.emplace_back();
+      trieEnds.emplace_back();
+      state = next;
+    }
+    trieEnds[state].push_back(index);
+  }
+  _stateCount = static_cast<u32>(trie.size());
+
+  // Renumber the states breadth first, so that every state's failure target
+  // (which is shallower) comes before it and the shallowest states, which
+  // get full rows in the compressed layout, come first
+  std::vector<u32> order{0};
+  order.reserve(_stateCount);
+  for (usize head = 0; head < order.size(); ++head)
+    for (const auto &[cls, child] : trie[order[head]])
+      order.push_back(child);
+  std::vector<u32> renumbered(_stateCount);
+  for (u32 state = 0; state < _stateCount; ++state)
+    renumbered[order[state]] = state;
+
+  _edgeBegin.assign(_stateCount + 1, 0);
+  _outputBegin.assign(_stateCount + 1, 0);
+  for (u32 state = 0; state < _stateCount; ++state) {
+    auto &edges = trie[order[state]];
+    std::sort(edges.begin(), edges.end());
+    for (const auto &[cls, target] : edges) {
+      _edgeClasses.push_back(cls);
+      _edgeTargets.push_back(renumbered[target]);
+    }
+    _edgeBegin[state + 1] = static_cast<u32>(_edgeTargets.size());
+    const auto &ends = trieEnds[order[state]];
+    _outputs.insert(_outputs.end(), ends.begin(), ends.end());
+    _outputBegin[state + 1] = static_cast<u32>(_outputs.size());
+  }
+
+  // Failure and output links
+  _fail.assign(_stateCount, 0);
+  _matchState.assign(_stateCount, kNone);
+  _outputLink.assign(_stateCount, kNone);
+  for (u32 state = 0; state < _stateCount; ++state) {
+    for (u32 i = _edgeBegin[state]; i < _edgeBegin[state + 1]; ++i) {
+      u32 cls = _edgeClasses[i];
+      u32 child = _edgeTargets[i];
+      u32 fail = 0;
+      if (state != 0) {
+        fail = _fail[state];
+        while (fail != 0 && edge(fail, cls) == kNone)
+          fail = _fail[fail];
+        u32 target = edge(fail, cls);
+        fail = target != kNone ? target : 0;
+      }
+      _fail[child] = fail;
+      bool ends = _outputBegin[child] != _outputBegin[child + 1];
+      _matchState[child] = ends ? child : _matchState[fail];
+      _outputLink[child] = _matchState[fail];
+    }
+  }
+
+  usize denseEntries = usize(_stateCount) * _classCount;
+  switch (_options.layout) {
+  case TransitionLayout::Automatic:
+    _isDense = denseEntries * sizeof(u32) <= kDenseBudget;
+    break;
+  case TransitionLayout::Dense:
+    if (denseEntries >= kMatchFlag)
+      throw std::length_error("AhoCorasick dense table too large");
+    _isDense = true;
+    break;
+  case TransitionLayout::Compressed:
+    _isDense = false;
+    break;
+  }
+  _denseStates = _isDense ? _stateCount : 1 + _edgeBegin[1];
+
+  // Full rows: a missing edge goes where the failure state's row goes
+  _delta.assign(usize(_denseStates) * _classCount, 0);
+  for (u32 state = 0; state < _denseStates; ++state) {
+    u32 *row = _delta.data() + usize(state) * _classCount;
+    if (state != 0) {
+      const u32 *failRow = _delta.data() + usize(_fail[state]) * _classCount;
+      std::copy(failRow, failRow + _classCount, row);
+    }
+    for (u32 i = _edgeBegin[state]; i < _edgeBegin[state + 1]; ++i)
+      row[_edgeClasses[i]] = _edgeTargets[i];
+  }
+
+  if (!_isDense)
+    return;
+  for (u32 &target : _delta)
+    target = target * _classCount |
+             (_matchState[target] != kNone ? kMatchFlag : 0);
+  _edgeBegin = {};
+  _edgeClasses = {};
+  _edgeTargets = {};
+  _fail = {};
+}
+
+auto AhoCorasick::memoryUsage() const -> usize {
+  return bytesOf(_delta) + bytesOf(_edgeBegin) + bytesOf(_edgeClasses) +
+         bytesOf(_edgeTargets) + bytesOf(_fail) + bytesOf(_matchState) +
+         bytesOf(_outputLink) + bytesOf(_outputBegin) + bytesOf(_outputs);
+}
+
+auto AhoCorasick::findAll(std::string_view text) const
+    -> std::vector<PatternMatch> {
+  std::vector<PatternMatch> matches;
+  forEachMatch(text,
+               [&matches](const PatternMatch &match) { matches.push_back(match); });
+  return matches;
+}
+
+auto AhoCorasick::findFirst(std::string_view text) const
+    -> std::optional<PatternMatch> {
+  std::optional<PatternMatch> first;
+  forEachMatch(text, [&first](const PatternMatch &match) {
+    first = match;
+    return false;
+  });
+  return first;
+}
+
+} // namespace roots::str
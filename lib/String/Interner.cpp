@@ -0,0 +1,142 @@
+#include "Roots/String/Interner.hpp"
+#include "Roots/Structures/Hash.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace roots::str {
+
+using detail::InternEntry;
+
+namespace {
+
+constexpr usize kChunkSize = 64 * 1024;
+
+auto hashString(std::string_view str) -> u64 {
+  return structures::StringHash{}(str);
+}
+
+} // namespace
+
+Interner::Table::Table(usize capacity)
+    : mask(capacity - 1),
+      slots(new std::atomic<const InternEntry *>[capacity]) {
+  for (usize i = 0; i < capacity; ++i)
+    slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+Interner::Interner(usize expected) {
+  usize capacity = std::bit_ceil(std::max<usize>(expected * 2, 16));
+  _tables.push_back(std::make_unique<Table>(capacity));
+  _table.store(_tables.back().get(), std::memory_order_release);
+}
+
+Interner::~Interner() = default;
+
+auto Interner::find(const Table *table, std::string_view str, u64 hash)
+    -> const InternEntry * {
+  for (usize i = hash & table->mask;; i = (i + 1) & table->mask) {
+    const InternEntry *entry = table->slots[i].load(std::memory_order_acquire);
+    if (entry == nullptr)
+      return nullptr;
+    if (entry->hash == hash && entry->length == str.size() &&
+        std::memcmp(entry->data(), str.data(), str.size()) == 0)
+      return entry;
+  }
+}
+
+auto Interner::allocate(std::string_view str, u64 hash) -> InternEntry * {
+  if (str.size() > UINT32_MAX)
+    throw std::length_error("string too long to intern");
+
+  usize needed = (sizeof(InternEntry) + str.size() + 1 + 7) & ~usize(7);
+  u8 *memory;
+  if (needed > kChunkSize / 4) {
+    // Large strings get a chunk of their own so the current one keeps its
+    // free space
+    _chunks.push_back(std::unique_ptr<u8[]>(new u8[needed]));
+    _bytes += needed;
+    memory = _chunks.back().get();
+  } else {
+    if (needed > _remaining) {
+      _chunks.push_back(std::unique_ptr<u8[]>(new u8[kChunkSize]));
+      _bytes += kChunkSize;
+      _cursor = _chunks.back().get();
+      _remaining = kChunkSize;
+    }
+    memory = _cursor;
+    _cursor += needed;
+    _remaining -= needed;
+  }
+
+  auto *entry = new (memory) InternEntry{hash, static_cast<u32>(str.size())};
+  auto *bytes = reinterpret_cast<i8 *>(entry + 1);
+  std::memcpy(bytes, str.data(), str.size());
+  bytes[str.size()] = '\0';
+  return entry;
+}
+
+auto Interner::grow() -> void {
+  Table *old = _table.load(std::memory_order_relaxed);
+  auto table = std::make_unique<Table>((old->mask + 1) * 2);
+  for (usize i = 0; i <= old->mask; ++i) {
+    const InternEntry *entry = old->slots[i].load(std::memory_order_relaxed);
+    if (entry == nullptr)
+      continue;
+    usize j = entry->hash & table->mask;
+    while (table->slots[j].load(std::memory_order_relaxed) != nullptr)
+      j = (j + 1) & table->mask;
+    table->slots[j].store(entry, std::memory_order_relaxed);
+  }
+  _table.store(table.get(), std::memory_order_release);
+  _tables.push_back(std::move(table));
+}
+
+auto Interner::intern(std::string_view str) -> Symbol {
+  u64 hash = hashString(str);
+  if (const InternEntry *entry =
+          find(_table.load(std::memory_order_acquire), str, hash))
+    return Symbol(entry);
+
+  std::lock_guard lock(_mutex);
+  Table *table = _table.load(std::memory_order_relaxed);
+  // Another writer may have added it since the unlocked probe
+  if (const InternEntry *entry = find(table, str, hash))
+    return Symbol(entry);
+
+  if ((_size.load(std::memory_order_relaxed) + 1) * 2 > table->mask + 1) {
+    grow();
+    table = _table.load(std::memory_order_relaxed);
+  }
+
+  InternEntry *entry = allocate(str, hash);
+  usize i = hash & table->mask;
+  while (table->slots[i].load(std::memory_order_relaxed) != nullptr)
+    i = (i + 1) & table->mask;
+  table->slots[i].store(entry, std::memory_order_release);
+  _size.fetch_add(1, std::memory_order_relaxed);
+  return Symbol(entry);
+}
+
+auto Interner::lookup(std::string_view str) const -> Symbol {
+  return Symbol(
+      find(_table.load(std::memory_order_acquire), str, hashString(str)));
+}
+
+auto Interner::arenaBytes() -> usize {
+  std::lock_guard lock(_mutex);
+  return _bytes;
+}
+
+auto Interner::global() -> Interner & {
+  static Interner interner(4096);
+  return interner;
+}
+
+auto intern(std::string_view str) -> Symbol {
+  return Interner::global().intern(str);
+}
+
+} // namespace roots::str
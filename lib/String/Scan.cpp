@@ -0,0 +1,250 @@
+#include "Roots/String/Scan.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define ROOTS_SCAN_SSE2 1
+#endif
+
+// GCC and Clang can compile AVX2 functions into an otherwise SSE2 build and
+// pick them at runtime with __builtin_cpu_supports
+#if defined(ROOTS_SCAN_SSE2) && defined(__GNUC__)
+#define ROOTS_SCAN_AVX2 1
+#define ROOTS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace roots::str {
+
+namespace {
+
+constexpr usize kNotFound = std::string_view::npos;
+
+// Each instruction set provides 64-byte match masks; the loops below are
+// shared and force-inlined into per-ISA entry points so that the kernels
+// inline into code compiled for the same target
+
+struct Scalar {
+  static auto mask64(const i8 *p, i8 ch) -> u64 {
+    u64 mask = 0;
+    for (usize i = 0; i < 64; ++i)
+      mask |= u64(p[i] == ch) << i;
+    return mask;
+  }
+
+  static auto maskAny64(const i8 *p, const AnyOf &set) -> u64 {
+    u64 mask = 0;
+    for (usize i = 0; i < 64; ++i)
+      mask |= u64(set.contains(p[i])) << i;
+    return mask;
+  }
+};
+
+#if defined(ROOTS_SCAN_SSE2)
+struct Sse2 {
+  static auto mask16(const i8 *p, __m128i needle) -> u64 {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    return static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle)));
+  }
+
+  static auto mask64(const i8 *p, i8 ch) -> u64 {
+    __m128i needle = _mm_set1_epi8(ch);
+    return mask16(p, needle) | mask16(p + 16, needle) << 16 |
+           mask16(p + 32, needle) << 32 | mask16(p + 48, needle) << 48;
+  }
+
+  static auto maskAny64(const i8 *p, const AnyOf &set) -> u64 {
+    std::string_view chars = set.vectorChars();
+    if (chars.empty())
+      return Scalar::maskAny64(p, set);
+    u64 mask = 0;
+    for (i8 ch : chars)
+      mask |= mask64(p, ch);
+    return mask;
+  }
+};
+#endif
+
+#if defined(ROOTS_SCAN_AVX2)
+struct Avx2 {
+  ROOTS_TARGET_AVX2 static auto mask32(const i8 *p, __m256i needle) -> u64 {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    return static_cast<u32>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, needle)));
+  }
+
+  ROOTS_TARGET_AVX2 static auto mask64(const i8 *p, i8 ch) -> u64 {
+    __m256i needle = _mm256_set1_epi8(ch);
+    return mask32(p, needle) | mask32(p + 32, needle) << 32;
+  }
+
+  ROOTS_TARGET_AVX2 static auto maskAny64(const i8 *p, const AnyOf &set)
+      -> u64 {
+    std::string_view chars = set.vectorChars();
+    if (chars.empty())
+      return Scalar::maskAny64(p, set);
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i high =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+    __m256i lowHits = _mm256_setzero_si256();
+    __m256i highHits = _mm256_setzero_si256();
+    for (i8 ch : chars) {
+      __m256i needle = _mm256_set1_epi8(ch);
+      lowHits = _mm256_or_si256(lowHits, _mm256_cmpeq_epi8(low, needle));
+      highHits = _mm256_or_si256(highHits, _mm256_cmpeq_epi8(high, needle));
+    }
+    return static_cast<u32>(_mm256_movemask_epi8(lowHits)) |
+           u64(static_cast<u32>(_mm256_movemask_epi8(highHits))) << 32;
+  }
+};
+#endif
+
+auto tailMask(const i8 *p, usize n, i8 ch) -> u64 {
+  u64 mask = 0;
+  for (usize i = 0; i < n; ++i)
+    mask |= u64(p[i] == ch) << i;
+  return mask;
+}
+
+auto tailMask(const i8 *p, usize n, const AnyOf &set) -> u64 {
+  u64 mask = 0;
+  for (usize i = 0; i < n; ++i)
+    mask |= u64(set.contains(p[i])) << i;
+  return mask;
+}
+
+template <typename Isa, typename Needle>
+[[gnu::always_inline]] inline auto blockMask(const i8 *p, const Needle &needle)
+    -> u64 {
+  if constexpr (std::is_same_v<Needle, i8>)
+    return Isa::mask64(p, needle);
+  else
+    return Isa::maskAny64(p, needle);
+}
+
+template <typename Isa, typename Needle>
+[[gnu::always_inline]] inline auto maskWith(const i8 *p, usize n,
+                                            const Needle &needle) -> u64 {
+  return n == 64 ? blockMask<Isa>(p, needle) : tailMask(p, n, needle);
+}
+
+template <typename Isa, typename Needle>
+[[gnu::always_inline]] inline auto findWith(const i8 *p, usize n,
+                                            const Needle &needle) -> usize {
+  usize i = 0;
+  for (; i + 64 <= n; i += 64) {
+    u64 mask = blockMask<Isa>(p + i, needle);
+    if (mask != 0)
+      return i + static_cast<usize>(std::countr_zero(mask));
+  }
+  u64 mask = tailMask(p + i, n - i, needle);
+  return mask != 0 ? i + static_cast<usize>(std::countr_zero(mask))
+                   : kNotFound;
+}
+
+template <typename Isa>
+[[gnu::always_inline]] inline auto countWith(const i8 *p, usize n, i8 ch)
+    -> usize {
+  usize count = 0;
+  usize i = 0;
+  for (; i + 64 <= n; i += 64)
+    count += static_cast<usize>(std::popcount(Isa::mask64(p + i, ch)));
+  return count + static_cast<usize>(std::popcount(tailMask(p + i, n - i, ch)));
+}
+
+struct Kernels {
+  u64 (*mask)(const i8 *, usize, i8);
+  u64 (*maskAny)(const i8 *, usize, const AnyOf &);
+  usize (*find)(const i8 *, usize, i8);
+  usize (*findAny)(const i8 *, usize, const AnyOf &);
+  usize (*count)(const i8 *, usize, i8);
+  const i8 *name;
+};
+
+template <typename Isa> auto kernelsFor(const i8 *name) -> Kernels {
+  return Kernels{
+      [](const i8 *p, usize n, i8 ch) { return maskWith<Isa>(p, n, ch); },
+      [](const i8 *p, usize n, const AnyOf &set) {
+        return maskWith<Isa>(p, n, set);
+      },
+      [](const i8 *p, usize n, i8 ch) { return findWith<Isa>(p, n, ch); },
+      [](const i8 *p, usize n, const AnyOf &set) {
+        return findWith<Isa>(p, n, set);
+      },
+      [](const i8 *p, usize n, i8 ch) { return countWith<Isa>(p, n, ch); },
+      name};
+}
+
+#if defined(ROOTS_SCAN_AVX2)
+// Lambdas don't inherit target attributes, so the AVX2 entry points are
+// spelled out
+ROOTS_TARGET_AVX2 auto maskAvx2(const i8 *p, usize n, i8 ch) -> u64 {
+  return maskWith<Avx2>(p, n, ch);
+}
+
+ROOTS_TARGET_AVX2 auto maskAnyAvx2(const i8 *p, usize n, const AnyOf &set)
+    -> u64 {
+  return maskWith<Avx2>(p, n, set);
+}
+
+ROOTS_TARGET_AVX2 auto findAvx2(const i8 *p, usize n, i8 ch) -> usize {
+  return findWith<Avx2>(p, n, ch);
+}
+
+ROOTS_TARGET_AVX2 auto findAnyAvx2(const i8 *p, usize n, const AnyOf &set)
+    -> usize {
+  return findWith<Avx2>(p, n, set);
+}
+
+ROOTS_TARGET_AVX2 auto countAvx2(const i8 *p, usize n, i8 ch) -> usize {
+  return countWith<Avx2>(p, n, ch);
+}
+#endif
+
+auto selectKernels() -> Kernels {
+#if defined(ROOTS_SCAN_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    return Kernels{maskAvx2, maskAnyAvx2, findAvx2, findAnyAvx2, countAvx2,
+                   "avx2"};
+#endif
+#if defined(ROOTS_SCAN_SSE2)
+  return kernelsFor<Sse2>("sse2");
+#else
+  return kernelsFor<Scalar>("scalar");
+#endif
+}
+
+auto kernels() -> const Kernels & {
+  static const Kernels selected = selectKernels();
+  return selected;
+}
+
+} // namespace
+
+auto matchMask(const i8 *p, usize n, i8 ch) -> u64 {
+  return kernels().mask(p, n, ch);
+}
+
+auto matchMask(const i8 *p, usize n, const AnyOf &set) -> u64 {
+  return kernels().maskAny(p, n, set);
+}
+
+auto findByte(std::string_view text, i8 ch, usize from) -> usize {
+  if (from >= text.size())
+    return kNotFound;
+  usize hit = kernels().find(text.data() + from, text.size() - from, ch);
+  return hit == kNotFound ? kNotFound : from + hit;
+}
+
+auto findAnyOf(std::string_view text, const AnyOf &set, usize from) -> usize {
+  if (from >= text.size())
+    return kNotFound;
+  usize hit = kernels().findAny(text.data() + from, text.size() - from, set);
+  return hit == kNotFound ? kNotFound : from + hit;
+}
+
+auto countByte(std::string_view text, i8 ch) -> usize {
+  return kernels().count(text.data(), text.size(), ch);
+}
+
+auto scanIsa() -> std::string_view { return kernels().name; }
+
+} // namespace roots::str
@@ -0,0 +1,171 @@
+#include "Roots/Structures/BloomFilter.hpp"
+#include "Roots/Structures/BitSet.hpp"
+#include "Endian.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace roots::structures {
+
+using namespace endian;
+
+static constexpr u32 kSerialMagic = 0x314D4C42; // "BLM1"
+static constexpr usize kHeaderSize = 24;
+
+// One odd multiplier per word; the top 6 bits of (hash * salt) pick the bit
+alignas(32) static constexpr u32 kSalts[BloomFilter::kWordsPerBlock] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+static constexpr usize kBlockBits = BloomFilter::kWordsPerBlock * 64;
+
+/// @brief False positive rate of a blocked filter holding `bitsPerKey` bits
+/// per key: the number of keys landing in a block is Poisson distributed, and
+/// a lookup hits when its bit is already set in all eight words
+static auto blockedFalsePositiveRate(f64 bitsPerKey) -> f64 {
+  f64 lambda = static_cast<f64>(kBlockBits) / bitsPerKey;
+  f64 term = std::exp(-lambda); // P(0 keys)
+  f64 rate = 0;
+  usize limit = static_cast<usize>(lambda + 12 * std::sqrt(lambda) + 32);
+  for (usize i = 0; i <= limit; ++i) {
+    if (i != 0)
+      term *= lambda / static_cast<f64>(i);
+    f64 wordHit = 1 - std::pow(63.0 / 64.0, static_cast<f64>(i));
+    rate += term * std::pow(wordHit, BloomFilter::kWordsPerBlock);
+  }
+  return rate;
+}
+
+BloomFilter::BloomFilter(usize expectedItems, f64 falsePositiveRate) {
+  f64 target = std::clamp(falsePositiveRate, 1e-9, 0.5);
+  f64 bitsPerKey = 4;
+  while (bitsPerKey < 96 && blockedFalsePositiveRate(bitsPerKey) > target)
+    bitsPerKey += 0.25;
+  f64 bits = static_cast<f64>(std::max<usize>(expectedItems, 1)) * bitsPerKey;
+  usize blocks = static_cast<usize>(std::ceil(bits / kBlockBits));
+  _blocks.assign(std::max<usize>(blocks, 1), Block{});
+}
+
+#if defined(__AVX2__)
+/// @brief The bit each word of a block has to have set for hash `h`, as two
+/// vectors of four words
+static auto blockMasks(u32 h, __m256i &lo, __m256i &hi) -> void {
+  __m256i salts = _mm256_load_si256(reinterpret_cast<const __m256i *>(kSalts));
+  __m256i index = _mm256_srli_epi32(
+      _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(h)), salts), 26);
+  __m256i one = _mm256_set1_epi64x(1);
+  lo = _mm256_sllv_epi64(
+      one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(index)));
+  hi = _mm256_sllv_epi64(
+      one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(index, 1)));
+}
+#endif
+
+auto BloomFilter::addHash(u64 hash) -> void {
+  if (_blocks.empty())
+    _blocks.resize(1);
+  Block &block = _blocks[blockIndex(hash)];
+  u32 h = static_cast<u32>(hash);
+  ++_count;
+#if defined(__AVX2__)
+  __m256i lo, hi;
+  blockMasks(h, lo, hi);
+  auto *words = reinterpret_cast<__m256i *>(block.words);
+  _mm256_store_si256(words, _mm256_or_si256(_mm256_load_si256(words), lo));
+  _mm256_store_si256(words + 1,
+                     _mm256_or_si256(_mm256_load_si256(words + 1), hi));
+#else
+  for (usize i = 0; i < kWordsPerBlock; ++i)
+    block.words[i] |= 1ULL << ((h * kSalts[i]) >> 26);
+#endif
+}
+
+auto BloomFilter::containsHash(u64 hash) const -> bool {
+  if (_blocks.empty())
+    return false;
+  const Block &block = _blocks[blockIndex(hash)];
+  u32 h = static_cast<u32>(hash);
+#if defined(__AVX2__)
+  __m256i lo, hi;
+  blockMasks(h, lo, hi);
+  const auto *words = reinterpret_cast<const __m256i *>(block.words);
+  return _mm256_testc_si256(_mm256_load_si256(words), lo) &
+         _mm256_testc_si256(_mm256_load_si256(words + 1), hi);
+#else
+  u64 missing = 0;
+  for (usize i = 0; i < kWordsPerBlock; ++i)
+    missing |= ~block.words[i] & (1ULL << ((h * kSalts[i]) >> 26));
+  return missing == 0;
+#endif
+}
+
+auto BloomFilter::merge(const BloomFilter &other) -> roots::result<void, Error> {
+  if (other._blocks.size() != _blocks.size())
+    return roots::fail(Error("bloom filters have different sizes"));
+  for (usize i = 0; i < _blocks.size(); ++i)
+    detail::applyBitOpWords<detail::BitOp::Or>(
+        _blocks[i].words, other._blocks[i].words, kWordsPerBlock);
+  _count += other._count;
+  return roots::result<void, Error>();
+}
+
+auto BloomFilter::clear() -> void {
+  std::fill(_blocks.begin(), _blocks.end(), Block{});
+  _count = 0;
+}
+
+auto BloomFilter::estimatedFalsePositiveRate() const -> f64 {
+  if (_count == 0)
+    return 0;
+  return blockedFalsePositiveRate(static_cast<f64>(sizeInBytes() * 8) /
+                                  static_cast<f64>(_count));
+}
+
+auto BloomFilter::serialize() const -> std::vector<u8> {
+  std::vector<u8> out(kHeaderSize + sizeInBytes());
+  storeLE32(out.data(), kSerialMagic);
+  storeLE32(out.data() + 4, static_cast<u32>(kWordsPerBlock));
+  storeLE64(out.data() + 8, _blocks.size());
+  storeLE64(out.data() + 16, _count);
+  u8 *p = out.data() + kHeaderSize;
+  for (const Block &block : _blocks) {
+    for (u64 word : block.words) {
+      storeLE64(p, word);
+      p += 8;
+    }
+  }
+  return out;
+}
+
+auto BloomFilter::deserialize(std::span<const u8> bytes)
+    -> roots::result<BloomFilter, Error> {
+  if (bytes.size() < kHeaderSize || loadLE32(bytes.data()) != kSerialMagic)
+    return roots::fail(Error("not a serialized bloom filter"));
+  // Each key sets one bit per word, so the word count is the hash count
+  if (loadLE32(bytes.data() + 4) != kWordsPerBlock)
+    return roots::fail(Error("unsupported bloom filter hash count"));
+  u64 blocks = loadLE64(bytes.data() + 8);
+  // blockIndex scales a 32-bit hash by the block count
+  if (blocks == 0 || blocks > (u64(1) << 32))
+    return roots::fail(Error("corrupt bloom filter header"));
+  if (blocks > (bytes.size() - kHeaderSize) / sizeof(Block) ||
+      bytes.size() != kHeaderSize + blocks * sizeof(Block))
+    return roots::fail(Error("bloom filter size does not match its header"));
+
+  BloomFilter filter;
+  filter._blocks.resize(blocks);
+  filter._count = loadLE64(bytes.data() + 16);
+  const u8 *p = bytes.data() + kHeaderSize;
+  for (Block &block : filter._blocks) {
+    for (u64 &word : block.words) {
+      word = loadLE64(p);
+      p += 8;
+    }
+  }
+  return filter;
+}
+
+} // namespace roots::structures
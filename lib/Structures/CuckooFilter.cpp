@@ -0,0 +1,214 @@
+#include "Roots/Structures/CuckooFilter.hpp"
+#include "Endian.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace roots::structures {
+
+using namespace endian;
+
+static constexpr u32 kSerialMagic = 0x31464B43; // "CKF1"
+static constexpr usize kHeaderSize = 40;
+static constexpr f64 kTargetLoad = 0.95;
+static constexpr u64 kLaneOnes = 0x0001000100010001ULL;
+static constexpr u64 kLaneHighs = 0x8000800080008000ULL;
+
+CuckooFilter::CuckooFilter(usize expectedItems, f64 falsePositiveRate) {
+  // A lookup compares against 2 * kBucketSize fingerprints, each matching by
+  // chance with probability 2^-bits
+  f64 target = std::clamp(falsePositiveRate, 1e-9, 0.5);
+  f64 bits = std::ceil(std::log2(2.0 * kBucketSize / target));
+  _fingerprintBits = static_cast<u32>(std::clamp(bits, 4.0, 16.0));
+
+  f64 slots = static_cast<f64>(std::max<usize>(expectedItems, 1)) / kTargetLoad;
+  usize buckets = static_cast<usize>(std::ceil(slots / kBucketSize));
+  buckets = std::bit_ceil(std::max<usize>(buckets, 1));
+  _bucketMask = buckets - 1;
+  _slots.assign(buckets * kBucketSize, 0);
+}
+
+auto CuckooFilter::fingerprint(u64 hash) const -> u16 {
+  u16 fp = static_cast<u16>((hash >> 32) & ((1u << _fingerprintBits) - 1));
+  return fp == 0 ? 1 : fp;
+}
+
+auto CuckooFilter::altIndex(usize index, u16 fingerprint) const -> usize {
+  return (index ^ (static_cast<usize>(fingerprint) * 0x5bd1e995)) & _bucketMask;
+}
+
+auto CuckooFilter::bucketHas(usize index, u16 fingerprint) const -> bool {
+  // All four 16-bit slots at once: a slot equal to the fingerprint becomes a
+  // zero lane, which the usual has-zero-byte trick (on 16-bit lanes) detects
+  u64 bucket;
+  std::memcpy(&bucket, &_slots[index * kBucketSize], sizeof(bucket));
+  u64 x = bucket ^ (kLaneOnes * fingerprint);
+  return ((x - kLaneOnes) & ~x & kLaneHighs) != 0;
+}
+
+auto CuckooFilter::bucketInsert(usize index, u16 fingerprint) -> bool {
+  u16 *bucket = &_slots[index * kBucketSize];
+  for (usize i = 0; i < kBucketSize; ++i) {
+    if (bucket[i] == 0) {
+      bucket[i] = fingerprint;
+      return true;
+    }
+  }
+  return false;
+}
+
+auto CuckooFilter::bucketErase(usize index, u16 fingerprint) -> bool {
+  u16 *bucket = &_slots[index * kBucketSize];
+  for (usize i = 0; i < kBucketSize; ++i) {
+    if (bucket[i] == fingerprint) {
+      bucket[i] = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+auto CuckooFilter::insertFingerprint(usize index, u16 fingerprint) -> bool {
+  if (bucketInsert(index, fingerprint) ||
+      bucketInsert(altIndex(index, fingerprint), fingerprint))
+    return true;
+
+  // Both buckets are full: evict random residents to their other bucket
+  if (_rng & 1)
+    index = altIndex(index, fingerprint);
+  for (u32 kick = 0; kick < kMaxKicks; ++kick) {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 7;
+    _rng ^= _rng << 17;
+    std::swap(fingerprint, _slots[index * kBucketSize + (_rng & 3)]);
+    index = altIndex(index, fingerprint);
+    if (bucketInsert(index, fingerprint))
+      return true;
+  }
+  _victim = Victim{index, fingerprint, true};
+  return true;
+}
+
+auto CuckooFilter::addHash(u64 hash) -> bool {
+  if (_victim.used || _slots.empty())
+    return false;
+  u16 fp = fingerprint(hash);
+  insertFingerprint(static_cast<usize>(hash) & _bucketMask, fp);
+  ++_count;
+  return true;
+}
+
+auto CuckooFilter::containsHash(u64 hash) const -> bool {
+  if (_slots.empty())
+    return false;
+  u16 fp = fingerprint(hash);
+  usize i1 = static_cast<usize>(hash) & _bucketMask;
+  usize i2 = altIndex(i1, fp);
+  if (_victim.used && _victim.fingerprint == fp &&
+      (_victim.index == i1 || _victim.index == i2))
+    return true;
+  return bucketHas(i1, fp) || bucketHas(i2, fp);
+}
+
+auto CuckooFilter::eraseHash(u64 hash) -> bool {
+  if (_slots.empty())
+    return false;
+  u16 fp = fingerprint(hash);
+  usize i1 = static_cast<usize>(hash) & _bucketMask;
+  usize i2 = altIndex(i1, fp);
+  bool found = false;
+  if (_victim.used && _victim.fingerprint == fp &&
+      (_victim.index == i1 || _victim.index == i2)) {
+    _victim.used = false;
+    found = true;
+  } else {
+    found = bucketErase(i1, fp) || bucketErase(i2, fp);
+  }
+  if (!found)
+    return false;
+  --_count;
+  // A slot may have opened up for the stashed victim
+  if (_victim.used) {
+    _victim.used = false;
+    insertFingerprint(_victim.index, _victim.fingerprint);
+  }
+  return true;
+}
+
+auto CuckooFilter::clear() -> void {
+  std::fill(_slots.begin(), _slots.end(), 0);
+  _count = 0;
+  _victim = Victim{};
+}
+
+auto CuckooFilter::loadFactor() const -> f64 {
+  if (_slots.empty())
+    return 0;
+  return static_cast<f64>(_count) / static_cast<f64>(_slots.size());
+}
+
+auto CuckooFilter::serialize() const -> std::vector<u8> {
+  std::vector<u8> out(kHeaderSize + sizeInBytes());
+  storeLE32(out.data(), kSerialMagic);
+  storeLE32(out.data() + 4, _fingerprintBits);
+  storeLE64(out.data() + 8, _bucketMask + 1);
+  storeLE64(out.data() + 16, _count);
+  storeLE64(out.data() + 24, _victim.index);
+  storeLE16(out.data() + 32, _victim.fingerprint);
+  storeLE16(out.data() + 34, _victim.used ? 1 : 0);
+  u8 *p = out.data() + kHeaderSize;
+  for (u16 slot : _slots) {
+    storeLE16(p, slot);
+    p += 2;
+  }
+  return out;
+}
+
+auto CuckooFilter::deserialize(std::span<const u8> bytes)
+    -> roots::result<CuckooFilter, Error> {
+  if (bytes.size() < kHeaderSize || loadLE32(bytes.data()) != kSerialMagic)
+    return roots::fail(Error("not a serialized cuckoo filter"));
+  u32 bits = loadLE32(bytes.data() + 4);
+  u64 buckets = loadLE64(bytes.data() + 8);
+  if (bits < 4 || bits > 16 || buckets == 0 || !std::has_single_bit(buckets))
+    return roots::fail(Error("corrupt cuckoo filter header"));
+  if (buckets > (bytes.size() - kHeaderSize) / (kBucketSize * 2) ||
+      bytes.size() != kHeaderSize + buckets * kBucketSize * 2)
+    return roots::fail(Error("cuckoo filter size does not match its header"));
+
+  CuckooFilter filter;
+  filter._fingerprintBits = bits;
+  filter._bucketMask = buckets - 1;
+  filter._count = loadLE64(bytes.data() + 16);
+  u64 victimIndex = loadLE64(bytes.data() + 24);
+  u16 victimFingerprint = loadLE16(bytes.data() + 32);
+  u16 victimUsed = loadLE16(bytes.data() + 34);
+
+  // Stored fingerprints are non-zero and `bits` wide. An unused victim's
+  // other fields are left over from an erase and ignored
+  u32 limit = 1u << bits;
+  if (victimUsed > 1 ||
+      (victimUsed == 1 && (victimIndex >= buckets || victimFingerprint == 0 ||
+                           victimFingerprint >= limit)))
+    return roots::fail(Error("corrupt cuckoo filter victim"));
+  if (victimUsed == 1)
+    filter._victim = Victim{static_cast<usize>(victimIndex), victimFingerprint,
+                            true};
+
+  filter._slots.resize(buckets * kBucketSize);
+  u64 held = filter._victim.used ? 1 : 0;
+  const u8 *p = bytes.data() + kHeaderSize;
+  for (u16 &slot : filter._slots) {
+    slot = loadLE16(p);
+    p += 2;
+    if (slot >= limit)
+      return roots::fail(Error("corrupt cuckoo filter fingerprint"));
+    held += slot != 0;
+  }
+  if (held != filter._count)
+    return roots::fail(Error("cuckoo filter count does not match its slots"));
+  return filter;
+}
+
+} // namespace roots::structures
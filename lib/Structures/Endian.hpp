@@ -0,0 +1,50 @@
+#ifndef Roots_lib_Structures_Endian_hpp
+#define Roots_lib_Structures_Endian_hpp
+
+// Little-endian load/store helpers shared by the serializable structures
+
+#include "Roots/_defines.hpp"
+#include <cstring>
+
+namespace roots::structures::endian {
+
+inline auto loadLE16(const u8 *p) -> u16 {
+  return static_cast<u16>(p[0] | (p[1] << 8));
+}
+
+inline auto loadLE32(const u8 *p) -> u32 {
+  return static_cast<u32>(p[0]) | (static_cast<u32>(p[1]) << 8) |
+         (static_cast<u32>(p[2]) << 16) | (static_cast<u32>(p[3]) << 24);
+}
+
+inline auto loadLE64(const u8 *p) -> u64 {
+  u64 value;
+  std::memcpy(&value, p, sizeof(value));
+#if ROOTS_BYTE_ORDER == ROOTS_BIG_ENDIAN
+  value = ROOTS_BSWAP64(value);
+#endif
+  return value;
+}
+
+inline auto storeLE16(u8 *p, u16 v) -> void {
+  p[0] = static_cast<u8>(v);
+  p[1] = static_cast<u8>(v >> 8);
+}
+
+inline auto storeLE32(u8 *p, u32 v) -> void {
+  for (int i = 0; i < 4; ++i)
+    p[i] = static_cast<u8>(v >> (i * 8));
+}
+
+inline auto storeLE64(u8 *p, u64 v) -> void {
+#if ROOTS_BYTE_ORDER == ROOTS_BIG_ENDIAN
+  v = ROOTS_BSWAP64(v);
+#endif
+  std::memcpy(p, &v, sizeof(v));
+}
+
+inline auto align8(usize offset) -> usize { return (offset + 7) & ~usize(7); }
+
+} // namespace roots::structures::endian
+
+#endif
@@ -0,0 +1,968 @@
+#include "Roots/Structures/RoaringBitmap.hpp"
+#include "Roots/Structures/BitSet.hpp"
+#include "Endian.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace roots::structures {
+
+using namespace endian;
+
+using Container = RoaringBitmap::Container;
+using ContainerType = RoaringBitmap::ContainerType;
+
+static constexpr u32 kSerialMagic = 0x314D4252; // "RBM1"
+static constexpr usize kHeaderSize = 8;
+static constexpr usize kDescriptorSize = 16;
+
+/* Container helpers */
+
+static auto bitTest(const u64 *bits, u32 value) -> bool {
+  return (bits[value >> 6] >> (value & 63)) & 1;
+}
+
+static auto popcountWords(const u64 *bits) -> u32 {
+  u32 total = 0;
+  for (u32 i = 0; i < RoaringBitmap::kBitmapWords; ++i)
+    total += static_cast<u32>(std::popcount(bits[i]));
+  return total;
+}
+
+static auto makeArray(std::vector<u16> values) -> Container {
+  Container c;
+  c.type = ContainerType::Array;
+  c.cardinality = static_cast<u32>(values.size());
+  c.values = std::move(values);
+  return c;
+}
+
+static auto makeBitmap(std::vector<u64> bits, u32 cardinality) -> Container {
+  Container c;
+  c.type = ContainerType::Bitmap;
+  c.cardinality = cardinality;
+  c.bits = std::move(bits);
+  return c;
+}
+
+static auto bitmapToArray(const std::vector<u64> &bits, u32 cardinality)
+    -> Container {
+  std::vector<u16> values;
+  values.reserve(cardinality);
+  for (u32 w = 0; w < RoaringBitmap::kBitmapWords; ++w)
+    for (u64 b = bits[w]; b != 0; b &= b - 1)
+      values.push_back(static_cast<u16>(w * 64 + std::countr_zero(b)));
+  return makeArray(std::move(values));
+}
+
+// Picks array or bitmap form by cardinality (the invariant outside of runs)
+static auto fromBits(std::vector<u64> bits, u32 cardinality) -> Container {
+  if (cardinality <= RoaringBitmap::kMaxArraySize)
+    return bitmapToArray(bits, cardinality);
+  return makeBitmap(std::move(bits), cardinality);
+}
+
+static auto fromSortedValues(std::vector<u16> values) -> Container {
+  if (values.size() <= RoaringBitmap::kMaxArraySize)
+    return makeArray(std::move(values));
+  std::vector<u64> bits(RoaringBitmap::kBitmapWords, 0);
+  for (u16 v : values)
+    bits[v >> 6] |= 1ULL << (v & 63);
+  return makeBitmap(std::move(bits), static_cast<u32>(values.size()));
+}
+
+static auto setRange(u64 *bits, u32 first, u32 last) -> void {
+  // sets [first, last]
+  u32 fw = first >> 6, lw = last >> 6;
+  u64 fm = ~0ULL << (first & 63);
+  u64 lm = ~0ULL >> (63 - (last & 63));
+  if (fw == lw) {
+    bits[fw] |= fm & lm;
+    return;
+  }
+  bits[fw] |= fm;
+  for (u32 w = fw + 1; w < lw; ++w)
+    bits[w] = ~0ULL;
+  bits[lw] |= lm;
+}
+
+static auto toBits(const Container &c) -> std::vector<u64> {
+  if (c.type == ContainerType::Bitmap)
+    return c.bits;
+  std::vector<u64> bits(RoaringBitmap::kBitmapWords, 0);
+  if (c.type == ContainerType::Array) {
+    for (u16 v : c.values)
+      bits[v >> 6] |= 1ULL << (v & 63);
+  } else {
+    for (usize r = 0; r < c.values.size(); r += 2)
+      setRange(bits.data(), c.values[r], c.values[r] + c.values[r + 1]);
+  }
+  return bits;
+}
+
+// Converts a run container back to array/bitmap form
+static auto unrun(const Container &c) -> Container {
+  if (c.cardinality <= RoaringBitmap::kMaxArraySize) {
+    std::vector<u16> values;
+    values.reserve(c.cardinality);
+    for (usize r = 0; r < c.values.size(); r += 2) {
+      u32 start = c.values[r], end = start + c.values[r + 1];
+      for (u32 v = start; v <= end; ++v)
+        values.push_back(static_cast<u16>(v));
+    }
+    return makeArray(std::move(values));
+  }
+  return makeBitmap(toBits(c), c.cardinality);
+}
+
+static auto countRuns(const Container &c) -> u32 {
+  switch (c.type) {
+  case ContainerType::Array: {
+    u32 runs = 0;
+    for (usize i = 0; i < c.values.size(); ++i)
+      if (i == 0 || c.values[i] != c.values[i - 1] + 1)
+        ++runs;
+    return runs;
+  }
+  case ContainerType::Bitmap: {
+    // a run starts wherever a set bit follows a clear one
+    u32 runs = 0;
+    u64 carry = 0;
+    for (u32 w = 0; w < RoaringBitmap::kBitmapWords; ++w) {
+      u64 word = c.bits[w];
+      runs += static_cast<u32>(std::popcount(word & ~((word << 1) | carry)));
+      carry = word >> 63;
+    }
+    return runs;
+  }
+  case ContainerType::Run:
+    return static_cast<u32>(c.values.size() / 2);
+  }
+  ROOTS_UNREACHABLE;
+}
+
+static auto payloadBytes(ContainerType type, usize length) -> usize {
+  return type == ContainerType::Bitmap ? length * sizeof(u64)
+                                       : length * sizeof(u16);
+}
+
+static auto containerBytes(const Container &c) -> usize {
+  return c.type == ContainerType::Bitmap ? payloadBytes(c.type, c.bits.size())
+                                         : payloadBytes(c.type, c.values.size());
+}
+
+// Rewrites a container in whichever form takes the least space
+static auto optimize(Container &c) -> void {
+  usize runBytes = countRuns(c) * 2 * sizeof(u16);
+  usize plainBytes = c.cardinality <= RoaringBitmap::kMaxArraySize
+                         ? c.cardinality * sizeof(u16)
+                         : RoaringBitmap::kBitmapWords * sizeof(u64);
+
+  if (runBytes < plainBytes) {
+    if (c.type == ContainerType::Run)
+      return;
+    std::vector<u16> runs;
+    u32 start = 0, prev = 0;
+    bool open = false;
+    auto visit = [&](u32 v) {
+      if (open && v == prev + 1) {
+        prev = v;
+        return;
+      }
+      if (open) {
+        runs.push_back(static_cast<u16>(start));
+        runs.push_back(static_cast<u16>(prev - start));
+      }
+      start = prev = v;
+      open = true;
+    };
+    if (c.type == ContainerType::Array) {
+      for (u16 v : c.values)
+        visit(v);
+    } else {
+      for (u32 w = 0; w < RoaringBitmap::kBitmapWords; ++w)
+        for (u64 b = c.bits[w]; b != 0; b &= b - 1)
+          visit(w * 64 + static_cast<u32>(std::countr_zero(b)));
+    }
+    if (open) {
+      runs.push_back(static_cast<u16>(start));
+      runs.push_back(static_cast<u16>(prev - start));
+    }
+    u32 cardinality = c.cardinality;
+    c = Container();
+    c.type = ContainerType::Run;
+    c.cardinality = cardinality;
+    c.values = std::move(runs);
+  } else if (c.type == ContainerType::Run) {
+    c = unrun(c);
+  }
+}
+
+static auto containerContains(const Container &c, u16 value) -> bool {
+  switch (c.type) {
+  case ContainerType::Array:
+    return std::binary_search(c.values.begin(), c.values.end(), value);
+  case ContainerType::Bitmap:
+    return bitTest(c.bits.data(), value);
+  case ContainerType::Run: {
+    // last run starting at or before value
+    usize lo = 0, hi = c.values.size() / 2;
+    while (lo < hi) {
+      usize mid = (lo + hi) / 2;
+      if (c.values[mid * 2] <= value)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == 0)
+      return false;
+    u32 start = c.values[(lo - 1) * 2];
+    return value <= start + c.values[(lo - 1) * 2 + 1];
+  }
+  }
+  ROOTS_UNREACHABLE;
+}
+
+// Galloping search: first index >= from with values[index] >= target
+static auto gallop(const std::vector<u16> &values, usize from, u16 target)
+    -> usize {
+  usize size = values.size();
+  if (from >= size || values[from] >= target)
+    return from;
+  usize step = 1;
+  usize lo = from, hi = from + 1;
+  while (hi < size && values[hi] < target) {
+    lo = hi;
+    step *= 2;
+    hi = from + step;
+  }
+  if (hi > size)
+    hi = size;
+  return static_cast<usize>(
+      std::lower_bound(values.begin() + static_cast<isize>(lo + 1),
+                       values.begin() + static_cast<isize>(hi), target) -
+      values.begin());
+}
+
+// Calls emit(v) for each value in both sorted arrays
+template <typename F>
+static auto intersectArrays(const std::vector<u16> &a,
+                            const std::vector<u16> &b, F &&emit) -> void {
+  const auto &small = a.size() <= b.size() ? a : b;
+  const auto &large = a.size() <= b.size() ? b : a;
+  if (small.size() * 32 < large.size()) {
+    usize j = 0;
+    for (u16 v : small) {
+      j = gallop(large, j, v);
+      if (j == large.size())
+        return;
+      if (large[j] == v)
+        emit(v);
+    }
+    return;
+  }
+  usize i = 0, j = 0;
+  while (i < a.size() && j < b.size()) {
+    if (a[i] < b[j]) {
+      ++i;
+    } else if (b[j] < a[i]) {
+      ++j;
+    } else {
+      emit(a[i]);
+      ++i;
+      ++j;
+    }
+  }
+}
+
+static auto intersect(const Container &x, const Container &y) -> Container {
+  if (x.type == ContainerType::Run)
+    return intersect(unrun(x), y);
+  if (y.type == ContainerType::Run)
+    return intersect(x, unrun(y));
+
+  if (x.type == ContainerType::Array && y.type == ContainerType::Array) {
+    std::vector<u16> out;
+    out.reserve(std::min(x.values.size(), y.values.size()));
+    intersectArrays(x.values, y.values, [&](u16 v) { out.push_back(v); });
+    return makeArray(std::move(out));
+  }
+  if (x.type == ContainerType::Bitmap && y.type == ContainerType::Bitmap) {
+    std::vector<u64> bits = x.bits;
+    detail::applyBitOpWords<detail::BitOp::And>(bits.data(), y.bits.data(),
+                                                RoaringBitmap::kBitmapWords);
+    u32 cardinality = popcountWords(bits.data());
+    return fromBits(std::move(bits), cardinality);
+  }
+  const Container &array = x.type == ContainerType::Array ? x : y;
+  const Container &bitmap = x.type == ContainerType::Array ? y : x;
+  std::vector<u16> out;
+  out.reserve(array.values.size());
+  for (u16 v : array.values)
+    if (bitTest(bitmap.bits.data(), v))
+      out.push_back(v);
+  return makeArray(std::move(out));
+}
+
+static auto intersectCount(const Container &x, const Container &y) -> u64 {
+  if (x.type == ContainerType::Run)
+    return intersectCount(unrun(x), y);
+  if (y.type == ContainerType::Run)
+    return intersectCount(x, unrun(y));
+
+  u64 count = 0;
+  if (x.type == ContainerType::Array && y.type == ContainerType::Array) {
+    intersectArrays(x.values, y.values, [&](u16) { ++count; });
+  } else if (x.type == ContainerType::Bitmap &&
+             y.type == ContainerType::Bitmap) {
+    for (u32 w = 0; w < RoaringBitmap::kBitmapWords; ++w)
+      count += static_cast<u64>(std::popcount(x.bits[w] & y.bits[w]));
+  } else {
+    const Container &array = x.type == ContainerType::Array ? x : y;
+    const Container &bitmap = x.type == ContainerType::Array ? y : x;
+    for (u16 v : array.values)
+      count += bitTest(bitmap.bits.data(), v) ? 1 : 0;
+  }
+  return count;
+}
+
+static auto unite(const Container &x, const Container &y) -> Container {
+  if (x.type == ContainerType::Run)
+    return unite(unrun(x), y);
+  if (y.type == ContainerType::Run)
+    return unite(x, unrun(y));
+
+  if (x.type == ContainerType::Array && y.type == ContainerType::Array) {
+    std::vector<u16> out;
+    out.reserve(x.values.size() + y.values.size());
+    std::set_union(x.values.begin(), x.values.end(), y.values.begin(),
+                   y.values.end(), std::back_inserter(out));
+    return fromSortedValues(std::move(out));
+  }
+  if (x.type == ContainerType::Bitmap && y.type == ContainerType::Bitmap) {
+    std::vector<u64> bits = x.bits;
+    detail::applyBitOpWords<detail::BitOp::Or>(bits.data(), y.bits.data(),
+                                               RoaringBitmap::kBitmapWords);
+    u32 cardinality = popcountWords(bits.data());
+    return makeBitmap(std::move(bits), cardinality);
+  }
+  const Container &array = x.type == ContainerType::Array ? x : y;
+  const Container &bitmap = x.type == ContainerType::Array ? y : x;
+  std::vector<u64> bits = bitmap.bits;
+  u32 cardinality = bitmap.cardinality;
+  for (u16 v : array.values) {
+    u64 bit = 1ULL << (v & 63);
+    cardinality += (bits[v >> 6] & bit) ? 0 : 1;
+    bits[v >> 6] |= bit;
+  }
+  return makeBitmap(std::move(bits), cardinality);
+}
+
+static auto difference(const Container &x, const Container &y) -> Container {
+  if (x.type == ContainerType::Run)
+    return difference(unrun(x), y);
+  if (y.type == ContainerType::Run)
+    return difference(x, unrun(y));
+
+  if (x.type == ContainerType::Array) {
+    std::vector<u16> out;
+    out.reserve(x.values.size());
+    if (y.type == ContainerType::Array) {
+      std::set_difference(x.values.begin(), x.values.end(), y.values.begin(),
+                          y.values.end(), std::back_inserter(out));
+    } else {
+      for (u16 v : x.values)
+        if (!bitTest(y.bits.data(), v))
+          out.push_back(v);
+    }
+    return makeArray(std::move(out));
+  }
+
+  std::vector<u64> bits = x.bits;
+  if (y.type == ContainerType::Bitmap) {
+    detail::applyBitOpWords<detail::BitOp::AndNot>(
+        bits.data(), y.bits.data(), RoaringBitmap::kBitmapWords);
+  } else {
+    for (u16 v : y.values)
+      bits[v >> 6] &= ~(1ULL << (v & 63));
+  }
+  u32 cardinality = popcountWords(bits.data());
+  return fromBits(std::move(bits), cardinality);
+}
+
+static auto containerEquals(const Container &x, const Container &y) -> bool {
+  if (x.cardinality != y.cardinality)
+    return false;
+  if (x.type == y.type)
+    return x.values == y.values && x.bits == y.bits;
+  return toBits(x) == toBits(y);
+}
+
+/* RoaringBitmap */
+
+RoaringBitmap::RoaringBitmap(std::initializer_list<u32> values) {
+  *this = fromValues(std::span<const u32>(values.begin(), values.size()));
+}
+
+auto RoaringBitmap::fromValues(std::span<const u32> values) -> RoaringBitmap {
+  std::vector<u32> sorted(values.begin(), values.end());
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  RoaringBitmap result;
+  usize i = 0;
+  while (i < sorted.size()) {
+    u16 key = static_cast<u16>(sorted[i] >> 16);
+    std::vector<u16> low;
+    for (; i < sorted.size() && (sorted[i] >> 16) == key; ++i)
+      low.push_back(static_cast<u16>(sorted[i]));
+    result._keys.push_back(key);
+    result._containers.push_back(fromSortedValues(std::move(low)));
+  }
+  return result;
+}
+
+auto RoaringBitmap::findContainer(u16 key) const -> isize {
+  auto it = std::lower_bound(_keys.begin(), _keys.end(), key);
+  if (it == _keys.end() || *it != key)
+    return -1;
+  return it - _keys.begin();
+}
+
+auto RoaringBitmap::containerFor(u16 key) -> Container & {
+  auto it = std::lower_bound(_keys.begin(), _keys.end(), key);
+  auto index = it - _keys.begin();
+  if (it == _keys.end() || *it != key) {
+    _keys.insert(it, key);
+    _containers.insert(_containers.begin() + index, Container());
+  }
+  return _containers[static_cast<usize>(index)];
+}
+
+auto RoaringBitmap::eraseContainer(usize index) -> void {
+  _keys.erase(_keys.begin() + static_cast<isize>(index));
+  _containers.erase(_containers.begin() + static_cast<isize>(index));
+}
+
+auto RoaringBitmap::add(u32 value) -> bool {
+  Container &c = containerFor(static_cast<u16>(value >> 16));
+  u16 low = static_cast<u16>(value);
+
+  if (c.type == ContainerType::Run) {
+    if (containerContains(c, low))
+      return false;
+    c = unrun(c);
+  }
+
+  if (c.type == ContainerType::Bitmap) {
+    u64 bit = 1ULL << (low & 63);
+    if (c.bits[low >> 6] & bit)
+      return false;
+    c.bits[low >> 6] |= bit;
+    ++c.cardinality;
+    return true;
+  }
+
+  auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+  if (it != c.values.end() && *it == low)
+    return false;
+  if (c.cardinality == kMaxArraySize) {
+    c = makeBitmap(toBits(c), c.cardinality);
+    c.bits[low >> 6] |= 1ULL << (low & 63);
+  } else {
+    c.values.insert(it, low);
+  }
+  ++c.cardinality;
+  return true;
+}
+
+auto RoaringBitmap::addRange(u64 first, u64 last) -> void {
+  if (last > (1ULL << 32))
+    last = 1ULL << 32;
+  while (first < last) {
+    u16 key = static_cast<u16>(first >> 16);
+    u64 chunkEnd = std::min<u64>(last, (static_cast<u64>(key) + 1) << 16);
+    Container &c = containerFor(key);
+    std::vector<u64> bits = toBits(c);
+    setRange(bits.data(), static_cast<u32>(first & 0xffff),
+             static_cast<u32>((chunkEnd - 1) & 0xffff));
+    u32 cardinality = popcountWords(bits.data());
+    c = fromBits(std::move(bits), cardinality);
+    optimize(c);
+    first = chunkEnd;
+  }
+}
+
+auto RoaringBitmap::remove(u32 value) -> bool {
+  isize index = findContainer(static_cast<u16>(value >> 16));
+  if (index < 0)
+    return false;
+  Container &c = _containers[static_cast<usize>(index)];
+  u16 low = static_cast<u16>(value);
+
+  if (c.type == ContainerType::Run) {
+    if (!containerContains(c, low))
+      return false;
+    c = unrun(c);
+  }
+
+  if (c.type == ContainerType::Bitmap) {
+    u64 bit = 1ULL << (low & 63);
+    if (!(c.bits[low >> 6] & bit))
+      return false;
+    c.bits[low >> 6] &= ~bit;
+    if (--c.cardinality <= kMaxArraySize)
+      c = bitmapToArray(c.bits, c.cardinality);
+    return true;
+  }
+
+  auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+  if (it == c.values.end() || *it != low)
+    return false;
+  c.values.erase(it);
+  if (--c.cardinality == 0)
+    eraseContainer(static_cast<usize>(index));
+  return true;
+}
+
+auto RoaringBitmap::contains(u32 value) const -> bool {
+  isize index = findContainer(static_cast<u16>(value >> 16));
+  return index >= 0 && containerContains(_containers[static_cast<usize>(index)],
+                                          static_cast<u16>(value));
+}
+
+auto RoaringBitmap::cardinality() const -> u64 {
+  u64 total = 0;
+  for (const auto &c : _containers)
+    total += c.cardinality;
+  return total;
+}
+
+auto RoaringBitmap::clear() -> void {
+  _keys.clear();
+  _containers.clear();
+}
+
+auto RoaringBitmap::minimum() const -> u32 { return *begin(); }
+
+auto RoaringBitmap::maximum() const -> u32 {
+  const Container &c = _containers.back();
+  u32 high = static_cast<u32>(_keys.back()) << 16;
+  switch (c.type) {
+  case ContainerType::Array:
+    return high | c.values.back();
+  case ContainerType::Run:
+    return high | (c.values[c.values.size() - 2] + c.values.back());
+  case ContainerType::Bitmap:
+    for (u32 w = kBitmapWords; w-- > 0;)
+      if (c.bits[w] != 0)
+        return high | (w * 64 + 63 - static_cast<u32>(std::countl_zero(c.bits[w])));
+  }
+  ROOTS_UNREACHABLE;
+}
+
+auto RoaringBitmap::runOptimize() -> void {
+  for (auto &c : _containers)
+    optimize(c);
+}
+
+auto RoaringBitmap::sizeInBytes() const -> usize {
+  usize total = 0;
+  for (const auto &c : _containers)
+    total += containerBytes(c);
+  return total;
+}
+
+auto RoaringBitmap::operator&=(const RoaringBitmap &other) -> RoaringBitmap & {
+  *this = *this & other;
+  return *this;
+}
+
+auto RoaringBitmap::operator|=(const RoaringBitmap &other) -> RoaringBitmap & {
+  *this = *this | other;
+  return *this;
+}
+
+auto operator&(const RoaringBitmap &a, const RoaringBitmap &b)
+    -> RoaringBitmap {
+  RoaringBitmap result;
+  usize i = 0, j = 0;
+  while (i < a._keys.size() && j < b._keys.size()) {
+    if (a._keys[i] < b._keys[j]) {
+      ++i;
+    } else if (b._keys[j] < a._keys[i]) {
+      ++j;
+    } else {
+      Container c = intersect(a._containers[i], b._containers[j]);
+      if (c.cardinality != 0) {
+        result._keys.push_back(a._keys[i]);
+        result._containers.push_back(std::move(c));
+      }
+      ++i;
+      ++j;
+    }
+  }
+  return result;
+}
+
+auto operator|(const RoaringBitmap &a, const RoaringBitmap &b)
+    -> RoaringBitmap {
+  RoaringBitmap result;
+  usize i = 0, j = 0;
+  while (i < a._keys.size() || j < b._keys.size()) {
+    if (j == b._keys.size() || (i < a._keys.size() && a._keys[i] < b._keys[j])) {
+      result._keys.push_back(a._keys[i]);
+      result._containers.push_back(a._containers[i++]);
+    } else if (i == a._keys.size() || b._keys[j] < a._keys[i]) {
+      result._keys.push_back(b._keys[j]);
+      result._containers.push_back(b._containers[j++]);
+    } else {
+      result._keys.push_back(a._keys[i]);
+      result._containers.push_back(unite(a._containers[i++], b._containers[j++]));
+    }
+  }
+  return result;
+}
+
+auto RoaringBitmap::andNot(const RoaringBitmap &other) -> RoaringBitmap & {
+  usize i = 0, j = 0;
+  while (i < _keys.size() && j < other._keys.size()) {
+    if (_keys[i] < other._keys[j]) {
+      ++i;
+    } else if (other._keys[j] < _keys[i]) {
+      ++j;
+    } else {
+      _containers[i] = difference(_containers[i], other._containers[j]);
+      if (_containers[i].cardinality == 0)
+        eraseContainer(i);
+      else
+        ++i;
+      ++j;
+    }
+  }
+  return *this;
+}
+
+auto RoaringBitmap::andCardinality(const RoaringBitmap &other) const -> u64 {
+  u64 total = 0;
+  usize i = 0, j = 0;
+  while (i < _keys.size() && j < other._keys.size()) {
+    if (_keys[i] < other._keys[j])
+      ++i;
+    else if (other._keys[j] < _keys[i])
+      ++j;
+    else
+      total += intersectCount(_containers[i++], other._containers[j++]);
+  }
+  return total;
+}
+
+auto RoaringBitmap::intersects(const RoaringBitmap &other) const -> bool {
+  usize i = 0, j = 0;
+  while (i < _keys.size() && j < other._keys.size()) {
+    if (_keys[i] < other._keys[j])
+      ++i;
+    else if (other._keys[j] < _keys[i])
+      ++j;
+    else if (intersectCount(_containers[i++], other._containers[j++]) != 0)
+      return true;
+  }
+  return false;
+}
+
+auto RoaringBitmap::operator==(const RoaringBitmap &other) const -> bool {
+  if (_keys != other._keys)
+    return false;
+  for (usize i = 0; i < _containers.size(); ++i)
+    if (!containerEquals(_containers[i], other._containers[i]))
+      return false;
+  return true;
+}
+
+auto RoaringBitmap::toVector() const -> std::vector<u32> {
+  std::vector<u32> result;
+  result.reserve(cardinality());
+  forEach([&](u32 v) { result.push_back(v); });
+  return result;
+}
+
+auto RoaringBitmap::serialize() const -> std::vector<u8> {
+  usize offset = align8(kHeaderSize + kDescriptorSize * _containers.size());
+  std::vector<usize> offsets;
+  offsets.reserve(_containers.size());
+  for (const auto &c : _containers) {
+    offsets.push_back(offset);
+    offset = align8(offset + containerBytes(c));
+  }
+
+  std::vector<u8> out(offset, 0);
+  storeLE32(out.data(), kSerialMagic);
+  storeLE32(out.data() + 4, static_cast<u32>(_containers.size()));
+
+  for (usize i = 0; i < _containers.size(); ++i) {
+    const Container &c = _containers[i];
+    u8 *desc = out.data() + kHeaderSize + i * kDescriptorSize;
+    usize length =
+        c.type == ContainerType::Bitmap ? c.bits.size() : c.values.size();
+    storeLE16(desc, _keys[i]);
+    desc[2] = static_cast<u8>(c.type);
+    storeLE32(desc + 4, c.cardinality);
+    storeLE32(desc + 8, static_cast<u32>(offsets[i]));
+    storeLE32(desc + 12, static_cast<u32>(length));
+
+    u8 *payload = out.data() + offsets[i];
+    if (c.type == ContainerType::Bitmap) {
+      for (usize w = 0; w < c.bits.size(); ++w)
+        storeLE64(payload + w * 8, c.bits[w]);
+    } else {
+      for (usize v = 0; v < c.values.size(); ++v)
+        storeLE16(payload + v * 2, c.values[v]);
+    }
+  }
+  return out;
+}
+
+auto RoaringBitmap::deserialize(std::span<const u8> bytes)
+    -> roots::result<RoaringBitmap, Error> {
+  auto view = RoaringBitmapView::open(bytes);
+  if (!view)
+    return roots::fail(view.error());
+  return view->materialize();
+}
+
+/* RoaringBitmap::Iterator */
+
+RoaringBitmap::Iterator::Iterator(const RoaringBitmap *bitmap, usize container)
+    : _bitmap(bitmap), _container(container) {
+  load();
+}
+
+auto RoaringBitmap::Iterator::load() -> void {
+  _pos = 0;
+  _bits = 0;
+  _offset = 0;
+  if (_container >= _bitmap->_containers.size())
+    return;
+
+  const Container &c = _bitmap->_containers[_container];
+  u32 high = static_cast<u32>(_bitmap->_keys[_container]) << 16;
+  switch (c.type) {
+  case ContainerType::Array:
+  case ContainerType::Run:
+    _value = high | c.values[0];
+    break;
+  case ContainerType::Bitmap:
+    while (c.bits[_pos] == 0)
+      ++_pos;
+    _bits = c.bits[_pos];
+    _value = high | static_cast<u32>(_pos * 64 + std::countr_zero(_bits));
+    break;
+  }
+}
+
+auto RoaringBitmap::Iterator::advance() -> void {
+  const Container &c = _bitmap->_containers[_container];
+  u32 high = static_cast<u32>(_bitmap->_keys[_container]) << 16;
+  switch (c.type) {
+  case ContainerType::Array:
+    if (++_pos < c.values.size()) {
+      _value = high | c.values[_pos];
+      return;
+    }
+    break;
+  case ContainerType::Bitmap:
+    _bits &= _bits - 1;
+    while (_bits == 0 && ++_pos < kBitmapWords)
+      _bits = c.bits[_pos];
+    if (_bits != 0) {
+      _value = high | static_cast<u32>(_pos * 64 + std::countr_zero(_bits));
+      return;
+    }
+    break;
+  case ContainerType::Run:
+    if (++_offset <= c.values[_pos + 1]) {
+      _value = high | (c.values[_pos] + _offset);
+      return;
+    }
+    _offset = 0;
+    _pos += 2;
+    if (_pos < c.values.size()) {
+      _value = high | c.values[_pos];
+      return;
+    }
+    break;
+  }
+  ++_container;
+  load();
+}
+
+/* RoaringBitmapView */
+
+// Checks a container payload against its descriptor: array values strictly
+// increasing, bitmap popcount equal to the cardinality, and runs sorted,
+// disjoint, inside the 16-bit range and adding up to the cardinality
+static auto validPayload(ContainerType type, const u8 *payload, u32 length,
+                         u32 cardinality) -> bool {
+  switch (type) {
+  case ContainerType::Array:
+    for (u32 i = 1; i < length; ++i)
+      if (loadLE16(payload + (i - 1) * 2) >= loadLE16(payload + i * 2))
+        return false;
+    return true;
+  case ContainerType::Bitmap: {
+    u64 total = 0;
+    for (u32 w = 0; w < length; ++w)
+      total += static_cast<u64>(std::popcount(loadLE64(payload + w * 8)));
+    return total == cardinality;
+  }
+  case ContainerType::Run: {
+    u64 total = 0;
+    u32 next = 0; // the smallest start the next run may have
+    for (u32 r = 0; r < length; r += 2) {
+      u32 start = loadLE16(payload + r * 2);
+      u32 end = start + loadLE16(payload + r * 2 + 2);
+      if (start < next || end > 0xFFFF)
+        return false;
+      total += end - start + 1;
+      next = end + 1;
+    }
+    return total == cardinality;
+  }
+  }
+  return false;
+}
+
+auto RoaringBitmapView::open(std::span<const u8> bytes)
+    -> roots::result<RoaringBitmapView, Error> {
+  if (bytes.size() < kHeaderSize || loadLE32(bytes.data()) != kSerialMagic)
+    return roots::fail(Error("not a serialized roaring bitmap"));
+
+  RoaringBitmapView view;
+  view._bytes = bytes;
+  view._count = loadLE32(bytes.data() + 4);
+  if (view._count > 65536 ||
+      bytes.size() < kHeaderSize + kDescriptorSize * view._count)
+    return roots::fail(Error("truncated roaring bitmap container table"));
+
+  for (u32 i = 0; i < view._count; ++i) {
+    const u8 *desc = view.descriptor(i);
+    auto type = static_cast<ContainerType>(desc[2]);
+    u32 cardinality = loadLE32(desc + 4);
+    u32 offset = loadLE32(desc + 8);
+    u32 length = loadLE32(desc + 12);
+
+    bool valid = false;
+    if (type == ContainerType::Array)
+      valid = length == cardinality && cardinality <= 65536;
+    else if (type == ContainerType::Bitmap)
+      valid = length == RoaringBitmap::kBitmapWords && cardinality <= 65536;
+    else if (type == ContainerType::Run)
+      valid = length % 2 == 0 && cardinality <= 65536;
+    if (!valid || cardinality == 0 || length == 0 || offset % 8 != 0 ||
+        static_cast<u64>(offset) + payloadBytes(type, length) > bytes.size() ||
+        !validPayload(type, bytes.data() + offset, length, cardinality))
+      return roots::fail(Error("corrupt roaring bitmap container"));
+    if (i > 0 && loadLE16(view.descriptor(i - 1)) >= loadLE16(desc))
+      return roots::fail(Error("roaring bitmap containers out of order"));
+  }
+  return view;
+}
+
+auto RoaringBitmapView::descriptor(u32 index) const -> const u8 * {
+  return _bytes.data() + kHeaderSize + kDescriptorSize * index;
+}
+
+auto RoaringBitmapView::findContainer(u16 key) const -> isize {
+  u32 lo = 0, hi = _count;
+  while (lo < hi) {
+    u32 mid = (lo + hi) / 2;
+    u16 k = loadLE16(descriptor(mid));
+    if (k == key)
+      return mid;
+    if (k < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return -1;
+}
+
+auto RoaringBitmapView::contains(u32 value) const -> bool {
+  isize index = findContainer(static_cast<u16>(value >> 16));
+  if (index < 0)
+    return false;
+
+  const u8 *desc = descriptor(static_cast<u32>(index));
+  const u8 *payload = _bytes.data() + loadLE32(desc + 8);
+  u32 length = loadLE32(desc + 12);
+  u16 low = static_cast<u16>(value);
+
+  switch (static_cast<ContainerType>(desc[2])) {
+  case ContainerType::Bitmap:
+    return (loadLE64(payload + (low >> 6) * 8) >> (low & 63)) & 1;
+  case ContainerType::Array: {
+    u32 lo = 0, hi = length;
+    while (lo < hi) {
+      u32 mid = (lo + hi) / 2;
+      u16 v = loadLE16(payload + mid * 2);
+      if (v == low)
+        return true;
+      if (v < low)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return false;
+  }
+  case ContainerType::Run: {
+    u32 lo = 0, hi = length / 2;
+    while (lo < hi) {
+      u32 mid = (lo + hi) / 2;
+      if (loadLE16(payload + mid * 4) <= low)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == 0)
+      return false;
+    u32 start = loadLE16(payload + (lo - 1) * 4);
+    return low <= start + loadLE16(payload + (lo - 1) * 4 + 2);
+  }
+  }
+  return false;
+}
+
+auto RoaringBitmapView::cardinality() const -> u64 {
+  u64 total = 0;
+  for (u32 i = 0; i < _count; ++i)
+    total += loadLE32(descriptor(i) + 4);
+  return total;
+}
+
+auto RoaringBitmapView::materialize() const -> RoaringBitmap {
+  RoaringBitmap result;
+  result._keys.reserve(_count);
+  result._containers.reserve(_count);
+  for (u32 i = 0; i < _count; ++i) {
+    const u8 *desc = descriptor(i);
+    const u8 *payload = _bytes.data() + loadLE32(desc + 8);
+    u32 length = loadLE32(desc + 12);
+
+    Container c;
+    c.type = static_cast<ContainerType>(desc[2]);
+    c.cardinality = loadLE32(desc + 4);
+    if (c.type == ContainerType::Bitmap) {
+      c.bits.resize(length);
+      for (u32 w = 0; w < length; ++w)
+        c.bits[w] = loadLE64(payload + w * 8);
+    } else {
+      c.values.resize(length);
+      for (u32 v = 0; v < length; ++v)
+        c.values[v] = loadLE16(payload + v * 2);
+    }
+    result._keys.push_back(loadLE16(desc));
+    result._containers.push_back(std::move(c));
+  }
+  return result;
+}
+
+} // namespace roots::structures
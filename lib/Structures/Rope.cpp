@@ -0,0 +1,421 @@
+#include "Roots/Structures/Rope.hpp"
+#include "Roots/String/Scan.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace roots::structures {
+
+namespace detail {
+
+struct RopeNode {
+  bool leaf = true;
+  usize bytes = 0;
+  usize newlines = 0;
+  std::string text;                               // leaves
+  std::vector<std::shared_ptr<RopeNode>> children; // inner nodes
+};
+
+} // namespace detail
+
+using detail::RopeNode;
+using NodePtr = std::shared_ptr<RopeNode>;
+
+namespace {
+
+constexpr usize kMaxLeaf = 1024;
+constexpr usize kTargetLeaf = 768;
+constexpr usize kMinLeaf = 256;
+constexpr usize kMaxChildren = 16;
+constexpr usize kMinChildren = 4;
+
+auto countNewlines(std::string_view text) -> usize {
+  return str::countByte(text, '\n');
+}
+
+auto makeLeaf(std::string text) -> NodePtr {
+  auto node = std::make_shared<RopeNode>();
+  node->bytes = text.size();
+  node->newlines = countNewlines(text);
+  node->text = std::move(text);
+  return node;
+}
+
+auto recount(RopeNode &node) -> void {
+  node.bytes = 0;
+  node.newlines = 0;
+  for (const NodePtr &child : node.children) {
+    node.bytes += child->bytes;
+    node.newlines += child->newlines;
+  }
+}
+
+auto makeInner(std::vector<NodePtr> children) -> NodePtr {
+  auto node = std::make_shared<RopeNode>();
+  node->leaf = false;
+  node->children = std::move(children);
+  recount(*node);
+  return node;
+}
+
+/// @brief The node in `slot`, copied first if another rope shares it. A
+/// node held by a single pointer can only be reached through this rope
+auto mutate(NodePtr &slot) -> RopeNode & {
+  if (slot.use_count() != 1)
+    slot = std::make_shared<RopeNode>(*slot);
+  return *slot;
+}
+
+/// @brief Splits [0, count) into `groups` nearly equal consecutive ranges
+/// and calls fn(begin, end) for each
+template <typename F> auto splitEvenly(usize count, usize groups, F &&fn) {
+  usize begin = 0;
+  for (usize i = 0; i < groups; ++i) {
+    usize end = count * (i + 1) / groups;
+    fn(begin, end);
+    begin = end;
+  }
+}
+
+/// @brief Cuts text into leaves of about kTargetLeaf bytes
+auto chunkText(std::string_view text) -> std::vector<NodePtr> {
+  std::vector<NodePtr> leaves;
+  usize groups = std::max<usize>(1, (text.size() + kTargetLeaf - 1) / kTargetLeaf);
+  splitEvenly(text.size(), groups, [&](usize begin, usize end) {
+    leaves.push_back(makeLeaf(std::string(text.substr(begin, end - begin))));
+  });
+  return leaves;
+}
+
+/// @brief Groups nodes under parents of at most kMaxChildren children
+auto groupNodes(const std::vector<NodePtr> &nodes) -> std::vector<NodePtr> {
+  std::vector<NodePtr> parents;
+  usize groups = (nodes.size() + kMaxChildren - 1) / kMaxChildren;
+  splitEvenly(nodes.size(), groups, [&](usize begin, usize end) {
+    parents.push_back(makeInner(
+        std::vector<NodePtr>(nodes.begin() + begin, nodes.begin() + end)));
+  });
+  return parents;
+}
+
+/// @brief Builds a root over one level of nodes
+auto buildRoot(std::vector<NodePtr> level) -> NodePtr {
+  while (level.size() > 1)
+    level = groupNodes(level);
+  return level.front();
+}
+
+/// @brief Inserts below `slot`; returns the siblings to add after it when
+/// the node overflowed and had to split
+auto insertAt(NodePtr &slot, usize pos, std::string_view text)
+    -> std::vector<NodePtr> {
+  RopeNode &node = mutate(slot);
+  if (node.leaf) {
+    node.text.insert(pos, text);
+    if (node.text.size() <= kMaxLeaf) {
+      node.bytes = node.text.size();
+      node.newlines += countNewlines(text);
+      return {};
+    }
+    std::vector<NodePtr> leaves = chunkText(node.text);
+    node.text = std::move(leaves.front()->text);
+    node.bytes = node.text.size();
+    node.newlines = countNewlines(node.text);
+    leaves.erase(leaves.begin());
+    return leaves;
+  }
+
+  // Prefer the child that ends at pos, so appends stay in the last chunk
+  usize index = 0;
+  while (index + 1 < node.children.size() &&
+         pos > node.children[index]->bytes) {
+    pos -= node.children[index]->bytes;
+    ++index;
+  }
+  std::vector<NodePtr> extra = insertAt(node.children[index], pos, text);
+  node.children.insert(node.children.begin() + index + 1, extra.begin(),
+                       extra.end());
+
+  if (node.children.size() <= kMaxChildren) {
+    node.bytes += text.size();
+    node.newlines += countNewlines(text);
+    return {};
+  }
+  std::vector<NodePtr> siblings = groupNodes(node.children);
+  node.children = std::move(siblings.front()->children);
+  recount(node);
+  siblings.erase(siblings.begin());
+  return siblings;
+}
+
+auto underfull(const RopeNode &node) -> bool {
+  return node.leaf ? node.text.size() < kMinLeaf
+                   : node.children.size() < kMinChildren;
+}
+
+/// @brief Merges children[index] and children[index + 1], re-splitting them
+/// evenly if the result would be too big
+auto mergeChildren(RopeNode &parent, usize index) -> void {
+  const RopeNode &left = *parent.children[index];
+  const RopeNode &right = *parent.children[index + 1];
+  if (left.leaf) {
+    std::string text = left.text + right.text;
+    if (text.size() <= kMaxLeaf) {
+      parent.children[index] = makeLeaf(std::move(text));
+      parent.children.erase(parent.children.begin() + index + 1);
+    } else {
+      usize half = text.size() / 2;
+      parent.children[index] = makeLeaf(text.substr(0, half));
+      parent.children[index + 1] = makeLeaf(text.substr(half));
+    }
+    return;
+  }
+
+  std::vector<NodePtr> children = left.children;
+  children.insert(children.end(), right.children.begin(),
+                  right.children.end());
+  if (children.size() <= kMaxChildren) {
+    parent.children[index] = makeInner(std::move(children));
+    parent.children.erase(parent.children.begin() + index + 1);
+  } else {
+    usize half = children.size() / 2;
+    parent.children[index] = makeInner(
+        std::vector<NodePtr>(children.begin(), children.begin() + half));
+    parent.children[index + 1] = makeInner(
+        std::vector<NodePtr>(children.begin() + half, children.end()));
+  }
+}
+
+/// @brief Removes bytes [from, to) below `slot`. Children wholly inside the
+/// range are dropped without being visited; the (at most two) partially
+/// cut children are merged with a neighbour if they end up underfull
+auto eraseRange(NodePtr &slot, usize from, usize to) -> void {
+  RopeNode &node = mutate(slot);
+  if (node.leaf) {
+    node.newlines -= countNewlines(
+        std::string_view(node.text).substr(from, to - from));
+    node.text.erase(from, to - from);
+    node.bytes = node.text.size();
+    return;
+  }
+
+  std::vector<usize> partial;
+  usize offset = 0;
+  for (usize i = 0; i < node.children.size() && offset < to;) {
+    usize bytes = node.children[i]->bytes;
+    usize begin = offset;
+    usize end = offset + bytes;
+    offset = end;
+    if (end <= from) {
+      ++i;
+    } else if (from <= begin && end <= to) {
+      node.children.erase(node.children.begin() + i);
+    } else {
+      eraseRange(node.children[i], std::max(from, begin) - begin,
+                 std::min(to, end) - begin);
+      partial.push_back(i);
+      ++i;
+    }
+  }
+
+  // Fix the right one first so the left index stays valid
+  for (auto it = partial.rbegin(); it != partial.rend(); ++it) {
+    usize index = *it;
+    if (index >= node.children.size() || !underfull(*node.children[index]))
+      continue;
+    if (node.children.size() < 2)
+      break;
+    mergeChildren(node, index + 1 < node.children.size() ? index : index - 1);
+  }
+  recount(node);
+}
+
+/// @brief Collapses single-child roots left behind by erasing
+auto normalizeRoot(NodePtr &root) -> void {
+  while (!root->leaf && root->children.size() == 1)
+    root = root->children.front();
+  if (!root->leaf && root->children.empty())
+    root = makeLeaf({});
+}
+
+auto visitChunks(const RopeNode &node, usize from, usize to,
+                 const std::function<void(std::string_view)> &fn) -> void {
+  if (node.leaf) {
+    fn(std::string_view(node.text).substr(from, to - from));
+    return;
+  }
+  usize offset = 0;
+  for (const NodePtr &child : node.children) {
+    usize begin = offset;
+    usize end = offset + child->bytes;
+    offset = end;
+    if (end <= from)
+      continue;
+    if (begin >= to)
+      break;
+    visitChunks(*child, std::max(from, begin) - begin,
+                std::min(to, end) - begin, fn);
+  }
+}
+
+} // namespace
+
+Rope::Rope() : _root(makeLeaf({})) {}
+
+Rope::Rope(std::string_view text) : _root(buildRoot(chunkText(text))) {}
+
+auto Rope::size() const -> usize { return _root->bytes; }
+
+auto Rope::lineCount() const -> usize { return _root->newlines + 1; }
+
+auto Rope::at(usize pos) const -> i8 {
+  if (pos >= size())
+    throw std::out_of_range("Rope position out of range");
+  const RopeNode *node = _root.get();
+  while (!node->leaf) {
+    for (const NodePtr &child : node->children) {
+      if (pos < child->bytes) {
+        node = child.get();
+        break;
+      }
+      pos -= child->bytes;
+    }
+  }
+  return node->text[pos];
+}
+
+auto Rope::insert(usize pos, std::string_view text) -> void {
+  if (pos > size())
+    throw std::out_of_range("Rope position out of range");
+  if (text.empty())
+    return;
+  std::vector<NodePtr> extra = insertAt(_root, pos, text);
+  if (!extra.empty()) {
+    extra.insert(extra.begin(), _root);
+    _root = buildRoot(std::move(extra));
+  }
+}
+
+auto Rope::erase(usize pos, usize count) -> void {
+  if (pos > size())
+    throw std::out_of_range("Rope position out of range");
+  count = std::min(count, size() - pos);
+  if (count == 0)
+    return;
+  eraseRange(_root, pos, pos + count);
+  normalizeRoot(_root);
+}
+
+auto Rope::slice(usize pos, usize count) const -> Rope {
+  if (pos > size())
+    throw std::out_of_range("Rope position out of range");
+  count = std::min(count, size() - pos);
+  // Erasing from a snapshot copies only the two boundary paths
+  Rope result(*this);
+  result.erase(pos + count, result.size());
+  result.erase(0, pos);
+  return result;
+}
+
+auto Rope::substr(usize pos, usize count) const -> std::string {
+  if (pos > size())
+    throw std::out_of_range("Rope position out of range");
+  count = std::min(count, size() - pos);
+  std::string result;
+  result.reserve(count);
+  forEachChunk(pos, count,
+               [&result](std::string_view chunk) { result += chunk; });
+  return result;
+}
+
+auto Rope::str() const -> std::string { return substr(0, size()); }
+
+auto Rope::lineStart(usize line) const -> usize {
+  if (line >= lineCount())
+    throw std::out_of_range("Rope line out of range");
+  if (line == 0)
+    return 0;
+  // Find the end of the line-th newline
+  usize offset = 0;
+  usize remaining = line;
+  const RopeNode *node = _root.get();
+  while (!node->leaf) {
+    for (const NodePtr &child : node->children) {
+      if (remaining <= child->newlines) {
+        node = child.get();
+        break;
+      }
+      remaining -= child->newlines;
+      offset += child->bytes;
+    }
+  }
+  usize pos = 0;
+  for (; remaining > 0; ++pos)
+    if (node->text[pos] == '\n')
+      --remaining;
+  return offset + pos;
+}
+
+auto Rope::line(usize line) const -> std::string {
+  usize start = lineStart(line);
+  usize end = line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+  return substr(start, end - start);
+}
+
+auto Rope::positionOf(usize pos) const -> TextPosition {
+  if (pos > size())
+    throw std::out_of_range("Rope position out of range");
+  usize line = 0;
+  usize remaining = pos;
+  const RopeNode *node = _root.get();
+  while (!node->leaf) {
+    const RopeNode *next = node->children.back().get();
+    for (const NodePtr &child : node->children) {
+      if (remaining < child->bytes) {
+        next = child.get();
+        break;
+      }
+      if (child.get() == next)
+        break;
+      remaining -= child->bytes;
+      line += child->newlines;
+    }
+    node = next;
+  }
+  line += countNewlines(std::string_view(node->text).substr(0, remaining));
+  return TextPosition{line, pos - lineStart(line)};
+}
+
+auto Rope::offsetOf(TextPosition position) const -> usize {
+  usize offset = lineStart(position.line) + position.column;
+  if (offset > size())
+    throw std::out_of_range("Rope column out of range");
+  return offset;
+}
+
+auto Rope::forEachChunk(const std::function<void(std::string_view)> &fn) const
+    -> void {
+  forEachChunk(0, size(), fn);
+}
+
+auto Rope::forEachChunk(usize pos, usize count,
+                        const std::function<void(std::string_view)> &fn) const
+    -> void {
+  count = std::min(count, size() - std::min(pos, size()));
+  if (count != 0)
+    visitChunks(*_root, pos, pos + count, fn);
+}
+
+auto Rope::height() const -> usize {
+  usize height = 1;
+  for (const RopeNode *node = _root.get(); !node->leaf;
+       node = node->children.front().get())
+    ++height;
+  return height;
+}
+
+auto Rope::operator==(const Rope &other) const -> bool {
+  return size() == other.size() && str() == other.str();
+}
+
+} // namespace roots::structures